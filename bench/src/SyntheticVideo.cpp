@@ -0,0 +1,158 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "SyntheticVideo.h"
+
+#include <opencv2/imgproc.hpp>
+#include <cmath>
+#include <sstream>
+
+
+static const float PI = 3.14159265358979f;
+
+
+std::string SyntheticScene::describe() const {
+    std::ostringstream out;
+    out << "{\"yaw_rate\": " << yawRate << ", \"pitch_amplitude\": " << pitchAmplitude << ", \"translation\": " << translation
+        << ", \"objects\": " << nbObjects << ", \"seed\": " << seed << "}";
+    return out.str();
+}
+
+
+// camera orientation at a frame: yaw, then pitch
+static cv::Matx33f cameraRotation(const SyntheticScene& scene, int frame) {
+    float yaw   = scene.yawRate * frame * PI / 180.f;
+    float pitch = scene.pitchAmplitude * std::sin(frame * 2.f * PI / 90.f) * PI / 180.f;
+
+    cv::Matx33f ry( std::cos(yaw), 0.f, std::sin(yaw),
+                    0.f,           1.f, 0.f,
+                   -std::sin(yaw), 0.f, std::cos(yaw));
+
+    cv::Matx33f rx(1.f, 0.f,              0.f,
+                   0.f, std::cos(pitch), -std::sin(pitch),
+                   0.f, std::sin(pitch),  std::cos(pitch));
+
+    return ry * rx;
+}
+
+
+SyntheticVideo::SyntheticVideo(const cv::Size& size, const SyntheticScene& scene) : m_size(size), m_scene(scene) {
+    cv::RNG rng(scene.seed);
+
+    // background: smooth noise at several scales, with a grid to give the flow some corners
+    cv::Size textureSize(2048, 1024);
+    m_background = cv::Mat::zeros(textureSize, CV_32FC3);
+    for(int scale = 8 ; scale <= 256 ; scale *= 4) {
+        cv::Mat noise(cv::Size(scale, scale / 2), CV_32FC3);
+        rng.fill(noise, cv::RNG::UNIFORM, cv::Scalar::all(0), cv::Scalar::all(255.f * 8 / scale));
+
+        cv::Mat resized;
+        cv::resize(noise, resized, textureSize, 0, 0, cv::INTER_CUBIC);
+        m_background += resized;
+    }
+
+    for(int x = 0 ; x < textureSize.width ; x += 64)
+        cv::line(m_background, cv::Point(x, 0), cv::Point(x, textureSize.height), cv::Scalar::all(40), 3);
+    for(int y = 0 ; y < textureSize.height ; y += 64)
+        cv::line(m_background, cv::Point(0, y), cv::Point(textureSize.width, y), cv::Scalar::all(40), 3);
+
+    m_background.convertTo(m_background, CV_8UC3);
+
+    for(int k = 0 ; k < scene.nbObjects ; ++k) {
+        Object object;
+        float azimuth   = rng.uniform(0.f, 2 * PI);
+        float distance  = rng.uniform(2.f, 6.f);
+        object.position = cv::Vec3f(distance * std::sin(azimuth), rng.uniform(-.5f, .5f), distance * std::cos(azimuth));
+        object.velocity = cv::Vec3f(rng.uniform(-.05f, .05f), 0.f, rng.uniform(-.05f, .05f));
+        object.radius   = rng.uniform(.2f, .6f);
+        object.color    = cv::Vec3b(rng.uniform(0, 256), rng.uniform(0, 256), rng.uniform(0, 256));
+        m_objects.push_back(object);
+    }
+
+    // longitude in [-pi, pi[ from left to right, latitude from pi/2 at the top
+    m_directions.create(size, CV_32FC3);
+    for(int i = 0 ; i < size.height ; ++i) {
+        float lat = (.5f - (i + .5f) / size.height) * PI;
+        cv::Vec3f *row = m_directions.ptr<cv::Vec3f>(i);
+        for(int j = 0 ; j < size.width ; ++j) {
+            float lon = ((j + .5f) / size.width - .5f) * 2 * PI;
+            row[j] = cv::Vec3f(std::cos(lat) * std::sin(lon), std::sin(lat), std::cos(lat) * std::cos(lon));
+        }
+    }
+
+    m_mapX.create(size, CV_32F);
+    m_mapY.create(size, CV_32F);
+}
+
+
+void SyntheticVideo::render(int frame, cv::Mat& bgr) {
+    cv::Matx33f rotation = cameraRotation(m_scene, frame);
+    float texW = static_cast<float>(m_background.cols);
+    float texH = static_cast<float>(m_background.rows);
+
+    // background at infinity: only the rotation of the camera moves it
+    for(int i = 0 ; i < m_size.height ; ++i) {
+        const cv::Vec3f *dir = m_directions.ptr<cv::Vec3f>(i);
+        float *mapX = m_mapX.ptr<float>(i);
+        float *mapY = m_mapY.ptr<float>(i);
+
+        for(int j = 0 ; j < m_size.width ; ++j) {
+            cv::Vec3f world = rotation * dir[j];
+            float lon = std::atan2(world[0], world[2]);
+            float lat = std::asin(std::max(-1.f, std::min(1.f, world[1])));
+
+            mapX[j] = (lon / (2 * PI) + .5f) * texW;
+            mapY[j] = (.5f - lat / PI) * texH;
+        }
+    }
+
+    cv::remap(m_background, bgr, m_mapX, m_mapY, cv::INTER_LINEAR, cv::BORDER_WRAP);
+
+    // objects: spheres, in the camera frame. The stripes give them a texture
+    cv::Vec3f camera(m_scene.translation * frame, 0.f, 0.f);
+    cv::Matx33f toCamera = rotation.t();
+
+    for(size_t k = 0 ; k < m_objects.size() ; ++k) {
+        const Object &object = m_objects[k];
+        cv::Vec3f center = toCamera * (object.position + object.velocity * static_cast<float>(frame) - camera);
+
+        float distance = static_cast<float>(cv::norm(center));
+        if(distance <= object.radius) continue;
+
+        cv::Vec3f axis = center / distance;
+        float cosRadius = std::cos(std::asin(object.radius / distance));
+
+        for(int i = 0 ; i < m_size.height ; ++i) {
+            const cv::Vec3f *dir = m_directions.ptr<cv::Vec3f>(i);
+            cv::Vec3b *out = bgr.ptr<cv::Vec3b>(i);
+
+            for(int j = 0 ; j < m_size.width ; ++j) {
+                float c = dir[j].dot(axis);
+                if(c < cosRadius) continue;
+
+                bool stripe = static_cast<int>((1.f - c) / (1.f - cosRadius) * 6.f) % 2 == 0;
+                out[j] = stripe ? object.color : cv::Vec3b(object.color[0] / 2, object.color[1] / 2, object.color[2] / 2);
+            }
+        }
+    }
+}
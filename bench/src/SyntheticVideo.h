@@ -0,0 +1,77 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _SyntheticVideo_
+#define _SyntheticVideo_
+
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+
+// Motion of a synthetic scene. Angles in degrees, distances in meters, per frame.
+struct SyntheticScene {
+    float       yawRate;            // camera rotation around the vertical axis
+    float       pitchAmplitude;     // oscillation of the camera pitch
+    float       translation;        // camera speed along the x axis
+    int         nbObjects;          // spheres moving around the camera
+    unsigned    seed;
+
+    SyntheticScene() : yawRate(.5f), pitchAmplitude(2.f), translation(.02f), nbObjects(6), seed(360) {}
+
+    std::string describe            ()                          const;
+};
+
+
+// Equirectangular frames of a synthetic scene: a textured background at infinity, seen by a rotating and
+// translating camera, and textured spheres at a few meters which move on their own, so that the camera
+// translation shows as parallax. The frames only depend on the scene, the size and the frame index.
+
+class SyntheticVideo {
+
+    struct Object {
+        cv::Vec3f   position;
+        cv::Vec3f   velocity;
+        float       radius;
+        cv::Vec3b   color;
+    };
+
+    cv::Size                m_size;
+    SyntheticScene          m_scene;
+    cv::Mat                 m_background;       // equirectangular texture, CV_8UC3
+    std::vector<Object>     m_objects;
+    cv::Mat                 m_directions;       // unit vector of each pixel, CV_32FC3
+
+    cv::Mat                 m_mapX;
+    cv::Mat                 m_mapY;
+
+public:
+    SyntheticVideo                  (const cv::Size& size, const SyntheticScene& scene);
+
+    void    render                  (int frame, cv::Mat& bgr);
+
+    inline const cv::Size& getSize  ()                          const { return m_size; }
+};
+
+
+#endif
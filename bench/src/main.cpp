@@ -0,0 +1,292 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+// Benchmark of the model on synthetic equirectangular videos: no data to download, no GPU required.
+// Each configuration (model, resolution, number of threads) processes the same synthetic sequence through
+// the streaming interface. The results are written as JSON: frames per second, duration of each stage
+// (see Trace.h) and peak resident memory, to be compared between commits.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include <opencv2/core.hpp>
+#include <boost/program_options.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "Saliency360.h"
+#include "SaliencyStream.h"
+#include "WorkerPool.h"
+#include "Trace.h"
+#include "SyntheticVideo.h"
+
+
+struct BenchConfig {
+    std::string     name;
+    int             model;              // model of Saliency360
+    cv::Size        size;
+    int             nbThreads;
+};
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+// peak resident memory: VmHWM is reset between the configurations (Linux >= 4.0)
+
+static void resetPeakMemory() {
+    FILE *f = fopen("/proc/self/clear_refs", "w");
+    if(f == NULL) return;
+
+    fputs("5", f);
+    fclose(f);
+}
+
+static long peakMemoryKB() {
+    std::ifstream status("/proc/self/status");
+    std::string line;
+
+    while(std::getline(status, line)) {
+        if(line.compare(0, 6, "VmHWM:") == 0)
+            return std::atol(line.c_str() + 6);
+    }
+
+    return -1;
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+
+static bool parseList(const std::string& list, std::vector<int>& values) {
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+
+    values.clear();
+    for(size_t i = 0 ; i < items.size() ; ++i) {
+        int value = std::atoi(items[i].c_str());
+        if(value <= 0) return false;
+        values.push_back(value);
+    }
+
+    return !values.empty();
+}
+
+
+static bool parseSizes(const std::string& list, std::vector<cv::Size>& sizes) {
+    std::vector<std::string> items;
+    boost::split(items, list, boost::is_any_of(","));
+
+    sizes.clear();
+    for(size_t i = 0 ; i < items.size() ; ++i) {
+        int width, height;
+        if(sscanf(items[i].c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) return false;
+        sizes.push_back(cv::Size(width, height));
+    }
+
+    return !sizes.empty();
+}
+
+
+// the models of the command line tool (0, 1) and the feature maps they are made of
+static bool modelOfName(const std::string& name, int& model) {
+    if(name == "model0")                model = 3;
+    else if(name == "model1")           model = 6;
+    else if(name == "image")            model = 3;
+    else if(name == "motion-source")    model = 1;
+    else if(name == "object-motion")    model = 0;
+    else return false;
+
+    return true;
+}
+
+
+static bool fileExists(const std::string& filename) {
+    std::ifstream f(filename.c_str());
+    return f.good();
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+
+static void runConfig(const BenchConfig& config, const SyntheticScene& scene, int nbFrames, int warmup, std::ostream& out) {
+    SyntheticVideo video(config.size, scene);
+
+    WorkerPool::get()->setNumThreads(config.nbThreads);
+    cv::setNumThreads(config.nbThreads);
+
+    Saliency360 settings;
+    settings.model          = config.model;
+    settings.temporalPrior  = 2;
+
+    SaliencyStream stream(settings, config.size, 30.f, config.size);
+    cv::Mat frame, map;
+
+    // the first frames load the models and fill the temporal window: they are not measured
+    for(int f = 0 ; f < warmup ; ++f) {
+        video.render(f, frame);
+        stream.push(frame);
+        while(stream.pull(map)) {}
+    }
+
+    Trace::clear();
+    Trace::enable(true);
+    resetPeakMemory();
+
+    // only the computation is timed, not the rendering of the frames
+    std::chrono::steady_clock::duration elapsed(0);
+    int nbMaps = 0;
+
+    for(int f = warmup ; f < warmup + nbFrames ; ++f) {
+        video.render(f, frame);
+
+        std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+        stream.push(frame);
+        while(stream.pull(map)) ++nbMaps;
+        elapsed += std::chrono::steady_clock::now() - t1;
+    }
+
+    std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+    stream.flush();
+    while(stream.pull(map)) ++nbMaps;
+    elapsed += std::chrono::steady_clock::now() - t1;
+
+    Trace::enable(false);
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    std::vector<TraceStats> stats;
+    Trace::summarize(stats);
+
+    out << "    {\"model\": \"" << config.name << "\", \"width\": " << config.size.width << ", \"height\": " << config.size.height
+        << ", \"threads\": " << config.nbThreads << ", \"frames\": " << nbMaps << ", \"seconds\": " << seconds
+        << ", \"fps\": " << (seconds > 0 ? nbMaps / seconds : 0) << ", \"peak_rss_kb\": " << peakMemoryKB() << ",\n      \"stages\": {";
+
+    for(size_t i = 0 ; i < stats.size() ; ++i) {
+        const TraceStats &stage = stats[i];
+        out << (i > 0 ? ",\n        " : "\n        ") << "\"" << stage.stage << "\": {\"count\": " << stage.count << ", \"total_ms\": " << stage.total
+            << ", \"mean_ms\": " << stage.mean << ", \"p50_ms\": " << stage.p50 << ", \"p90_ms\": " << stage.p90 << ", \"p99_ms\": " << stage.p99 << ", \"max_ms\": " << stage.max << "}";
+    }
+
+    out << "}}";
+
+    std::cerr << "[I] " << config.name << " " << config.size.width << "x" << config.size.height << ", " << config.nbThreads << " threads: "
+              << (seconds > 0 ? nbMaps / seconds : 0) << " frames/s" << std::endl;
+}
+
+
+int main(int argc, char **argv) {
+    namespace po = boost::program_options;
+
+    po::options_description desc("Benchmark of the saliency models on synthetic equirectangular videos");
+    desc.add_options()
+        ("help", "produce help message")
+        ("models", po::value< std::string >()->default_value("image,motion-source,object-motion,model0,model1"), "Models to run: model0 and model1 (as --model of salient), image, motion-source, object-motion. model1 needs ./data/fdeep_model.json, it is skipped without it.")
+        ("sizes", po::value< std::string >()->default_value("1024x512,2048x1024"), "Resolutions of the synthetic video.")
+        ("threads", po::value< std::string >()->default_value("1,4"), "Numbers of worker threads.")
+        ("frames", po::value< int >()->default_value(30), "Measured frames per configuration.")
+        ("warmup", po::value< int >()->default_value(20), "Frames processed before the measure: loading of the models and temporal window.")
+        ("yaw-rate", po::value< float >()->default_value(.5f), "Camera rotation, degrees per frame.")
+        ("translation", po::value< float >()->default_value(.02f), "Camera translation, meters per frame.")
+        ("objects", po::value< int >()->default_value(6), "Number of moving objects.")
+        ("seed", po::value< unsigned >()->default_value(360), "Seed of the scene.")
+        ("label", po::value< std::string >()->default_value(""), "Label stored with the results, e.g. the commit.")
+        ("output,o", po::value< std::string >(), "JSON results. Default: stdout.")
+    ;
+
+    po::variables_map vm;
+    try {
+        po::store(po::parse_command_line(argc, argv, desc), vm);
+        po::notify(vm);
+    } catch(const po::error& e) {
+        std::cerr << "[E] " << e.what() << std::endl << desc << std::endl;
+        return -1;
+    }
+
+    if(vm.count("help")) {
+        std::cout << desc << std::endl;
+        return 0;
+    }
+
+    std::vector<int> threads;
+    std::vector<cv::Size> sizes;
+    if(!parseList(vm["threads"].as<std::string>(), threads) || !parseSizes(vm["sizes"].as<std::string>(), sizes)) {
+        std::cerr << "[E] --threads is a list of numbers, --sizes a list of WxH" << std::endl;
+        return -1;
+    }
+
+    SyntheticScene scene;
+    scene.yawRate       = vm["yaw-rate"].as<float>();
+    scene.translation   = vm["translation"].as<float>();
+    scene.nbObjects     = vm["objects"].as<int>();
+    scene.seed          = vm["seed"].as<unsigned>();
+
+    std::vector<std::string> models;
+    std::string modelList = vm["models"].as<std::string>();
+    boost::split(models, modelList, boost::is_any_of(","));
+
+    std::vector<BenchConfig> configs;
+    for(size_t m = 0 ; m < models.size() ; ++m) {
+        BenchConfig config;
+        config.name = models[m];
+        if(!modelOfName(config.name, config.model)) {
+            std::cerr << "[E] Unknown model: " << config.name << std::endl;
+            return -1;
+        }
+
+        // the flow classifier of the adaptive model is not part of the repository
+        if(config.model == 6 && !fileExists("./data/fdeep_model.json")) {
+            std::cerr << "[W] " << config.name << " skipped: ./data/fdeep_model.json not found" << std::endl;
+            continue;
+        }
+
+        for(size_t s = 0 ; s < sizes.size() ; ++s) {
+            for(size_t t = 0 ; t < threads.size() ; ++t) {
+                config.size = sizes[s];
+                config.nbThreads = threads[t];
+                configs.push_back(config);
+            }
+        }
+    }
+
+    std::ofstream file;
+    if(vm.count("output")) {
+        file.open(vm["output"].as<std::string>().c_str());
+        if(!file.is_open()) {
+            std::cerr << "[E] Cannot open file for write: " << vm["output"].as<std::string>() << std::endl;
+            return -1;
+        }
+    }
+    std::ostream& out = vm.count("output") ? static_cast<std::ostream&>(file) : std::cout;
+
+    out << "{\"label\": \"" << vm["label"].as<std::string>() << "\", \"scene\": " << scene.describe() << ", \"warmup\": " << vm["warmup"].as<int>() << ",\n  \"results\": [\n";
+
+    for(size_t c = 0 ; c < configs.size() ; ++c) {
+        if(c > 0) out << ",\n";
+        runConfig(configs[c], scene, std::max(1, vm["frames"].as<int>()), std::max(0, vm["warmup"].as<int>()), out);
+        out.flush();
+    }
+
+    out << "\n  ]}\n";
+
+    return 0;
+}
@@ -24,14 +24,16 @@
 
 
 #include "AdaptiveMotionFeatureMap.h"
-#include "SalientFeatureFactory.h"
+#include "SaliencyContext.h"
+#include "Trace.h"
+#include "MemoryAccounting.h"
 #include <iostream>
-#include <boost/thread.hpp>
+#include "WorkerPool.h"
 #include <boost/bind.hpp>
 
 AdaptiveMotionFeatureMap::AdaptiveMotionFeatureMap() : MotionFeatureMap(0) {
 
-    m_flowClassifier = boost::shared_ptr<FlowClassier>(new FlowClassier("./data/fdeep_model.json"));
+    m_flowClassifier = FlowClassier::load("./data/fdeep_model.json");
     m_pedestrianDriven = false;
 }
 
@@ -40,11 +42,27 @@ AdaptiveMotionFeatureMap::AdaptiveMotionFeatureMap() : MotionFeatureMap(0) {
 
 std::vector<float> AdaptiveMotionFeatureMap::flowClassif(int frame) {
 
-    ObjectMotionFeatureMap *objMotionModel = reinterpret_cast< ObjectMotionFeatureMap * >(SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature));
-    
+    cv::Mat probs = m_context->getFeatureGraph().get(frame, "classifier", SalientFeatureFactory::getName(SalientFeatureFactory::AdaptiveMotionFeature),
+                                                     boost::bind(&AdaptiveMotionFeatureMap::flowClassifJob, this, frame));
+    if(probs.empty()) return std::vector<float>();
+
+    return std::vector<float>(probs.begin<float>(), probs.end<float>());
+}
+
+
+// the probabilities of the classifier, as a row of the feature graph
+cv::Mat AdaptiveMotionFeatureMap::flowClassifJob(int frame) {
+
+    ObjectMotionFeatureMap *objMotionModel = reinterpret_cast< ObjectMotionFeatureMap * >(m_context->getFactory().getModel(SalientFeatureFactory::ObjectMotionFeature));
+
+    m_context->getFlow(frame, "classifier");
     objMotionModel->grabRequiredData(frame);
     
-    return m_flowClassifier->predict(objMotionModel->getFrontFlow());
+    TraceScope trace("classifier", frame);
+    std::vector<float> probs = m_flowClassifier->predict(objMotionModel->getFrontFlow(m_flowClassifier->getInputSize()));
+    if(probs.empty()) return cv::Mat();
+
+    return cv::Mat(probs, true).reshape(1, 1);
 
 }
 
@@ -55,18 +73,16 @@ cv::Mat AdaptiveMotionFeatureMap::compute(int frame) {
 
     // If we use the pedestrian driven approach we detect, and then use the bounding box as a mask for the object motion feature 
     if(m_pedestrianDriven) {
-        PedestrianFeatureMap *detector = dynamic_cast<PedestrianFeatureMap*>(SalientFeatureFactory::get()->getModel(SalientFeatureFactory::PedestrianFeature));
+        PedestrianFeatureMap *detector = dynamic_cast<PedestrianFeatureMap*>(m_context->getFactory().getModel(SalientFeatureFactory::PedestrianFeature));
         if(detector) {
-            detector->grabRequiredData(frame);
-            cv::Mat mask = detector->compute(frame);
+            cv::Mat mask = m_context->getFactory().compute(SalientFeatureFactory::PedestrianFeature, frame, SalientFeatureFactory::getName(SalientFeatureFactory::AdaptiveMotionFeature));
 
             double mn, mx;
             cv::minMaxLoc(mask, &mn, &mx);
 
             // There is a pedestrian in the scene, in that case we are going to use the mask 
             if(mx > .5) {
-                SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature)->grabRequiredData(frame);
-                cv::Mat map2 = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature)->compute(frame);
+                cv::Mat map2 = m_context->getFactory().compute(SalientFeatureFactory::ObjectMotionFeature, frame, SalientFeatureFactory::getName(SalientFeatureFactory::AdaptiveMotionFeature));
                 
                 map2 = map2.mul(mask);
 
@@ -91,26 +107,23 @@ cv::Mat AdaptiveMotionFeatureMap::compute(int frame) {
     }
 
 
-    SalientFeatureMap *salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::MotionSourceFeature);
-    salientFeature->grabRequiredData(frame);
-
 	cv::Mat map1, map2;
-    boost::thread_group g;
+    TaskGroup g;
 	if (probs[0] > 0.1) {
-		// map1 = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::MotionSourceFeature)->compute(frame);
-        g.create_thread(boost::bind(&AdaptiveMotionFeatureMap::getFeatureMapJob, this, frame, 1, boost::ref(map1)));
+		// map1 = m_context->getFactory().getModel(SalientFeatureFactory::MotionSourceFeature)->compute(frame);
+        g.run(boost::bind(&AdaptiveMotionFeatureMap::getFeatureMapJob, this, frame, 1, boost::ref(map1)));
 	}
 	else {
-		map1 = cv::Mat::zeros(FlowManager::get()->getFrame(frame).frame.size(), CV_32FC1);
+		map1 = cv::Mat::zeros(m_context->getFlowManager().getFrame(frame).frame.size(), CV_32FC1);
 	}
 
 	if ((probs[1] + probs[2]) > 0.1) {
-		// map2 = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature)->compute(frame);
-        g.create_thread(boost::bind(&AdaptiveMotionFeatureMap::getFeatureMapJob, this, frame, 2, boost::ref(map2)));
+		// map2 = m_context->getFactory().getModel(SalientFeatureFactory::ObjectMotionFeature)->compute(frame);
+        g.run(boost::bind(&AdaptiveMotionFeatureMap::getFeatureMapJob, this, frame, 2, boost::ref(map2)));
 	} else {
-		map2 = cv::Mat::zeros(FlowManager::get()->getFrame(frame).frame.size(), CV_32FC1);
+		map2 = cv::Mat::zeros(m_context->getFlowManager().getFrame(frame).frame.size(), CV_32FC1);
 	}
-    g.join_all();
+    g.wait();
     
 	if(m_verbose)
 		std::cout << "probabilities: " << probs[0] << ", " << probs[1] << ", " << probs[2] << std::endl;
@@ -131,16 +144,34 @@ cv::Mat AdaptiveMotionFeatureMap::compute(int frame) {
 }
 
 void AdaptiveMotionFeatureMap::getFeatureMapJob(int frame, int feature, cv::Mat& mat) {
+    const char *name = SalientFeatureFactory::getName(SalientFeatureFactory::AdaptiveMotionFeature);
+
     if(feature == 1) {
-        mat = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::MotionSourceFeature)->compute(frame);
+        mat = m_context->getFactory().compute(SalientFeatureFactory::MotionSourceFeature, frame, name);
     }
 
     if(feature == 2) {
-        mat = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature)->compute(frame);
+        mat = m_context->getFactory().compute(SalientFeatureFactory::ObjectMotionFeature, frame, name);
     }
 }
 
 
+void AdaptiveMotionFeatureMap::collectMemory(MemoryReport& report, const std::string& owner) {
+    MotionFeatureMap::collectMemory(report, owner);
+    report.add(owner + ".state", m_lastMap);
+
+    // the classifier is shared by the engines of the process
+    if(m_flowClassifier)
+        report.addBytes("fdeep", m_flowClassifier.get(), m_flowClassifier->getMemoryUsage());
+}
+
 
+void AdaptiveMotionFeatureMap::saveState(std::map<std::string, cv::Mat>& state, const std::string& owner) const {
+    state[owner + ".lastMap"] = m_lastMap;
+}
 
 
+void AdaptiveMotionFeatureMap::restoreState(const std::map<std::string, cv::Mat>& state, const std::string& owner) {
+    std::map<std::string, cv::Mat>::const_iterator it = state.find(owner + ".lastMap");
+    if(it != state.end()) m_lastMap = it->second;
+}
@@ -46,12 +46,19 @@ public:
 
 
     virtual cv::Mat compute             (int frame);
+    virtual void    reset               ()                          { MotionFeatureMap::reset(); m_lastMap = cv::Mat(); }
+    virtual void    collectMemory       (MemoryReport& report, const std::string& owner);
+
+    // the last map, returned when the classifier fails
+    virtual void    saveState           (std::map<std::string, cv::Mat>& state, const std::string& owner)          const;
+    virtual void    restoreState        (const std::map<std::string, cv::Mat>& state, const std::string& owner);
 
     inline void setPedestrianDriven     (bool enable)               { m_pedestrianDriven = enable; };	
 
 private:
 
     std::vector<float> flowClassif(int frame);
+    cv::Mat flowClassifJob(int frame);
     void getFeatureMapJob(int frame, int feature, cv::Mat& mat);
 
 };
@@ -31,12 +31,13 @@
 #include <UBMS.h>
 #include <UBMS360.h>
 #include <opencv2/opencv.hpp>
-#include <boost/thread.hpp>
+#include "WorkerPool.h"
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 
 #include "ShiftImage.hpp"
 #include "EquatorialPrior.h"
+#include "Trace.h"
 
 
 
@@ -57,9 +58,31 @@ BMSSaliency::BMSSaliency(bool loc_bms360, bool umat) {
 }
 
 
+void BMSSaliency::setMaxDim(float maxDim) {
+	m_maxDim 				= maxDim;
+	m_dilatationWidth1 		= static_cast<int>(fmax(round(7 * m_maxDim / 400.f), 1.f));
+	m_dilatationWidth2 		= static_cast<int>(fmax(round(9 * m_maxDim / 400.f), 1.f));
+	m_blurStd 				= round(9 * m_maxDim / 400);
+}
+
+
 
 
 void BMSSaliency::process(const cv::Mat &inputImage, cv::Mat &sMap, bool normalize) {
+	FramePyramid pyramid(inputImage);
+	process(pyramid, sMap, normalize);
+}
+
+
+void BMSSaliency::process(FramePyramid &pyramid, cv::Mat &sMap, bool normalize) {
+	cv::Mat inputImage = pyramid.getSource();
+	if(inputImage.empty()) return;
+
+	TraceScope trace("bms");
+
+	// all the projections are computed at the same resolution: resize before shifting
+	cv::Mat smallImage = pyramid.getMaxDim(static_cast<int>(m_maxDim));
+
 	Configuration conf;
 
     conf.sampleStep = m_sampleStep;
@@ -80,12 +103,15 @@ void BMSSaliency::process(const cv::Mat &inputImage, cv::Mat &sMap, bool normali
 	// With the new version on GPU, we probably don't want to run that on multiple threads.
 
  
-    boost::thread_group g;
+    // the projections run on the workers: they are traced with the frame of the caller
+    conf.frame = Trace::currentFrame();
+
+    TaskGroup g;
     for(int i = 0 ; i < m_nb_projections ; ++i) {
-    	g.create_thread(boost::bind(&BMSSaliency::processJob, this, i, m_nb_projections, boost::ref(inputImage), boost::ref(outputs), boost::ref(conf)));
+    	g.run(boost::bind(&BMSSaliency::processJob, this, i, m_nb_projections, boost::ref(smallImage), boost::ref(outputs), boost::ref(conf)));
 
     }
-    g.join_all();
+    g.wait();
 
 
 
@@ -114,7 +140,7 @@ void BMSSaliency::process(const cv::Mat &inputImage, cv::Mat &sMap, bool normali
 
 
 	if(m_equatorialPrior)
-		applyEquatorialPrior(sMap, inputImage);
+		applyEquatorialPrior(sMap, pyramid);
 
 
 	
@@ -124,6 +150,7 @@ void BMSSaliency::process(const cv::Mat &inputImage, cv::Mat &sMap, bool normali
 
 
 void BMSSaliency::processJob(int workerID, int nb_shift, const cv::Mat &input, std::vector<cv::Mat> &outputs, Configuration &conf) {
+	TraceScope trace("bms.projection", conf.frame);
 	cv::Mat inputImage = shiftImage<unsigned char>(input, workerID * input.cols / nb_shift, 0);
 
 	processOneProjection(inputImage, outputs[workerID], conf.maxDim, conf.dilatationWidth1, conf.dilatationWidth2, conf.normalize, conf.handleBorder, conf.colorSpace, conf.whitening, conf.sampleStep, conf.blurStd);
@@ -139,7 +166,11 @@ void BMSSaliency::processOneProjection(const cv::Mat &input, cv::Mat &output, in
 	float w = (float)input.cols, h = (float)input.rows;
 	float maxD = fmax(w, h);
 
-	cv::resize(input, src_small, cv::Size((int)(maxDim*w / maxD), (int)(maxDim*h / maxD)), 0.0, 0.0, cv::INTER_AREA);
+	cv::Size size((int)(maxDim*w / maxD), (int)(maxDim*h / maxD));
+	if(size == input.size())
+		src_small = input;
+	else
+		cv::resize(input, src_small, size, 0.0, 0.0, cv::INTER_AREA);
 
 	if (!m_useTAPI) {
 		boost::shared_ptr<BMS> bms;
@@ -150,7 +181,10 @@ void BMSSaliency::processOneProjection(const cv::Mat &input, cv::Mat &output, in
 			bms = boost::shared_ptr<BMS>(new BMS(src_small, dilatationWidth1, normalize == 1, handleBorder == 1, colorSpace, whitening));
 		}
 
-		bms->computeSaliency((double)sampleStep);
+		{
+			TraceScope trace("bms.sweep");
+			bms->computeSaliency((double)sampleStep);
+		}
 
 		cv::Mat result = bms->getSaliencyMap(false);
 		
@@ -168,7 +202,10 @@ void BMSSaliency::processOneProjection(const cv::Mat &input, cv::Mat &output, in
 			bms = boost::shared_ptr<UBMS>(new UBMS(src_small, dilatationWidth1, normalize == 1, handleBorder == 1, colorSpace, whitening));
 		}
 		
-		bms->computeSaliency((double)sampleStep);
+		{
+			TraceScope trace("bms.sweep");
+			bms->computeSaliency((double)sampleStep);
+		}
 
 		output = bms->getSaliencyMap(false, dilatationWidth2);
 	}
@@ -29,6 +29,7 @@
 
 
 #include <opencv2/core.hpp>
+#include "FramePyramid.h"
 
 
 struct Configuration {
@@ -42,6 +43,7 @@ struct Configuration {
 	bool whitening;
 	int maxDim;
 	bool equatorialPrior;
+	int frame;				// traced frame
 }; 
 
 
@@ -71,6 +73,12 @@ public:
 
 	virtual void process(const cv::Mat &input, cv::Mat &output, bool normalize = true);
 
+	// the image is resized once to m_maxDim, through the pyramid of the frame
+	virtual void process(FramePyramid &input, cv::Mat &output, bool normalize = true);
+
+	// sets m_maxDim and the dilatation and blur parameters, proportional to it
+	void		 setMaxDim(float maxDim);
+
 
 
 private:
@@ -0,0 +1,132 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "BatchScheduler.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+#include <opencv2/videoio.hpp>
+
+
+bool readBatchManifest(const std::string& filename, std::vector<BatchJob>& jobs) {
+    std::ifstream file(filename.c_str());
+    if(!file.is_open()) {
+        std::cerr << "[E] readBatchManifest: cannot open: " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while(std::getline(file, line)) {
+        ++lineNumber;
+        if(!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+        if(line.empty() || line[0] == '#') continue;
+
+        BatchJob job;
+        job.cost = 0;
+
+        size_t tab = line.find('\t');
+        if(tab != std::string::npos) {
+            job.input = line.substr(0, tab);
+            job.output = line.substr(tab + 1);
+        } else {
+            std::istringstream fields(line);
+            fields >> job.input >> job.output;
+        }
+
+        if(job.input.empty() || job.output.empty()) {
+            std::cerr << "[W] readBatchManifest: " << filename << ":" << lineNumber << ": expected an input and an output, line ignored" << std::endl;
+            continue;
+        }
+
+        jobs.push_back(job);
+    }
+
+    return true;
+}
+
+
+static bool moreExpensive(const BatchJob& a, const BatchJob& b) {
+    return a.cost > b.cost;
+}
+
+
+BatchScheduler::BatchScheduler(const std::vector<BatchJob>& jobs, int nbSlots) : m_jobs(jobs), m_nbSlots(std::max(1, nbSlots)), m_next(0), m_nbFailed(0) {
+
+    for(size_t i = 0 ; i < m_jobs.size() ; ++i) {
+        if(m_jobs[i].cost <= 0)
+            m_jobs[i].cost = estimateCost(m_jobs[i].input);
+    }
+
+    std::stable_sort(m_jobs.begin(), m_jobs.end(), moreExpensive);
+}
+
+
+double BatchScheduler::estimateCost(const std::string& video) {
+    cv::VideoCapture capture(video);
+    if(!capture.isOpened()) return 0;
+
+    return capture.get(cv::CAP_PROP_FRAME_COUNT) * capture.get(cv::CAP_PROP_FRAME_WIDTH) * capture.get(cv::CAP_PROP_FRAME_HEIGHT);
+}
+
+
+void BatchScheduler::slotLoop(int slot, const boost::function<bool (const BatchJob&, int)>& process) {
+    while(true) {
+        size_t index;
+        {
+            boost::mutex::scoped_lock lock(m_lock);
+            if(m_next >= m_jobs.size()) return;
+
+            index = m_next++;
+            std::cout << "[I] Batch [" << index + 1 << "/" << m_jobs.size() << "] " << m_jobs[index].input << " -> " << m_jobs[index].output << std::endl;
+        }
+
+        if(!process(m_jobs[index], slot)) {
+            boost::mutex::scoped_lock lock(m_lock);
+            ++m_nbFailed;
+            std::cerr << "[E] Batch: failed: " << m_jobs[index].input << std::endl;
+        }
+    }
+}
+
+
+int BatchScheduler::run(const boost::function<bool (const BatchJob&, int)>& process) {
+    m_next = 0;
+    m_nbFailed = 0;
+
+    if(m_nbSlots == 1) {
+        slotLoop(0, process);
+        return m_nbFailed;
+    }
+
+    // the slots block for the whole video: they have their own threads, the WorkerPool runs the frames
+    boost::thread_group slots;
+    for(int i = 0 ; i < m_nbSlots ; ++i)
+        slots.create_thread(boost::bind(&BatchScheduler::slotLoop, this, i, boost::cref(process)));
+    slots.join_all();
+
+    return m_nbFailed;
+}
@@ -0,0 +1,70 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _BatchScheduler_
+#define _BatchScheduler_
+
+#include <string>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+
+
+struct BatchJob {
+    std::string     input;
+    std::string     output;
+    double          cost;           // expected processing cost: frames x width x height
+};
+
+// manifest: one "input output" pair per line, separated by a tab (paths with spaces) or by spaces.
+// Empty lines and lines starting with # are ignored.
+bool readBatchManifest              (const std::string& filename, std::vector<BatchJob>& jobs);
+
+
+// Runs the jobs of a batch on nbSlots concurrent slots. The most expensive videos are started
+// first and each slot takes the next job when it is done (longest processing time first), so that
+// a long video does not end up running alone at the end of the batch.
+
+class BatchScheduler {
+
+    std::vector<BatchJob>           m_jobs;
+    int                             m_nbSlots;
+    size_t                          m_next;
+    int                             m_nbFailed;
+    boost::mutex                    m_lock;
+
+public:
+    BatchScheduler                  (const std::vector<BatchJob>& jobs, int nbSlots = 1);
+
+    // process(job, slot) returns false when the job failed. Returns the number of failed jobs
+    int             run             (const boost::function<bool (const BatchJob&, int)>& process);
+
+    // frames x width x height from the header of the video, 0 when it cannot be opened
+    static double   estimateCost    (const std::string& video);
+
+private:
+    void            slotLoop        (int slot, const boost::function<bool (const BatchJob&, int)>& process);
+};
+
+
+#endif
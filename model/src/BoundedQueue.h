@@ -0,0 +1,82 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _BoundedQueue_
+#define _BoundedQueue_
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <deque>
+
+
+// FIFO between two threads. push blocks while the queue is full, pop blocks while it is empty.
+// Once closed, push fails and pop returns the remaining items then fails.
+
+template <typename T>
+class BoundedQueue {
+
+    std::deque<T>                   m_items;
+    size_t                          m_capacity;
+    bool                            m_closed;
+    boost::mutex                    m_lock;
+    boost::condition_variable       m_notFull;
+    boost::condition_variable       m_notEmpty;
+
+public:
+    BoundedQueue                    (size_t capacity) : m_capacity(capacity > 0 ? capacity : 1), m_closed(false) {}
+
+    bool push(const T& item) {
+        boost::mutex::scoped_lock lock(m_lock);
+        while(m_items.size() >= m_capacity && !m_closed)
+            m_notFull.wait(lock);
+
+        if(m_closed) return false;
+
+        m_items.push_back(item);
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T& item) {
+        boost::mutex::scoped_lock lock(m_lock);
+        while(m_items.empty() && !m_closed)
+            m_notEmpty.wait(lock);
+
+        if(m_items.empty()) return false;
+
+        item = m_items.front();
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void close() {
+        boost::mutex::scoped_lock lock(m_lock);
+        m_closed = true;
+        m_notFull.notify_all();
+        m_notEmpty.notify_all();
+    }
+};
+
+
+#endif
@@ -0,0 +1,189 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "Checkpoint.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+
+namespace {
+
+    const char  CHECKPOINT_MAGIC[8]     = { 'V', 'B', 'M', 'S', 'C', 'K', 'P', 'T' };
+    const int   CHECKPOINT_VERSION      = 1;
+
+    template <typename T>
+    bool put(FILE *f, const T& value) {
+        return fwrite(&value, sizeof(T), 1, f) == 1;
+    }
+
+    template <typename T>
+    bool get(FILE *f, T& value) {
+        return fread(&value, sizeof(T), 1, f) == 1;
+    }
+
+    bool putString(FILE *f, const std::string& s) {
+        unsigned int size = static_cast<unsigned int>(s.size());
+        return put(f, size) && (size == 0 || fwrite(s.data(), 1, size, f) == size);
+    }
+
+    bool getString(FILE *f, std::string& s) {
+        unsigned int size = 0;
+        if(!get(f, size) || size > (1u << 20)) return false;
+
+        s.resize(size);
+        return size == 0 || fread(&s[0], 1, size, f) == size;
+    }
+
+    bool putMap(FILE *f, const std::string& name, const cv::Mat& map) {
+        cv::Mat data = map.isContinuous() ? map : map.clone();
+        int rows = data.rows, cols = data.cols, type = data.type();
+        size_t bytes = data.total() * data.elemSize();
+
+        return putString(f, name) && put(f, rows) && put(f, cols) && put(f, type) && (bytes == 0 || fwrite(data.data, 1, bytes, f) == bytes);
+    }
+
+    // bytes from the current position to the end of the file
+    long long remaining(FILE *f) {
+        long position = ftell(f);
+        if(position < 0 || fseek(f, 0, SEEK_END) != 0) return -1;
+
+        long end = ftell(f);
+        if(fseek(f, position, SEEK_SET) != 0) return -1;
+        return static_cast<long long>(end) - position;
+    }
+
+    bool getMap(FILE *f, std::string& name, cv::Mat& map) {
+        int rows = 0, cols = 0, type = 0;
+        if(!getString(f, name) || !get(f, rows) || !get(f, cols) || !get(f, type)) return false;
+        if(rows < 0 || cols < 0 || type < 0 || type != CV_MAT_TYPE(type) || CV_MAT_DEPTH(type) > CV_64F) return false;
+
+        map = cv::Mat();
+        if(rows == 0 || cols == 0) return true;
+
+        // the size is checked against the file before the allocation: a corrupted header is not allocated
+        unsigned long long bytes = static_cast<unsigned long long>(rows) * cols * CV_ELEM_SIZE(type);
+        long long available = remaining(f);
+        if(available < 0 || bytes > static_cast<unsigned long long>(available)) return false;
+
+        map.create(rows, cols, type);
+        return fread(map.data, 1, static_cast<size_t>(bytes), f) == bytes;
+    }
+
+}
+
+
+bool Checkpoint::write(const std::string& filename, const CheckpointState& state) {
+    std::string temporary = filename + ".tmp";
+
+    FILE *f = fopen(temporary.c_str(), "wb");
+    if(f == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << temporary << std::endl;
+        return false;
+    }
+
+    const OutputPosition &position = state.position;
+    unsigned int nbEntries = static_cast<unsigned int>(position.index.size());
+    unsigned int nbMaps = static_cast<unsigned int>(state.maps.size());
+
+    bool ok = fwrite(CHECKPOINT_MAGIC, 1, sizeof(CHECKPOINT_MAGIC), f) == sizeof(CHECKPOINT_MAGIC) && put(f, CHECKPOINT_VERSION);
+    ok = ok && putString(f, state.settings) && putString(f, state.output) && put(f, state.frame);
+    ok = ok && put(f, position.nbFrames) && put(f, position.offset) && put(f, position.size.width) && put(f, position.size.height);
+    ok = ok && put(f, nbEntries) && (nbEntries == 0 || fwrite(position.index.data(), sizeof(SaliencyContainerIndex), nbEntries, f) == nbEntries);
+
+    ok = ok && put(f, nbMaps);
+    for(std::map<std::string, cv::Mat>::const_iterator it = state.maps.begin() ; ok && it != state.maps.end() ; ++it)
+        ok = putMap(f, it->first, it->second);
+
+    ok = SaliencyWriter::syncFile(f) && ok;
+    ok = fclose(f) == 0 && ok;
+
+#ifdef _WIN32
+    // rename does not replace an existing file
+    if(ok) std::remove(filename.c_str());
+#endif
+    ok = ok && std::rename(temporary.c_str(), filename.c_str()) == 0;
+
+    if(!ok) {
+        std::cerr << "[E] Checkpoint::write: cannot write " << filename << std::endl;
+        std::remove(temporary.c_str());
+    }
+
+    return ok;
+}
+
+
+bool Checkpoint::read(const std::string& filename, CheckpointState& state) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(f == NULL) return false;
+
+    char magic[sizeof(CHECKPOINT_MAGIC)];
+    int version = 0;
+    bool ok = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) == 0;
+    ok = ok && get(f, version) && version == CHECKPOINT_VERSION;
+
+    OutputPosition &position = state.position;
+    unsigned int nbEntries = 0, nbMaps = 0;
+
+    ok = ok && getString(f, state.settings) && getString(f, state.output) && get(f, state.frame);
+    ok = ok && get(f, position.nbFrames) && get(f, position.offset) && get(f, position.size.width) && get(f, position.size.height);
+    ok = ok && get(f, nbEntries) && nbEntries < (1u << 28);
+
+    // the index is checked against the file before the allocation, as the maps
+    if(ok) {
+        long long available = remaining(f);
+        ok = available >= 0 && static_cast<unsigned long long>(nbEntries) * sizeof(SaliencyContainerIndex) <= static_cast<unsigned long long>(available);
+    }
+
+    if(ok) {
+        position.index.resize(nbEntries);
+        ok = nbEntries == 0 || fread(position.index.data(), sizeof(SaliencyContainerIndex), nbEntries, f) == nbEntries;
+    }
+
+    state.maps.clear();
+    ok = ok && get(f, nbMaps);
+    try {
+        for(unsigned int i = 0 ; ok && i < nbMaps ; ++i) {
+            std::string name;
+            cv::Mat map;
+            ok = getMap(f, name, map);
+            state.maps[name] = map;
+        }
+    } catch(cv::Exception &e) {
+        std::cerr << "[E] Checkpoint::read: " << e.what() << std::endl;
+        ok = false;
+    }
+
+    fclose(f);
+
+    if(!ok)
+        std::cerr << "[E] Checkpoint::read: " << filename << " is not a valid checkpoint" << std::endl;
+
+    return ok;
+}
+
+
+void Checkpoint::remove(const std::string& filename) {
+    std::remove(filename.c_str());
+}
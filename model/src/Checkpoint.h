@@ -0,0 +1,64 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _Checkpoint_
+#define _Checkpoint_
+
+#include <opencv2/core.hpp>
+#include <map>
+#include <string>
+
+#include "SaliencyWriter.h"
+
+
+// What a run needs to resume at frame after an interruption (crash, preemption): the position of its
+// output and the state the feature maps carry from one frame to the next. The temporal prior only
+// depends on the time of the frame, and the frames and flows of the window are read again (from the
+// flow store, if any) after seeking to frame.
+
+struct CheckpointState {
+    std::string                     settings;       // options of the run: the checkpoint of a run with other options is ignored
+    std::string                     output;
+    int                             frame;          // first frame to compute
+    OutputPosition                  position;       // of the output, after the maps of the frames before frame
+    std::map<std::string, cv::Mat>  maps;           // state of the feature maps after frame - 1 (see SalientFeatureMap::saveState)
+};
+
+
+// Binary state file (native endianness, as the container):
+//   'VBMSCKPT'  version  settings  output  frame  nbFrames  offset  width  height  index  maps
+// with the strings and the index prefixed by their size, and each map by its name, rows, cols and type.
+
+class Checkpoint {
+
+public:
+    // written to a temporary file renamed over filename: an interruption keeps the previous checkpoint
+    static bool     write               (const std::string& filename, const CheckpointState& state);
+    static bool     read                (const std::string& filename, CheckpointState& state);
+
+    // the run is complete, the checkpoint must not be resumed
+    static void     remove              (const std::string& filename);
+};
+
+
+#endif
@@ -0,0 +1,235 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "CubemapFlow.h"
+#include <cmath>
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+#include "WorkerPool.h"
+#include <boost/bind.hpp>
+
+#include <gnomonic-all.h>
+
+
+// orientation of the faces: four around the equator, then the two poles
+static const double faceAzimuth[CubemapFlow::NB_FACES]   = { 0, LG_PI / 2, LG_PI, 3 * LG_PI / 2, 0, 0 };
+static const double faceElevation[CubemapFlow::NB_FACES] = { 0, 0, 0, 0, LG_PI / 2, -LG_PI / 2 };
+
+
+// horizontal displacement across the 0/360 degree seam. Same period as libgnomonic: (width - 1) pixels
+static inline double wrapDisplacement(double dx, int width) {
+    if(dx >  width / 2.0) return dx - (width - 1);
+    if(dx < -width / 2.0) return dx + (width - 1);
+    return dx;
+}
+
+
+CubemapFlow::CubemapFlow(const cv::Size& size) : m_size(size) {
+
+    // a face covers 90 degrees: a quarter of the width keeps the resolution of the equator
+    m_faceSize  = std::max(16, size.width / 4);
+    m_margin    = m_faceSize / 16;
+    m_apperture = 2 * atan(static_cast<double>(m_faceSize + 2 * m_margin) / m_faceSize);
+
+    #ifdef GPU_MODE
+        m_compute = cv::cuda::OpticalFlowDual_TVL1::create();
+    #else
+        for(int k = 0 ; k < NB_FACES ; ++k)
+            m_compute[k] = cv::optflow::createOptFlow_DIS();
+    #endif
+
+    initFaces();
+    initBackProjection();
+}
+
+
+void CubemapFlow::initFaces() {
+    int side = m_faceSize + 2 * m_margin;
+
+    for(int k = 0 ; k < NB_FACES ; ++k) {
+        cv::Mat mapX(side, side, CV_32F);
+        cv::Mat mapY(side, side, CV_32F);
+
+        for(int i = 0 ; i < side ; ++i) {
+            float *x = mapX.ptr<float>(i);
+            float *y = mapY.ptr<float>(i);
+
+            for(int j = 0 ; j < side ; ++j) {
+                lg_Real_t eX = 0, eY = 0;
+                lg_gte_apperture_point(&eX, &eY, m_size.width, m_size.height, j, i, side, side, faceAzimuth[k], faceElevation[k], 0, m_apperture);
+
+                if(eX < 0) eX += m_size.width - 1;
+                if(eX >= m_size.width - 1) eX -= m_size.width - 1;
+
+                x[j] = static_cast<float>(eX);
+                y[j] = static_cast<float>(eY);
+            }
+        }
+
+        cv::convertMaps(mapX, mapY, m_faceMap1[k], m_faceMap2[k], CV_16SC2);
+    }
+}
+
+
+void CubemapFlow::initBackProjection() {
+    int side = m_faceSize + 2 * m_margin;
+    const double delta = .5;
+
+    lg_Real_t rotation[NB_FACES][3][3];
+    for(int k = 0 ; k < NB_FACES ; ++k)
+        lg_algebra_e2rrotation(rotation[k], faceAzimuth[k], faceElevation[k], 0);
+
+    m_faceIndex.create(m_size, CV_8U);
+    m_facePoint.create(m_size, CV_32FC2);
+    m_jacobian.create(m_size, CV_32FC4);
+
+    for(int i = 0 ; i < m_size.height ; ++i) {
+        unsigned char *index = m_faceIndex.ptr<unsigned char>(i);
+        cv::Point2f   *point = m_facePoint.ptr<cv::Point2f>(i);
+        cv::Vec4f     *jacob = m_jacobian.ptr<cv::Vec4f>(i);
+
+        for(int j = 0 ; j < m_size.width ; ++j) {
+
+            // direction of the pixel, same convention as libgnomonic
+            double angleX = static_cast<double>(j) / (m_size.width - 1) * 2 * LG_PI;
+            double angleY = (static_cast<double>(i) / (m_size.height - 1) - .5) * LG_PI;
+            double v[3] = { cos(angleY) * cos(angleX), cos(angleY) * sin(angleX), sin(angleY) };
+
+            // the face whose sight is the closest to the pixel
+            int face = 0;
+            double best = -2;
+            for(int k = 0 ; k < NB_FACES ; ++k) {
+                double d = rotation[k][0][0] * v[0] + rotation[k][0][1] * v[1] + rotation[k][0][2] * v[2];
+                if(d > best) {
+                    best = d;
+                    face = k;
+                }
+            }
+
+            lg_Real_t rX = 0, rY = 0;
+            lg_etg_apperture_point(j, i, m_size.width, m_size.height, &rX, &rY, side, side, faceAzimuth[face], faceElevation[face], 0, m_apperture);
+
+            // displacement on the face -> displacement on the equirectangular frame, by central differences
+            lg_Real_t x0, y0, x1, y1;
+            cv::Vec4f J;
+
+            lg_gte_apperture_point(&x0, &y0, m_size.width, m_size.height, rX - delta, rY, side, side, faceAzimuth[face], faceElevation[face], 0, m_apperture);
+            lg_gte_apperture_point(&x1, &y1, m_size.width, m_size.height, rX + delta, rY, side, side, faceAzimuth[face], faceElevation[face], 0, m_apperture);
+            J[0] = static_cast<float>(wrapDisplacement(x1 - x0, m_size.width) / (2 * delta));
+            J[2] = static_cast<float>((y1 - y0) / (2 * delta));
+
+            lg_gte_apperture_point(&x0, &y0, m_size.width, m_size.height, rX, rY - delta, side, side, faceAzimuth[face], faceElevation[face], 0, m_apperture);
+            lg_gte_apperture_point(&x1, &y1, m_size.width, m_size.height, rX, rY + delta, side, side, faceAzimuth[face], faceElevation[face], 0, m_apperture);
+            J[1] = static_cast<float>(wrapDisplacement(x1 - x0, m_size.width) / (2 * delta));
+            J[3] = static_cast<float>((y1 - y0) / (2 * delta));
+
+            index[j] = static_cast<unsigned char>(face);
+            point[j] = cv::Point2f(static_cast<float>(rX), static_cast<float>(rY));
+            jacob[j] = J;
+        }
+    }
+}
+
+
+void CubemapFlow::projectFace(int face, const cv::Mat& frame, cv::Mat& projection) const {
+    cv::remap(frame, projection, m_faceMap1[face], m_faceMap2[face], cv::INTER_LINEAR, cv::BORDER_WRAP);
+}
+
+
+void CubemapFlow::faceFlowJob(int face, const cv::Mat& from, const cv::Mat& to, cv::Mat& fromFace, cv::Mat& toFace, cv::Mat& flow) {
+    if(fromFace.empty())
+        projectFace(face, from, fromFace);
+    projectFace(face, to, toFace);
+
+    #ifdef GPU_MODE
+        cv::cuda::GpuMat gpuFrom(fromFace);
+        cv::cuda::GpuMat gpuTo(toFace);
+        cv::cuda::GpuMat gpuflow;
+        m_compute->calc(gpuFrom, gpuTo, gpuflow);
+        gpuflow.download(flow);
+    #else
+        m_compute[face]->calc(fromFace, toFace, flow);
+    #endif
+}
+
+
+void CubemapFlow::calc(const cv::Mat& from, const cv::Mat& to, cv::Mat& flow) {
+    if(from.size() != m_size || to.size() != m_size) {
+        std::cerr << "[E] CubemapFlow::calc: the frames do not match the size of the cubemap tables" << std::endl;
+        return;
+    }
+
+    std::vector<cv::Mat> fromFaces(NB_FACES), toFaces(NB_FACES), faceFlows(NB_FACES);
+
+    // when the frames are consecutive, the faces of from were computed at the previous call
+    if(!m_lastFrame.empty() && m_lastFrame.data == from.data)
+        fromFaces = m_lastFaces;
+
+    #ifdef GPU_MODE
+        // a single device: the faces are processed one after the other
+        for(int k = 0 ; k < NB_FACES ; ++k)
+            faceFlowJob(k, from, to, fromFaces[k], toFaces[k], faceFlows[k]);
+    #else
+        TaskGroup g;
+        for(int k = 0 ; k < NB_FACES ; ++k)
+            g.run(boost::bind(&CubemapFlow::faceFlowJob, this, k, boost::ref(from), boost::ref(to), boost::ref(fromFaces[k]), boost::ref(toFaces[k]), boost::ref(faceFlows[k])));
+        g.wait();
+    #endif
+
+    m_lastFrame = to;
+    m_lastFaces = toFaces;
+
+    toEquirectangular(faceFlows, flow);
+}
+
+
+void CubemapFlow::toEquirectangular(const std::vector<cv::Mat>& faceFlows, cv::Mat& flow) const {
+    flow.create(m_size, CV_32FC2);
+
+    for(int i = 0 ; i < m_size.height ; ++i) {
+        const unsigned char *index = m_faceIndex.ptr<unsigned char>(i);
+        const cv::Point2f   *point = m_facePoint.ptr<cv::Point2f>(i);
+        const cv::Vec4f     *jacob = m_jacobian.ptr<cv::Vec4f>(i);
+        cv::Point2f         *f     = flow.ptr<cv::Point2f>(i);
+
+        for(int j = 0 ; j < m_size.width ; ++j) {
+            const cv::Mat& faceFlow = faceFlows[index[j]];
+
+            // bilinear sampling of the face flow
+            float x = std::min(std::max(point[j].x, 0.f), static_cast<float>(faceFlow.cols - 1));
+            float y = std::min(std::max(point[j].y, 0.f), static_cast<float>(faceFlow.rows - 1));
+            int x0 = std::min(static_cast<int>(x), faceFlow.cols - 2);
+            int y0 = std::min(static_cast<int>(y), faceFlow.rows - 2);
+            float ax = x - x0;
+            float ay = y - y0;
+
+            const cv::Point2f *r0 = faceFlow.ptr<cv::Point2f>(y0);
+            const cv::Point2f *r1 = faceFlow.ptr<cv::Point2f>(y0 + 1);
+            cv::Point2f d = (1 - ay) * ((1 - ax) * r0[x0] + ax * r0[x0 + 1])
+                          +      ay  * ((1 - ax) * r1[x0] + ax * r1[x0 + 1]);
+
+            const cv::Vec4f& J = jacob[j];
+            f[j] = cv::Point2f(J[0] * d.x + J[1] * d.y, J[2] * d.x + J[3] * d.y);
+        }
+    }
+}
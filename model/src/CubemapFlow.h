@@ -0,0 +1,97 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _CubemapFlow_
+#define _CubemapFlow_
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#ifdef GPU_MODE
+    #include <opencv2/cudaoptflow.hpp>
+#else
+	#ifndef CV_OVERRIDE
+		#define CV_OVERRIDE
+	#endif
+
+    #include <opencv2/optflow.hpp>
+#endif
+
+
+// Dense flow of an equirectangular frame, estimated on the six faces of a cubemap. The faces are
+// rectilinear projections (libgnomonic geometry), without the stretching of the poles, and are
+// processed in parallel. The face flows are then resampled to the equirectangular grid, in pixels
+// of the equirectangular frame.
+//
+// The projection tables only depend on the size of the frame, they are computed once.
+
+class CubemapFlow {
+
+public:
+    static const int                NB_FACES = 6;
+
+private:
+    cv::Size                        m_size;             // equirectangular frame
+    int                             m_faceSize;         // side of a face
+    int                             m_margin;           // overlap with the neighbouring faces, on each side
+    double                          m_apperture;
+
+    // equirectangular -> faces (cv::remap tables)
+    cv::Mat                         m_faceMap1[NB_FACES];
+    cv::Mat                         m_faceMap2[NB_FACES];
+
+    // faces -> equirectangular
+    cv::Mat                         m_faceIndex;        // CV_8U,    face of each equirectangular pixel
+    cv::Mat                         m_facePoint;        // CV_32FC2, position of the pixel on that face
+    cv::Mat                         m_jacobian;         // CV_32FC4, face displacement -> equirectangular displacement
+
+    // faces of the last frame, it is the first frame of the next pair
+    cv::Mat                         m_lastFrame;
+    std::vector<cv::Mat>            m_lastFaces;
+
+#ifdef GPU_MODE
+    cv::Ptr<cv::cuda::DenseOpticalFlow> m_compute;
+#else
+    cv::Ptr<cv::DenseOpticalFlow>   m_compute[NB_FACES];    // one instance per face, an instance is not reentrant
+#endif
+
+
+public:
+    CubemapFlow                     (const cv::Size& size);
+
+    // flow (CV_32FC2) from the gray level frame from to the gray level frame to
+    void            calc            (const cv::Mat& from, const cv::Mat& to, cv::Mat& flow);
+
+    inline const cv::Size& getSize  ()                                  const { return m_size; }
+
+private:
+    void            initFaces       ();
+    void            initBackProjection();
+
+    void            projectFace     (int face, const cv::Mat& frame, cv::Mat& projection) const;
+    void            faceFlowJob     (int face, const cv::Mat& from, const cv::Mat& to, cv::Mat& fromFace, cv::Mat& toFace, cv::Mat& flow);
+    void            toEquirectangular(const std::vector<cv::Mat>& faceFlows, cv::Mat& flow) const;
+};
+
+
+#endif
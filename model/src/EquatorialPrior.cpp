@@ -26,6 +26,7 @@
 #include "EquatorialPrior.h"
 
 #include <opencv2/opencv.hpp>
+#include <boost/thread/mutex.hpp>
 
 
 
@@ -36,31 +37,44 @@
 
 
 
-float faceLine(const cv::Mat &image) {
-	cv::Mat gray;
-	cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-
+// haar cascades, loaded on first use and shared by all the frames and videos
+struct FaceCascades {
 	cv::CascadeClassifier face_cascade;
 	cv::CascadeClassifier faceProfil_cascade;
-	bool faceCascadeEnabled = false;
-	bool faceProfilCascadeEnabled = false;
+	bool faceCascadeEnabled;
+	bool faceProfilCascadeEnabled;
 
-	// ------------------------------------------------------------------------------------------------
-	// init haar cascades framework
+	// the classifiers keep internal buffers: one detection at a time
+	boost::mutex lock;
 
-	if (face_cascade.load("./data/haarcascade_frontalface_alt.xml")) {
-		faceCascadeEnabled = true;
-	}
-	else {
-		std::cerr << "[I] cannot open: ./data/haarcascade_frontalface_alt.xml" << std::endl;
-	}
+	FaceCascades() : faceCascadeEnabled(false), faceProfilCascadeEnabled(false) {
+		if (face_cascade.load("./data/haarcascade_frontalface_alt.xml")) {
+			faceCascadeEnabled = true;
+		}
+		else {
+			std::cerr << "[I] cannot open: ./data/haarcascade_frontalface_alt.xml" << std::endl;
+		}
 
-	if (faceProfil_cascade.load("./data/haarcascade_profileface.xml")) {
-		faceProfilCascadeEnabled = true;
-	}
-	else {
-		std::cerr << "[I] cannot open: ./data/haarcascade_profileface.xml" << std::endl;
+		if (faceProfil_cascade.load("./data/haarcascade_profileface.xml")) {
+			faceProfilCascadeEnabled = true;
+		}
+		else {
+			std::cerr << "[I] cannot open: ./data/haarcascade_profileface.xml" << std::endl;
+		}
 	}
+};
+
+static FaceCascades& faceCascades() {
+	static FaceCascades cascades;
+	return cascades;
+}
+
+
+float faceLine(const cv::Mat &image) {
+	cv::Mat gray;
+	cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+
+	FaceCascades& cascades = faceCascades();
 
 
 	// ------------------------------------------------------------------------------------------------
@@ -68,16 +82,19 @@ float faceLine(const cv::Mat &image) {
 
 	std::list<cv::Rect> allFeatures;
 	std::vector<cv::Rect> faceFeatures;
-	if (faceCascadeEnabled)
-		face_cascade.detectMultiScale(gray, faceFeatures, 2, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(15, 15));
+
+	boost::mutex::scoped_lock lock(cascades.lock);
+	if (cascades.faceCascadeEnabled)
+		cascades.face_cascade.detectMultiScale(gray, faceFeatures, 2, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(15, 15));
 
 	for (size_t i = 0; i < faceFeatures.size(); ++i) {
 		allFeatures.push_back(faceFeatures[i]);
 	}
 
 	faceFeatures.clear();
-	if (faceProfilCascadeEnabled)
-		faceProfil_cascade.detectMultiScale(gray, faceFeatures, 2, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(15, 15));
+	if (cascades.faceProfilCascadeEnabled)
+		cascades.faceProfil_cascade.detectMultiScale(gray, faceFeatures, 2, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(15, 15));
+	lock.unlock();
 
 	for (size_t i = 0; i < faceFeatures.size(); ++i) {
 		allFeatures.push_back(faceFeatures[i]);
@@ -176,34 +193,46 @@ float salientCenter(const cv::Mat& image, int step) {
 }
 
 
-void applyGaussianEquatorialPrior(cv::Mat& image, float gaussianM, float gaussianSD) {
+void gaussianEquatorialWeights(int rows, std::vector<float>& weights, float gaussianM, float gaussianSD) {
+	weights.resize(rows);
 
-	for (int i = 0; i < image.rows; ++i) {
-		float lat = (.5f - static_cast<float>(i) / image.rows) * 180.f;
+	for (int i = 0; i < rows; ++i) {
+		float lat = (.5f - static_cast<float>(i) / rows) * 180.f;
 		float prior = (.01f + .40f * exp(-((lat - gaussianM)*(lat - gaussianM)) / (gaussianSD)) + .75f * exp(-((lat - 100)*(lat - 100)) / (200)) + .75f * exp(-((lat + 90)*(lat + 90)) / (200))) / .41f;
-		prior = std::min(1.f, prior);
+		weights[i] = std::min(1.f, prior);
+	}
+}
 
-		for (int j = 0; j < image.cols; ++j) {
-			image.at<float>(i, j) = prior * image.at<float>(i, j);
-		}
+
+void applyGaussianEquatorialPrior(cv::Mat& image, float gaussianM, float gaussianSD) {
+	std::vector<float> weights;
+	gaussianEquatorialWeights(image.rows, weights, gaussianM, gaussianSD);
+
+	for (int i = 0; i < image.rows; ++i) {
+		image.row(i) *= weights[i];
 	}
 
 }
 
 
 void applyEquatorialPrior(cv::Mat& image, const cv::Mat& colorImageInput) {
-	if(image.empty()) return;
+	FramePyramid pyramid(colorImageInput);
+	applyEquatorialPrior(image, pyramid);
+}
+
 
-	float scaling_factor = static_cast<float>(image.cols) / 1400.f;	// normalize the size of the images
-	cv::Mat colorImage = colorImageInput.clone();
+float equatorialLatitude(const cv::Mat& image, FramePyramid& colorPyramid, int referenceWidth) {
+	float scaling_factor = static_cast<float>(referenceWidth) / 1400.f;	// normalize the size of the images
+	float referenceRows = static_cast<float>(image.rows) * referenceWidth / image.cols;
+	cv::Mat source = colorPyramid.getSource();
 
-	cv::resize(colorImage, colorImage, cv::Size(colorImage.size().width / scaling_factor, colorImage.size().height / scaling_factor));
+	cv::Mat colorImage = colorPyramid.get(cv::Size(source.size().width / scaling_factor, source.size().height / scaling_factor), cv::INTER_LINEAR);
 	float fc = faceLine(colorImage);
-	float slCenter = salientCenter(image);
+	float slCenter = salientCenter(image) / image.rows;
 
 
-	slCenter = std::max(std::min((slCenter - image.rows / 2) / image.rows, 0.1f), -0.1f);
-	slCenter = slCenter * image.rows + image.rows / 2;
+	slCenter = std::max(std::min(slCenter - .5f, 0.1f), -0.1f);
+	slCenter = slCenter * referenceRows + referenceRows / 2;
 	slCenter = (slCenter / scaling_factor + colorImage.rows / 2) / 2;
 
 	if (fc > 0) {
@@ -212,9 +241,14 @@ void applyEquatorialPrior(cv::Mat& image, const cv::Mat& colorImageInput) {
 	}
 
 
-	float equatorialLine = (.5f - slCenter / colorImage.rows) * 180.f;
+	return (.5f - slCenter / colorImage.rows) * 180.f;
+}
 
-	applyGaussianEquatorialPrior(image, equatorialLine);
+
+void applyEquatorialPrior(cv::Mat& image, FramePyramid& colorPyramid) {
+	if(image.empty()) return;
+
+	applyGaussianEquatorialPrior(image, equatorialLatitude(image, colorPyramid, image.cols));
 
 
 	double mn, mx;
@@ -222,5 +256,3 @@ void applyEquatorialPrior(cv::Mat& image, const cv::Mat& colorImageInput) {
 	image = (image - mn) / (mx - mn);
 
 }
-
-
@@ -28,10 +28,18 @@
 #define _EquatorialPrior_
 
 #include <opencv2/core.hpp>
+#include <vector>
+#include "FramePyramid.h"
 
 float salientCenter 				(const cv::Mat& image, int step = 5);
 void applyGaussianEquatorialPrior	(cv::Mat& image, float gaussianM = 0.f, float gaussianSD = 700.f);
 void applyEquatorialPrior			(cv::Mat& image, const cv::Mat& colorImageInput);
+void applyEquatorialPrior			(cv::Mat& image, FramePyramid& colorPyramid);
+
+// pieces of the prior: latitude of the equatorial line, from the faces or the saliency (referenceWidth: width
+// of the map the face detection is tuned for), and the weight of each row
+float equatorialLatitude			(const cv::Mat& image, FramePyramid& colorPyramid, int referenceWidth);
+void gaussianEquatorialWeights		(int rows, std::vector<float>& weights, float gaussianM = 0.f, float gaussianSD = 700.f);
 
 
 #endif
@@ -0,0 +1,270 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+#include "FFmpegVideoReader.h"
+
+#ifdef FFMPEG_MODE
+
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+
+
+FFmpegVideoReader::FFmpegVideoReader() : m_format(NULL), m_codec(NULL), m_frame(NULL), m_packet(NULL), m_sws(NULL), m_stream(-1), m_eof(false), m_decoded(false) {
+
+}
+
+FFmpegVideoReader::~FFmpegVideoReader() {
+    close();
+}
+
+
+bool FFmpegVideoReader::open(const std::string& filename, bool exportMotionVectors) {
+    close();
+
+    if(avformat_open_input(&m_format, filename.c_str(), NULL, NULL) < 0) {
+        std::cerr << "cannot open: " << filename << std::endl;
+        return false;
+    }
+
+    if(avformat_find_stream_info(m_format, NULL) < 0) {
+        std::cerr << "[E] FFmpegVideoReader::open: cannot find stream information in " << filename << std::endl;
+        close();
+        return false;
+    }
+
+#if LIBAVFORMAT_VERSION_MAJOR >= 59
+    const AVCodec *decoder = NULL;
+#else
+    AVCodec *decoder = NULL;
+#endif
+
+    m_stream = av_find_best_stream(m_format, AVMEDIA_TYPE_VIDEO, -1, -1, &decoder, 0);
+    if(m_stream < 0 || decoder == NULL) {
+        std::cerr << "[E] FFmpegVideoReader::open: no video stream in " << filename << std::endl;
+        close();
+        return false;
+    }
+
+    m_codec = avcodec_alloc_context3(decoder);
+    avcodec_parameters_to_context(m_codec, m_format->streams[m_stream]->codecpar);
+
+    AVDictionary *options = NULL;
+    av_dict_set(&options, "threads", "auto", 0);
+    if(exportMotionVectors)
+        av_dict_set(&options, "flags2", "+export_mvs", 0);
+
+    int ret = avcodec_open2(m_codec, decoder, &options);
+    av_dict_free(&options);
+
+    if(ret < 0) {
+        std::cerr << "[E] FFmpegVideoReader::open: cannot open the decoder for " << filename << std::endl;
+        close();
+        return false;
+    }
+
+    m_frame  = av_frame_alloc();
+    m_packet = av_packet_alloc();
+    m_eof    = false;
+    m_decoded = false;
+
+    return true;
+}
+
+
+void FFmpegVideoReader::close() {
+    if(m_sws != NULL)       sws_freeContext(m_sws);
+    if(m_packet != NULL)    av_packet_free(&m_packet);
+    if(m_frame != NULL)     av_frame_free(&m_frame);
+    if(m_codec != NULL)     avcodec_free_context(&m_codec);
+    if(m_format != NULL)    avformat_close_input(&m_format);
+
+    m_sws    = NULL;
+    m_stream = -1;
+}
+
+
+bool FFmpegVideoReader::read() {
+    if(!isOpened()) return false;
+
+    if(m_decoded) {
+        m_decoded = false;
+        return true;
+    }
+
+    while(true) {
+        int ret = avcodec_receive_frame(m_codec, m_frame);
+        if(ret == 0) return true;
+        if(ret != AVERROR(EAGAIN) || m_eof) return false;
+
+        // the decoder needs more data
+        if(av_read_frame(m_format, m_packet) < 0) {
+            avcodec_send_packet(m_codec, NULL);     // flush the frames buffered by the decoder
+            m_eof = true;
+            continue;
+        }
+
+        if(m_packet->stream_index == m_stream)
+            avcodec_send_packet(m_codec, m_packet);
+
+        av_packet_unref(m_packet);
+    }
+}
+
+
+bool FFmpegVideoReader::seek(int frame) {
+    if(!isOpened() || frame < 0) return false;
+
+    AVStream *stream = m_format->streams[m_stream];
+    AVRational rate = stream->avg_frame_rate;
+    if(rate.num == 0 || rate.den == 0)
+        rate = stream->r_frame_rate;
+    if(rate.num == 0 || rate.den == 0) return false;
+
+    // timestamps of the frame and of half a frame, in the time base of the stream
+    int64_t start     = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+    int64_t target    = start + av_rescale_q(frame, av_inv_q(rate), stream->time_base);
+    int64_t halfFrame = av_rescale_q(1, av_inv_q(rate), stream->time_base) / 2;
+
+    if(av_seek_frame(m_format, m_stream, target, AVSEEK_FLAG_BACKWARD) < 0) return false;
+
+    avcodec_flush_buffers(m_codec);
+    m_eof     = false;
+    m_decoded = false;
+
+    // from the keyframe: the frames in-between are decoded, as references, and dropped
+    while(read()) {
+        int64_t timestamp = m_frame->best_effort_timestamp;
+        if(timestamp == AV_NOPTS_VALUE || timestamp + halfFrame >= target) {
+            m_decoded = true;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+float FFmpegVideoReader::getFrameRate() const {
+    if(!isOpened()) return -1;
+
+    AVRational rate = m_format->streams[m_stream]->avg_frame_rate;
+    if(rate.num == 0 || rate.den == 0)
+        rate = m_format->streams[m_stream]->r_frame_rate;
+
+    return static_cast<float>(av_q2d(rate));
+}
+
+
+int FFmpegVideoReader::getFrameCount() const {
+    if(!isOpened()) return -1;
+
+    AVStream *stream = m_format->streams[m_stream];
+    if(stream->nb_frames > 0)
+        return static_cast<int>(stream->nb_frames);
+
+    // not in the container, estimate it from the duration
+    if(m_format->duration != AV_NOPTS_VALUE)
+        return static_cast<int>(m_format->duration * getFrameRate() / AV_TIME_BASE);
+
+    return -1;
+}
+
+
+cv::Size FFmpegVideoReader::getFrameSize() const {
+    if(!isOpened()) return cv::Size();
+
+    return cv::Size(m_codec->width, m_codec->height);
+}
+
+
+bool FFmpegVideoReader::isYUV420() const {
+    return m_frame != NULL && (m_frame->format == AV_PIX_FMT_YUV420P || m_frame->format == AV_PIX_FMT_YUVJ420P);
+}
+
+
+cv::Mat FFmpegVideoReader::getPlane(int plane) const {
+    if(!isYUV420() || plane < 0 || plane > 2) return cv::Mat();
+
+    int width  = plane == 0 ? m_frame->width  : (m_frame->width  + 1) / 2;
+    int height = plane == 0 ? m_frame->height : (m_frame->height + 1) / 2;
+
+    return cv::Mat(height, width, CV_8UC1, m_frame->data[plane], m_frame->linesize[plane]);
+}
+
+
+void FFmpegVideoReader::toBGR(cv::Mat& bgr, const cv::Size& size) {
+    if(m_frame == NULL || m_frame->width <= 0) {
+        bgr = cv::Mat();
+        return;
+    }
+
+    cv::Size dstSize = size.area() > 0 ? size : cv::Size(m_frame->width, m_frame->height);
+
+    m_sws = sws_getCachedContext(m_sws, m_frame->width, m_frame->height, static_cast<AVPixelFormat>(m_frame->format),
+                                 dstSize.width, dstSize.height, AV_PIX_FMT_BGR24, SWS_AREA, NULL, NULL, NULL);
+
+    bgr.create(dstSize, CV_8UC3);
+
+    uint8_t *dstData[4]  = { bgr.data, NULL, NULL, NULL };
+    int      dstStride[4] = { static_cast<int>(bgr.step), 0, 0, 0 };
+    sws_scale(m_sws, m_frame->data, m_frame->linesize, 0, m_frame->height, dstData, dstStride);
+}
+
+
+bool FFmpegVideoReader::toI420(cv::Mat& i420, const cv::Size& size) const {
+    if(!isYUV420()) return false;
+
+    // I420 requires even dimensions
+    int w = size.width & ~1;
+    int h = size.height & ~1;
+    if(w <= 0 || h <= 0) return false;
+
+    i420.create(h * 3 / 2, w, CV_8UC1);
+
+    // views on the planes of the packed frame, the resize writes directly into them
+    cv::Mat y(h, w, CV_8UC1, i420.data);
+    cv::Mat u(h / 2, w / 2, CV_8UC1, i420.data + w * h);
+    cv::Mat v(h / 2, w / 2, CV_8UC1, i420.data + w * h + (w / 2) * (h / 2));
+
+    cv::resize(getPlane(0), y, y.size(), 0, 0, cv::INTER_AREA);
+    cv::resize(getPlane(1), u, u.size(), 0, 0, cv::INTER_AREA);
+    cv::resize(getPlane(2), v, v.size(), 0, 0, cv::INTER_AREA);
+
+    return true;
+}
+
+
+const AVMotionVector* FFmpegVideoReader::getMotionVectors(int& count) const {
+    count = 0;
+    if(m_frame == NULL) return NULL;
+
+    AVFrameSideData *sideData = av_frame_get_side_data(m_frame, AV_FRAME_DATA_MOTION_VECTORS);
+    if(sideData == NULL) return NULL;
+
+    count = static_cast<int>(sideData->size / sizeof(AVMotionVector));
+    return reinterpret_cast<const AVMotionVector*>(sideData->data);
+}
+
+
+#endif
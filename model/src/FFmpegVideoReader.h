@@ -0,0 +1,90 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FFmpegVideoReader_
+#define _FFmpegVideoReader_
+
+#ifdef FFMPEG_MODE
+
+#include <opencv2/core.hpp>
+#include <string>
+
+extern "C" {
+    #include <libavformat/avformat.h>
+    #include <libavcodec/avcodec.h>
+    #include <libavutil/motion_vector.h>
+    #include <libswscale/swscale.h>
+}
+
+
+// Thin wrapper around libavformat/libavcodec, giving access to what OpenCV's VideoCapture hides:
+// the decoded YUV planes and the motion vectors of the bitstream.
+
+class FFmpegVideoReader {
+
+    AVFormatContext            *m_format;
+    AVCodecContext             *m_codec;
+    AVFrame                    *m_frame;
+    AVPacket                   *m_packet;
+    SwsContext                 *m_sws;
+    int                         m_stream;
+    bool                        m_eof;
+    bool                        m_decoded;      // a frame decoded by seek, returned by the next read
+
+
+public:
+    FFmpegVideoReader           ();
+    virtual ~FFmpegVideoReader  ();
+
+    bool    open                (const std::string& filename, bool exportMotionVectors = false);
+    void    close               ();
+    inline bool
+            isOpened            ()                                                  const { return m_codec != NULL; }
+
+    // decode the next frame, false at the end of the stream
+    bool    read                ();
+
+    // the next read returns frame: seeks to the keyframe preceding it, then decodes up to it.
+    // False if the stream cannot seek, the position is then undefined
+    bool    seek                (int frame);
+
+    float   getFrameRate        ()                                                  const;
+    int     getFrameCount       ()                                                  const;
+    cv::Size getFrameSize       ()                                                  const;
+
+
+    // accessors on the last decoded frame
+    bool    isYUV420            ()                                                  const;
+    cv::Mat getPlane            (int plane)                                         const;   // view on the Y, U or V plane
+    void    toBGR               (cv::Mat& bgr, const cv::Size& size = cv::Size());            // converted and scaled in one pass
+    bool    toI420              (cv::Mat& i420, const cv::Size& size)               const;   // planes scaled and packed, 8 bits 4:2:0 only
+
+    const AVMotionVector*
+            getMotionVectors    (int& count)                                        const;
+
+};
+
+
+#endif
+
+#endif
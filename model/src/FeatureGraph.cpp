@@ -0,0 +1,138 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "FeatureGraph.h"
+#include "MemoryAccounting.h"
+#include <chrono>
+#include <iomanip>
+
+
+// outputs of the previous frames kept, a frame is only requested by the frames in-flight of the pipeline
+static const int HISTORY = 2;
+
+
+cv::Mat FeatureGraph::get(int frame, const std::string& node, const std::string& consumer, const boost::function<cv::Mat ()>& compute) {
+    Key key(frame, node);
+
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+
+        if(!consumer.empty())
+            m_edges.insert(std::make_pair(consumer, node));
+
+        // being computed by another thread: wait for it
+        std::map<Key, Output>::iterator it = m_outputs.find(key);
+        while(it != m_outputs.end() && !it->second.done) {
+            m_computed.wait(lock);
+            it = m_outputs.find(key);
+        }
+
+        if(it != m_outputs.end()) {
+            ++m_stats[node].nbHits;
+            return it->second.value;
+        }
+
+        if(frame > m_lastFrame) {
+            m_lastFrame = frame;
+            std::map<Key, Output>::iterator last = m_outputs.lower_bound(Key(frame - HISTORY, std::string()));
+            for(it = m_outputs.begin() ; it != last ; ) {
+                if(it->second.done) m_outputs.erase(it++);
+                else ++it;
+            }
+        }
+
+        Output& output = m_outputs[key];
+        output.done = false;
+    }
+
+    using namespace std::chrono;
+    high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+    cv::Mat value;
+    try {
+        value = compute();
+    } catch(...) {
+        // the consumers waiting for the node compute it again
+        boost::mutex::scoped_lock lock(m_lock);
+        m_outputs.erase(key);
+        m_computed.notify_all();
+        throw;
+    }
+
+    duration<double> time_span = duration_cast<duration<double>>(high_resolution_clock::now() - t1);
+
+    boost::mutex::scoped_lock lock(m_lock);
+    Output& output = m_outputs[key];
+    output.value = value;
+    output.done = true;
+
+    NodeStats& stats = m_stats[node];
+    ++stats.nbComputed;
+    stats.seconds += time_span.count();
+
+    m_computed.notify_all();
+    return value;
+}
+
+
+void FeatureGraph::clear() {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    m_outputs.clear();
+    m_stats.clear();
+    m_edges.clear();
+    m_lastFrame = -1;
+}
+
+
+void FeatureGraph::collectMemory(MemoryReport& report) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    for(std::map<Key, Output>::const_iterator it = m_outputs.begin() ; it != m_outputs.end() ; ++it)
+        report.add("graph." + it->first.second, it->second.value);
+}
+
+
+void FeatureGraph::writeDot(std::ostream& out) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    out << "digraph features {" << std::endl;
+    out << "    rankdir=BT;" << std::endl;
+    out << "    node [shape=box];" << std::endl;
+
+    // the time of a node includes the time of the nodes it computed first
+    for(std::map<std::string, NodeStats>::const_iterator it = m_stats.begin() ; it != m_stats.end() ; ++it) {
+        const NodeStats& stats = it->second;
+        double average = stats.nbComputed > 0 ? 1000 * stats.seconds / stats.nbComputed : 0;
+
+        out << "    \"" << it->first << "\" [label=\"" << it->first << "\\n"
+            << std::fixed << std::setprecision(1) << average << " ms x " << stats.nbComputed
+            << ", " << stats.nbHits << " reused\"];" << std::endl;
+    }
+
+    for(std::set< std::pair<std::string, std::string> >::const_iterator it = m_edges.begin() ; it != m_edges.end() ; ++it) {
+        out << "    \"" << it->first << "\" -> \"" << it->second << "\";" << std::endl;
+    }
+
+    out << "}" << std::endl;
+}
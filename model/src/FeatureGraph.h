@@ -0,0 +1,92 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FeatureGraph_
+#define _FeatureGraph_
+
+#include <opencv2/core.hpp>
+#include <boost/function.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <map>
+#include <set>
+#include <string>
+#include <ostream>
+
+class MemoryReport;
+
+
+// Intermediate results of one engine (flow, classifier probabilities, feature maps), memoized per frame.
+// A node is identified by its name and computed at most once per frame, whoever requests it first; the
+// other consumers, possibly on other threads, get the same result. The outputs are shared: read only.
+//
+// The consumers are recorded as the edges of the graph, with the time spent in each node, to be dumped
+// as a Graphviz file.
+
+class FeatureGraph {
+
+    struct Output {
+        cv::Mat                     value;
+        bool                        done;
+    };
+
+    struct NodeStats {
+        int                         nbComputed;
+        int                         nbHits;
+        double                      seconds;
+    };
+
+    typedef std::pair<int, std::string> Key;
+
+    std::map<Key, Output>                       m_outputs;
+    std::map<std::string, NodeStats>            m_stats;
+    std::set< std::pair<std::string, std::string> >
+                                                m_edges;        // consumer -> node
+    int                                         m_lastFrame;
+
+    boost::mutex                                m_lock;
+    boost::condition_variable                   m_computed;
+
+public:
+    FeatureGraph                    () : m_lastFrame(-1) {}
+
+    // output of node for frame, computed by compute if not already available. The consumer is the node
+    // requesting it, empty for the engine itself
+    cv::Mat     get                 (int frame, const std::string& node, const std::string& consumer, const boost::function<cv::Mat ()>& compute);
+
+    // forget the outputs and the statistics, before processing another video
+    void        clear               ();
+
+    // the outputs kept, owned by "graph." followed by the name of their node
+    void        collectMemory       (MemoryReport& report);
+
+    // the nodes with their average computation time, and their dependencies
+    void        writeDot            (std::ostream& out);
+
+private:
+    FeatureGraph                    (const FeatureGraph&);
+    FeatureGraph& operator=         (const FeatureGraph&);
+};
+
+
+#endif
@@ -0,0 +1,131 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "FlowBenchmark.h"
+
+#ifdef FFMPEG_MODE
+
+#include "FlowGrabber.h"
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+
+namespace {
+
+    // grid used by MotionSourceFeatureMap when aggregating the flow
+    const cv::Size kGridSize(42, 21);
+
+    struct FlowError {
+        double epe;
+        double angular;
+        int    n;
+
+        FlowError() : epe(0), angular(0), n(0) {}
+    };
+
+    void accumulateError(const cv::Mat& estimated, const cv::Mat& reference, FlowError& err) {
+        for(int i = 0 ; i < reference.rows ; ++i) {
+            const cv::Point2f *e = estimated.ptr<cv::Point2f>(i);
+            const cv::Point2f *r = reference.ptr<cv::Point2f>(i);
+            for(int j = 0 ; j < reference.cols ; ++j) {
+                cv::Point2f d = e[j] - r[j];
+                err.epe += std::sqrt(d.dot(d));
+
+                double num = 1.0 + e[j].dot(r[j]);
+                double den = std::sqrt(1.0 + e[j].dot(e[j])) * std::sqrt(1.0 + r[j].dot(r[j]));
+                err.angular += std::acos(std::max(-1.0, std::min(1.0, num / den)));
+            }
+        }
+        err.n += reference.rows * reference.cols;
+    }
+
+    void printError(const std::string& name, const FlowError& err) {
+        if(err.n == 0) return;
+        std::cout << std::setw(12) << name
+                  << "   EPE: "   << std::setw(8) << err.epe / err.n
+                  << "   AE: "    << std::setw(8) << err.angular / err.n * 180.0 / CV_PI << " deg" << std::endl;
+    }
+}
+
+
+int runFlowBenchmark(const std::string& video, int firstFrame, int nbFrames) {
+    VideoFlowGrabber dense(video);
+    MotionVectorFlowGrabber vectors(video);
+
+    if(dense.getFrameCount() <= 0) {
+        std::cerr << "[E] runFlowBenchmark: cannot open " << video << std::endl;
+        return -1;
+    }
+
+    firstFrame = std::max(1, firstFrame);
+    int lastFrame = std::min(dense.getFrameCount(), firstFrame + nbFrames);
+
+    FlowError full, grid;
+    double denseTime = 0, mvTime = 0;
+    int frames = 0;
+
+    for(int f = firstFrame ; f < lastFrame ; ++f) {
+        auto t0 = std::chrono::high_resolution_clock::now();
+        Flow reference = dense.getFrame(f);
+        auto t1 = std::chrono::high_resolution_clock::now();
+        Flow estimated = vectors.getFrame(f);
+        auto t2 = std::chrono::high_resolution_clock::now();
+
+        if(reference.frame.empty() || estimated.frame.empty()) break;
+
+        denseTime += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        mvTime    += std::chrono::duration<double, std::milli>(t2 - t1).count();
+
+        if(estimated.frame.size() != reference.frame.size())
+            cv::resize(estimated.frame, estimated.frame, reference.frame.size(), 0, 0, cv::INTER_NEAREST);
+
+        accumulateError(estimated.frame, reference.frame, full);
+
+        cv::Mat refGrid, estGrid;
+        cv::resize(reference.frame, refGrid, kGridSize, 0, 0, cv::INTER_AREA);
+        cv::resize(estimated.frame, estGrid, kGridSize, 0, 0, cv::INTER_AREA);
+        accumulateError(estGrid, refGrid, grid);
+
+        ++frames;
+    }
+
+    if(frames == 0) {
+        std::cerr << "[E] runFlowBenchmark: no frame could be compared." << std::endl;
+        return -1;
+    }
+
+    std::cout << "--------------------------------------------------------------------------------\n";
+    std::cout << " Motion vectors vs " << dense.getFlowAlgorithm() << " on " << frames << " frames of " << video << "\n";
+    std::cout << "--------------------------------------------------------------------------------\n";
+    printError("flow", full);
+    printError("grid 42x21", grid);
+    std::cout << std::setw(12) << "time" << "   dense: " << denseTime / frames << " ms/frame   motion vectors: " << mvTime / frames << " ms/frame" << std::endl;
+
+    return 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FlowBenchmark_
+#define _FlowBenchmark_
+
+#ifdef FFMPEG_MODE
+
+#include <string>
+
+
+// Compare the motion vector flow (MotionVectorFlowGrabber) against the dense DIS flow (VideoFlowGrabber)
+// on nbFrames frames of the video starting at firstFrame. Reports the end point errors at the flow
+// resolution and on the coarse grid used by the motion source model, as well as the timings.
+// Returns 0, or -1 if the video cannot be read: the exit status of the tool.
+
+int runFlowBenchmark(const std::string& video, int firstFrame = 1, int nbFrames = 100);
+
+
+#endif
+
+#endif
@@ -26,11 +26,14 @@
 
 #include <opencv2/imgproc.hpp>
 #include "FlowIO.h"
+#include "MemoryAccounting.h"
+#include <map>
+#include <boost/thread/mutex.hpp>
 
 void void_logger(const std::string& ) { }
 
 FlowClassier::FlowClassier(const std::string& modelPath, int height, int width) : 
-            m_kerasModel(fdeep::load_model(modelPath, true, void_logger)) {
+            m_kerasModel(fdeep::load_model(modelPath, true, void_logger)), m_footprint(0) {
                 
     m_height = height;
     m_width = width;
@@ -38,6 +41,24 @@ FlowClassier::FlowClassier(const std::string& modelPath, int height, int width)
 }
 
 
+boost::shared_ptr<FlowClassier> FlowClassier::load(const std::string &modelPath) {
+    static std::map< std::string, boost::shared_ptr<FlowClassier> > models;
+    static boost::mutex lock;
+
+    boost::mutex::scoped_lock scopedLock(lock);
+    boost::shared_ptr<FlowClassier>& model = models[modelPath];
+    if(!model) {
+        // fdeep does not tell the size of the model: the growth of the process while loading it
+        size_t resident = MemoryAccounting::residentBytes();
+        model = boost::shared_ptr<FlowClassier>(new FlowClassier(modelPath));
+        size_t loaded   = MemoryAccounting::residentBytes();
+        model->m_footprint = loaded > resident ? loaded - resident : 0;
+    }
+
+    return model;
+}
+
+
 std::vector<float> FlowClassier::predict(const cv::Mat& flow) const {
 
     if(flow.empty()) {
@@ -27,6 +27,7 @@
 
 #include <fdeep/fdeep.hpp>
 #include <opencv2/core.hpp>
+#include <boost/shared_ptr.hpp>
 
 
 class FlowClassier {
@@ -36,12 +37,21 @@ private:
     int                 m_width;
 
     fdeep::model        m_kerasModel;
+    size_t              m_footprint;        // resident memory taken by the loading of the model
 
 
 public:
     FlowClassier(const std::string &modelPath, int height = 45, int width = 80);
     std::vector<float> predict(const cv::Mat& flow) const;
 
+    inline cv::Size getInputSize() const { return cv::Size(m_width, m_height); }
+
+    // bytes of the weights (measured when loading) and of the input tensor
+    inline size_t   getMemoryUsage() const { return m_footprint + 2 * m_width * m_height * sizeof(float); }
+
+    // the model of modelPath, loaded once and shared by all the engines of the process (predict is const)
+    static boost::shared_ptr<FlowClassier> load(const std::string &modelPath);
+
 
 } ;
 
@@ -23,28 +23,111 @@
 
 #include "FlowGrabber.h"
 #include "FlowIO.h"
+#include "MemoryAccounting.h"
+#include "Trace.h"
 #include <iostream>
+#include <cmath>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
 
-FlowManager  *FlowManager::m_This = NULL;
 
+// downscaling of the frames of VideoFlowGrabber
+static const int DEFAULT_SCALING = 2;
 
-FlowManager *FlowManager::get() {
-    if(m_This == NULL) m_This = new FlowManager();
+// frames to skip from which seeking to a keyframe is faster than decoding them (resumed runs, --frame)
+static const int SEEK_MIN_FRAMES = 100;
 
-    return m_This;
+
+cv::Mat Flow::resizedFrame(const cv::Size& size, int interpolation) const {
+    if(flowPyramid) return flowPyramid->get(size, interpolation);
+
+    cv::Mat resized;
+    if(!frame.empty()) cv::resize(frame, resized, size, 0, 0, interpolation);
+    return resized;
 }
 
 
-Flow FlowManager::getFrame(int frame) {
+cv::Mat Flow::resizedColor(const cv::Size& size, int interpolation) const {
+    if(colorPyramid) return colorPyramid->get(size, interpolation);
+
+    cv::Mat resized;
+    if(hasColor()) cv::resize(getColor(), resized, size, 0, 0, interpolation);
+    return resized;
+}
+
+
+cv::Mat Flow::getColor() const {
+    if(!color.empty() || yuv.empty()) return color;
+
+    // converted once, by the pyramid shared between the copies of the frame
+    if(colorPyramid) return colorPyramid->getSource();
+
+    cv::Mat bgr;
+    cv::cvtColor(yuv, bgr, cv::COLOR_YUV2BGR_I420);
+    return bgr;
+}
+
+
+cv::Size Flow::getColorSize() const {
+    if(!yuv.empty()) return cv::Size(yuv.cols, yuv.rows * 2 / 3);
+
+    return color.size();
+}
+
+
+void Flow::collectMemory(MemoryReport& report, const std::string& owner) const {
+    report.add(owner, frame);
+    report.add(owner, color);
+    report.add(owner, flowProb);
+    report.add(owner, yuv);
+
+    if(flowPyramid)     flowPyramid->collectMemory(report, owner);
+    if(colorPyramid)    colorPyramid->collectMemory(report, owner);
+}
+
+
+bool FlowManager::findCached(int frame, Flow& flow) {
+    boost::mutex::scoped_lock lock(m_cacheLock);
+
     for(std::list<Flow>::iterator it = m_cache.begin() ; it != m_cache.end() ; ++it) {
-        if(it->frameNumber == frame) return *it;
+        if(it->frameNumber == frame) {
+            flow = *it;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+Flow FlowManager::getFrame(int frame) {
+    // the cache is indexed by the frames the grabber returns: the frame 0 of a video is its frame 1
+    {
+        boost::mutex::scoped_lock lock(m_cacheLock);
+        if(m_grabber) frame = m_grabber->sourceFrame(frame);
     }
 
+    Flow flow;
+    if(findCached(frame, flow)) return flow;
+
+    // the grabber reads the video sequentially: one frame is produced at a time. The cached
+    // frames stay available meanwhile
+    boost::mutex::scoped_lock grabLock(m_grabLock);
+    if(findCached(frame, flow)) return flow;
+
     if(!m_grabber) return Flow();
 
+    TraceScope trace("grab", frame);
 
-    m_cache.push_back(m_grabber->getFrame(frame));
+    flow = m_grabber->getFrame(frame);
+    flow.flowPyramid  = boost::shared_ptr<FramePyramid>(new FramePyramid(flow.frame));
+    if(flow.color.empty() && !flow.yuv.empty())
+        flow.colorPyramid = boost::shared_ptr<FramePyramid>(new FramePyramid(flow.yuv, cv::COLOR_YUV2BGR_I420));
+    else
+        flow.colorPyramid = boost::shared_ptr<FramePyramid>(new FramePyramid(flow.color));
+
+    boost::mutex::scoped_lock lock(m_cacheLock);
+    m_cache.push_back(flow);
     if(m_cache.size() > m_cacheSize) {
         m_cache.pop_front();
     }
@@ -53,23 +136,60 @@ Flow FlowManager::getFrame(int frame) {
 
 }
 
+void FlowManager::collectMemory(MemoryReport& report) {
+    boost::mutex::scoped_lock lock(m_cacheLock);
+
+    for(std::list<Flow>::const_iterator it = m_cache.begin() ; it != m_cache.end() ; ++it)
+        it->collectMemory(report, "flow.cache");
+}
+
 float FlowManager::getFrameRate() {
+    {
+        boost::mutex::scoped_lock lock(m_cacheLock);
+        if(m_frameRate > 0) return m_frameRate;
+    }
+
+    boost::mutex::scoped_lock grabLock(m_grabLock);
     if(!m_grabber) return 30.0;
 
-    return m_grabber->getFrameRate();
+    // queried for every frame by the temporal prior
+    float frameRate = m_grabber->getFrameRate();
+
+    boost::mutex::scoped_lock lock(m_cacheLock);
+    m_frameRate = frameRate;
+    return m_frameRate;
+}
+
+void FlowManager::setFlowQuality(int scalingFactor, int flowStride) {
+    boost::mutex::scoped_lock grabLock(m_grabLock);
+    if(m_grabber) m_grabber->setQuality(scalingFactor, flowStride);
 }
 
 cv::Size FlowManager::getSourceFrameSize() {
+    boost::mutex::scoped_lock grabLock(m_grabLock);
 	return m_grabber->getSourceFrameSize();
 }
 
 
 
+FileFlowGrabber::FileFlowGrabber(const std::vector<std::string> &filelist, const std::string& colorImgPath) : m_filelist(filelist), m_colorImagePath(colorImgPath) {
+
+    // a single flow container holds all the frames
+    if(m_filelist.size() == 1 && isFlowContainer(m_filelist[0])) {
+        m_container = boost::shared_ptr<FlowContainer>(new FlowContainer());
+        if(!m_container->open(m_filelist[0]))
+            m_container.reset();
+    }
+}
+
+
 Flow FileFlowGrabber::getFrame(int frame) {    
 	Flow flow;
 
 	flow.frameNumber = frame;
-	if(frame >= 0 && frame < static_cast<int>(m_filelist.size()))
+	if(m_container)
+		flow.frame = m_container->getFrame(frame);
+	else if(frame >= 0 && frame < static_cast<int>(m_filelist.size()))
 		flow.frame = readFlow(m_filelist[frame]);
 
     if(!m_colorImagePath.empty())
@@ -83,8 +203,30 @@ cv::Size FileFlowGrabber::getSourceFrameSize() {
 }
 
 
-VideoFlowGrabber::VideoFlowGrabber(const std::string& filename) {
+VideoFlowGrabber::VideoFlowGrabber(const std::string& filename) : m_nativeYUV(false), m_filename(filename), m_flowStride(1), m_flowMode(DenseFlow), m_gridWidth(84), m_projection(EquirectangularProjection), m_nbTiles(4), m_tileOverlap(32) {
+    init();
+
+#ifdef FFMPEG_MODE
+    // decode with FFmpeg to get the Y plane directly, OpenCV is the fallback
+    m_nativeYUV = m_reader.open(filename);
+    if(m_nativeYUV) return;
+#endif
+
+    m_capture.open(filename);
+    if(!m_capture.isOpened()) {
+        std::cerr << "cannot open: " << filename << std::endl;
+        return ;
+    } 
+
+}
+
+
+VideoFlowGrabber::VideoFlowGrabber() : m_nativeYUV(false), m_flowStride(1), m_flowMode(DenseFlow), m_gridWidth(84), m_projection(EquirectangularProjection), m_nbTiles(4), m_tileOverlap(32) {
+    init();
+}
+
 
+void VideoFlowGrabber::init() {
     #ifdef GPU_MODE
         m_compute = cv::cuda::OpticalFlowDual_TVL1::create();
     #else
@@ -94,55 +236,256 @@ VideoFlowGrabber::VideoFlowGrabber(const std::string& filename) {
     #endif
 
 
-    m_capture.open(filename);
-    if(!m_capture.isOpened()) {
-        std::cerr << "cannot open: " << filename << std::endl;
-        return ;
-    } 
-
     m_curFrame = 0;
-    m_scalingFactor = 2; // 2
+    m_scalingFactor = DEFAULT_SCALING;
+}
+
 
+bool VideoFlowGrabber::isOpened() const {
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) return m_reader.isOpened();
+#endif
+
+    return m_capture.isOpened();
 }
 
 
 int VideoFlowGrabber::getFrameCount() {
-    if(!m_capture.isOpened()) {
+    if(!isOpened()) {
 		std::cerr << "[I] VideoFlowGrabber::getFrameCount: No file was open, cannot get the number of frames! " << std::endl;
         return -1;
     }
 
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) return m_reader.getFrameCount();
+#endif
+
     return m_capture.get(cv::CAP_PROP_FRAME_COUNT);
 }
 
 
 float VideoFlowGrabber::getFrameRate() {
-    if(!m_capture.isOpened()) {
+    if(!isOpened()) {
         std::cerr << "[I] VideoFlowGrabber::getFrameRate: No file was open, cannot get a frame rate! " << std::endl;
         return -1;
     }
 
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) return m_reader.getFrameRate();
+#endif
+
     return m_capture.get(cv::CAP_PROP_FPS);
 }
 
 
 cv::Size VideoFlowGrabber::getSourceFrameSize() {
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) return m_reader.getFrameSize();
+#endif
+
 	return cv::Size(m_capture.get(cv::CAP_PROP_FRAME_WIDTH), m_capture.get(cv::CAP_PROP_FRAME_HEIGHT));
 }
 
-Flow VideoFlowGrabber::getFrame(int frame) {
 
-    cv::Mat frame2;
-    cv::Mat flow;
-    cv::Mat colorFrame;
+bool VideoFlowGrabber::seek(int frame) {
+    TraceScope trace("seek", frame);
+
+    bool done = false;
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) {
+        done = m_reader.seek(frame);
+
+        // the position of the reader is lost: restart from the beginning
+        if(!done) {
+            m_reader.open(m_filename);
+            m_curFrame = 0;
+            m_frame = cv::Mat();
+        }
+    } else
+#endif
+    // the FFmpeg backend of OpenCV seeks to the preceding keyframe and decodes up to the frame
+    if(m_capture.isOpened())
+        done = m_capture.set(cv::CAP_PROP_POS_FRAMES, frame);
+
+    if(done) {
+        m_curFrame = frame;
+        m_frame = cv::Mat();
+    }
 
+    return done;
+}
+
+
+bool VideoFlowGrabber::readFrame(cv::Mat& color, cv::Mat& yuv) {
+    TraceScope trace("decode");
+
+#ifdef FFMPEG_MODE
+    if(m_nativeYUV) {
+        if(!m_reader.read()) return false;
+
+        // streams which are not 8 bits 4:2:0 are converted by swscale
+        cv::Size size = m_reader.getFrameSize() / m_scalingFactor;
+        if(!m_reader.toI420(yuv, size))
+            m_reader.toBGR(color, size);
+
+        return true;
+    }
+#endif
+
+    cv::Mat frame;
+    m_capture >> frame;
+    if(frame.empty()) return false;
+
+    cv::resize(frame, color, frame.size() / m_scalingFactor);
+    return true;
+}
+
+
+// gray level image used for the flow: a view on the Y plane of I420 frames
+static cv::Mat luma(const cv::Mat& color, const cv::Mat& yuv) {
+    if(!yuv.empty()) return yuv.rowRange(0, yuv.rows * 2 / 3);
+
+    cv::Mat gray;
+    cv::cvtColor(color, gray, cv::COLOR_BGR2GRAY);
+    return gray;
+}
+
+
+std::string VideoFlowGrabber::getFlowAlgorithm() const {
     #ifdef GPU_MODE
-        cv::cuda::GpuMat gpuframe2;
+        std::string algorithm = "tvl1";
+    #else
+        std::string algorithm = "dis";
+    #endif
+
+    // the height of the grid is derived from the video, the width is enough to identify it
+    if(m_flowMode == GridFlow)
+        algorithm = "lk" + std::to_string(m_gridWidth);
+    else if(m_projection == CubemapProjection)
+        algorithm += "-cube";
+    else if(m_projection == TiledProjection)
+        algorithm += "-t" + std::to_string(m_nbTiles) + "o" + std::to_string(m_tileOverlap);
+
+    if(m_flowStride > 1)
+        algorithm += "-s" + std::to_string(m_flowStride);
+
+    // the luma of the decoder differs slightly from the gray level of the BGR frame
+    if(m_nativeYUV)
+        algorithm += "-y";
+
+    return algorithm;
+}
+
+
+cv::Size VideoFlowGrabber::getFlowSize() {
+    cv::Size size = getSourceFrameSize() / m_scalingFactor;
+
+    if(m_flowMode == GridFlow && size.width > 0)
+        return cv::Size(m_gridWidth, std::max(1, static_cast<int>(round(static_cast<float>(m_gridWidth) * size.height / size.width))));
+
+    return size;
+}
+
+
+void VideoFlowGrabber::setQuality(int scalingFactor, int flowStride) {
+    if(m_store) return;
+
+    m_scalingFactor = std::max(1, scalingFactor);
+    setFlowStride(flowStride);
+}
+
+
+bool VideoFlowGrabber::enableFlowStore(const std::string& directory) {
+    if(!isOpened()) return false;
+
+    if(m_flowMode == NoFlow) {
+        std::cerr << "[I] VideoFlowGrabber::enableFlowStore: the model does not use the flow, the store is not used." << std::endl;
+        return false;
+    }
+
+    m_store = boost::shared_ptr<FlowStore>(new FlowStore());
+    if(!m_store->open(directory, m_filename, m_scalingFactor, getFlowAlgorithm(), getFrameCount(), getFlowSize())) {
+        m_store.reset();
+        return false;
+    }
+
+    std::cout << "[I] Flow store: " << m_store->getFilename() << std::endl;
+    return true;
+}
+
+void VideoFlowGrabber::computeFlow(const cv::Mat& from, const cv::Mat& to, cv::Mat& flow) {
+    if(m_flowMode == GridFlow) {
+        computeGridFlow(from, to, flow);
+        return;
+    }
+
+    if(m_projection == CubemapProjection) {
+        if(!m_cubemap || m_cubemap->getSize() != from.size())
+            m_cubemap = boost::shared_ptr<CubemapFlow>(new CubemapFlow(from.size()));
+
+        m_cubemap->calc(from, to, flow);
+        return;
+    }
+
+    if(m_projection == TiledProjection) {
+        if(!m_tiled || m_tiled->getNbTiles() != m_nbTiles || m_tiled->getOverlap() != m_tileOverlap)
+            m_tiled = boost::shared_ptr<TiledFlow>(new TiledFlow(m_nbTiles, m_tileOverlap));
+
+        m_tiled->calc(from, to, flow);
+        return;
+    }
+
+    #ifdef GPU_MODE
+        cv::cuda::GpuMat gpuFrom(from);
+        cv::cuda::GpuMat gpuTo(to);
         cv::cuda::GpuMat gpuflow;
+        m_compute->calc(gpuFrom, gpuTo, gpuflow);
+        gpuflow.download(flow); 
+    #else
+        m_compute->calc(from, to, flow); 
     #endif
+}
+
+
+void VideoFlowGrabber::computeGridFlow(const cv::Mat& from, const cv::Mat& to, cv::Mat& flow) {
+    cv::Size grid = getFlowSize();
+
+    // track the center of each cell of the grid
+    if(static_cast<int>(m_gridPoints.size()) != grid.area() || m_gridFrameSize != from.size()) {
+        m_gridFrameSize = from.size();
+
+        float stepX = static_cast<float>(from.cols) / grid.width;
+        float stepY = static_cast<float>(from.rows) / grid.height;
+
+        m_gridPoints.clear();
+        for(int i = 0 ; i < grid.height ; ++i) {
+            for(int j = 0 ; j < grid.width ; ++j) {
+                m_gridPoints.push_back(cv::Point2f((j + .5f) * stepX, (i + .5f) * stepY));
+            }
+        }
+    }
+
+    std::vector<cv::Point2f> tracked;
+    std::vector<unsigned char> status;
+    std::vector<float> err;
+    cv::calcOpticalFlowPyrLK(from, to, m_gridPoints, tracked, status, err, cv::Size(21, 21), 3);
+
+    // lost points are considered as static
+    flow.create(grid, CV_32FC2);
+    for(int i = 0 ; i < grid.height ; ++i) {
+        cv::Point2f *f = flow.ptr<cv::Point2f>(i);
+        for(int j = 0 ; j < grid.width ; ++j) {
+            int k = i * grid.width + j;
+            f[j] = status[k] ? tracked[k] - m_gridPoints[k] : cv::Point2f(0, 0);
+        }
+    }
+}
+
+
+Flow VideoFlowGrabber::getFrame(int frame) {
 
 	// if file not opened, cannot compute flow
-    if(!m_capture.isOpened()) {
+    if(!isOpened()) {
     	Flow res;
     	res.frameNumber = frame;
     	return res;	
@@ -151,13 +494,38 @@ Flow VideoFlowGrabber::getFrame(int frame) {
 
     if(frame == 0) ++frame;
 
+    // the frame may have been computed with the last block
+    while(!m_pending.empty() && m_pending.front().frameNumber < frame)
+        m_pending.pop_front();
+
+    if(!m_pending.empty() && m_pending.front().frameNumber == frame) {
+        Flow res = m_pending.front();
+        m_pending.pop_front();
+        return res;
+    }
+    m_pending.clear();
+
+    // the frame preceding the block is read below, for the flow
+    if(frame - 1 - m_curFrame > SEEK_MIN_FRAMES)
+        seek(frame - 1);
+
     bool cached = true;
+    cv::Mat skippedColor, skippedYUV;
     for(int i = m_curFrame ; i < frame ; ++i) {
-        m_capture >> m_frame;
+        skippedColor = cv::Mat();
+        skippedYUV = cv::Mat();
+        readFrame(skippedColor, skippedYUV);
         ++m_curFrame;
         cached = false;
     }
 
+    if(!cached) {
+        if(skippedColor.empty() && skippedYUV.empty())
+            m_frame = cv::Mat();
+        else
+            m_frame = luma(skippedColor, skippedYUV);
+    }
+
     if(m_frame.empty()) {
         Flow res;
     	res.frameNumber = frame;
@@ -166,47 +534,210 @@ Flow VideoFlowGrabber::getFrame(int frame) {
         // m_capture >> m_frame;
     }
 
+    // decode the block [frame, frame + stride[. The flow is computed between the frame preceding
+    // the block and the last frame of the block.
+    std::vector<cv::Mat> colorFrames, yuvFrames;
+    for(int k = 0 ; k < m_flowStride ; ++k) {
+        cv::Mat colorFrame, yuvFrame;
+        if(!readFrame(colorFrame, yuvFrame)) break;
+        ++m_curFrame;
 
-    if(!cached) {
-        cv::resize(m_frame, m_frame, m_frame.size() / m_scalingFactor);
-        cv::cvtColor(m_frame, m_frame, cv::COLOR_BGR2GRAY);
-
-        #ifdef GPU_MODE
-            m_gpuframe.upload(m_frame);
-        #endif
+        colorFrames.push_back(colorFrame);
+        yuvFrames.push_back(yuvFrame);
     }
 
-    m_capture >> frame2;
-    ++m_curFrame;
-    if(frame2.empty()) {
+    if(colorFrames.empty()) {
     	Flow res;
     	res.frameNumber = frame;
     	return res;	
     }
 
+    int nbFrames = static_cast<int>(colorFrames.size());
+    std::vector<cv::Mat> flows(nbFrames);
 
-    cv::resize(frame2, colorFrame, frame2.size()/ m_scalingFactor);
-    cv::cvtColor(colorFrame, frame2, cv::COLOR_BGR2GRAY);
-
-    #ifdef GPU_MODE
-        gpuframe2.upload(frame2);
-        m_compute->calc(m_gpuframe, gpuframe2, gpuflow);
-        gpuflow.download(flow); 
-        std::swap(gpuframe2, m_gpuframe);
-    #else
-        m_compute->calc(m_frame, frame2, flow); 
+    // without flow, the last frame is only kept to detect the end of the video
+    cv::Mat frame2;
+    if(m_flowMode != NoFlow || !yuvFrames.back().empty())
+        frame2 = luma(colorFrames.back(), yuvFrames.back());
+    else
+        frame2 = colorFrames.back();
+
+    // the flows may already be available from a previous run
+    bool stored = static_cast<bool>(m_store);
+    for(int k = 0 ; k < nbFrames && stored ; ++k)
+        stored = m_store->read(frame + k, flows[k]);
+
+    if(!stored && m_flowMode != NoFlow) {
+        // the scaling factor changed since the previous block (real-time mode)
+        if(m_frame.size() != frame2.size()) {
+            cv::Mat resized;
+            cv::resize(m_frame, resized, frame2.size(), 0, 0, cv::INTER_AREA);
+            m_frame = resized;
+        }
+
+        cv::Mat flow;
+        {
+            TraceScope trace("flow", frame);
+            computeFlow(m_frame, frame2, flow);
+        }
         // flow = cv::Mat(frame2.size(), CV_32FC2, cv::Scalar(0,0));
-        std::swap(frame2, m_frame);
-    #endif
 
+        // the motion is measured in pixels of the frames downscaled by the default factor
+        if(m_scalingFactor != DEFAULT_SCALING)
+            flow *= static_cast<float>(m_scalingFactor) / DEFAULT_SCALING;
+
+        // the motion over the block is evenly distributed between its frames
+        for(int k = 0 ; k < nbFrames ; ++k) {
+            if(nbFrames > 1)
+                flows[k] = flow / nbFrames;
+            else
+                flows[k] = flow;
+
+            if(m_store)
+                m_store->write(frame + k, flows[k]);
+        }
+    }
+
+    std::swap(frame2, m_frame);
+
+
+    for(int k = 0 ; k < nbFrames ; ++k) {
+        Flow res;
+        res.frameNumber = frame + k;
+        res.color = colorFrames[k];
+        res.yuv = yuvFrames[k];
+        res.frame = flows[k].clone();
+
+        m_pending.push_back(res);
+    }
+
+    Flow res = m_pending.front();
+    m_pending.pop_front();
+
+    return res;
     
-    
+}
+
+
+
+
+#ifdef FFMPEG_MODE
+
+MotionVectorFlowGrabber::MotionVectorFlowGrabber(const std::string& filename) {
+    m_reader.open(filename, true);
+    m_curFrame = -1;
+    m_scalingFactor = 2;
+}
+
+
+int MotionVectorFlowGrabber::getFrameCount() {
+    return m_reader.getFrameCount();
+}
+
+
+float MotionVectorFlowGrabber::getFrameRate() {
+    return m_reader.getFrameRate();
+}
+
+
+cv::Size MotionVectorFlowGrabber::getSourceFrameSize() {
+    return m_reader.getFrameSize();
+}
+
 
+cv::Mat MotionVectorFlowGrabber::rasterizeMotionVectors() {
+    int count = 0;
+    const AVMotionVector *vectors = m_reader.getMotionVectors(count);
+
+    // intra coded frames do not carry any motion vector: keep the motion of the previous frame
+    if(vectors == NULL || count == 0) {
+        if(!m_lastFlow.empty()) return m_lastFlow.clone();
+        return cv::Mat(m_reader.getFrameSize() / m_scalingFactor, CV_32FC2, cv::Scalar(0, 0));
+    }
+
+    cv::Size size = m_reader.getFrameSize() / m_scalingFactor;
+    cv::Mat flow(size, CV_32FC2, cv::Scalar(0, 0));
+    cv::Mat weight(size, CV_32FC1, cv::Scalar(0.f));
+    float s = static_cast<float>(m_scalingFactor);
+
+    for(int k = 0 ; k < count ; ++k) {
+        const AVMotionVector &mv = vectors[k];
+
+        // src = dst + motion: the block at dst in the current frame is predicted from src in the reference
+        float mx = mv.motion_scale != 0 ? static_cast<float>(mv.motion_x) / mv.motion_scale : static_cast<float>(mv.src_x - mv.dst_x);
+        float my = mv.motion_scale != 0 ? static_cast<float>(mv.motion_y) / mv.motion_scale : static_cast<float>(mv.src_y - mv.dst_y);
+
+        // past reference: the content moved from src to dst. Future reference: assume a constant motion.
+        // The distance to the reference frame is not exported, it is assumed to be one frame.
+        cv::Point2f v = mv.source < 0 ? cv::Point2f(-mx / s, -my / s) : cv::Point2f(mx / s, my / s);
+
+        // dst is the center of the block
+        int x0 = std::max(0, static_cast<int>((mv.dst_x - mv.w / 2) / s));
+        int y0 = std::max(0, static_cast<int>((mv.dst_y - mv.h / 2) / s));
+        int x1 = std::min(size.width,  static_cast<int>(std::ceil((mv.dst_x + mv.w / 2) / s)));
+        int y1 = std::min(size.height, static_cast<int>(std::ceil((mv.dst_y + mv.h / 2) / s)));
+
+        for(int i = y0 ; i < y1 ; ++i) {
+            cv::Point2f *f = flow.ptr<cv::Point2f>(i);
+            float *w = weight.ptr<float>(i);
+            for(int j = x0 ; j < x1 ; ++j) {
+                f[j] += v;
+                w[j] += 1.f;
+            }
+        }
+    }
+
+    // bi-predicted blocks: average both directions
+    for(int i = 0 ; i < size.height ; ++i) {
+        cv::Point2f *f = flow.ptr<cv::Point2f>(i);
+        const float *w = weight.ptr<float>(i);
+        for(int j = 0 ; j < size.width ; ++j) {
+            if(w[j] > 1.f) f[j] *= 1.f / w[j];
+        }
+    }
+
+    m_lastFlow = flow;
+    return flow.clone();
+}
+
+
+Flow MotionVectorFlowGrabber::getFrame(int frame) {
     Flow res;
     res.frameNumber = frame;
-    res.color = colorFrame;
-    res.frame = flow.clone();
+
+    if(!m_reader.isOpened()) return res;
+
+    if(frame == 0) ++frame;
+    res.frameNumber = frame;
+
+    // the next read is frame. Intra coded frames reuse the motion of the previous frame, which is then unknown
+    if(frame - m_curFrame > SEEK_MIN_FRAMES && m_reader.seek(frame)) {
+        m_curFrame = frame - 1;
+        m_lastFlow = cv::Mat();
+    }
+
+    // the motion vectors of frame f describe the motion between f-1 and f
+    while(m_curFrame < frame) {
+        TraceScope trace("decode", m_curFrame + 1);
+        if(!m_reader.read()) return res;
+        ++m_curFrame;
+    }
+
+    if(m_curFrame != frame) {
+        std::cerr << "[W] MotionVectorFlowGrabber::getFrame: frame " << frame << " is already decoded." << std::endl;
+        return res;
+    }
+
+    {
+        TraceScope trace("flow", frame);
+        res.frame = rasterizeMotionVectors();
+    }
+
+    cv::Size size = m_reader.getFrameSize() / m_scalingFactor;
+    if(!m_reader.toI420(res.yuv, size))
+        m_reader.toBGR(res.color, size);
 
     return res;
-    
 }
+
+#endif
@@ -27,7 +27,17 @@
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
 #include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
 #include <list>
+#include <algorithm>
+#include <deque>
+
+#include "FlowStore.h"
+#include "FlowIO.h"
+#include "FFmpegVideoReader.h"
+#include "FramePyramid.h"
+#include "CubemapFlow.h"
+#include "TiledFlow.h"
 
 // #define GPU_MODE 1
 
@@ -41,11 +51,45 @@
     #include <opencv2/optflow.hpp>
 #endif
 
+// Resolution at which the motion is estimated. Most consumers only look at a coarse grid of the flow,
+// the dense flow is only needed by the BMS on the motion (ObjectMotionFeatureMap).
+enum FlowMode {
+    DenseFlow,          // dense optical flow at the resolution of the color frames
+    GridFlow,           // flow tracked on a regular grid of points, in the same units as the dense flow
+    NoFlow              // color frames only
+};
+
+// Geometry on which the dense flow is estimated
+enum FlowProjection {
+    EquirectangularProjection,  // directly on the frame
+    CubemapProjection,          // on the six faces of a cubemap, resampled to the frame (see CubemapFlow)
+    TiledProjection             // on overlapping vertical strips of the frame, in parallel (see TiledFlow)
+};
+
 struct Flow {
     int frameNumber;
     cv::Mat frame;
     cv::Mat color;
     cv::Mat flowProb;
+
+    // compact color (I420) of the native YUV ingest. color is then left empty and converted on demand
+    cv::Mat yuv;
+
+    // resized versions of frame and color, shared by all the copies of the Flow (set by FlowManager)
+    boost::shared_ptr<FramePyramid> flowPyramid;
+    boost::shared_ptr<FramePyramid> colorPyramid;
+
+    // frame and color resized to size, through the pyramids when available. Read only.
+    cv::Mat resizedFrame            (const cv::Size& size, int interpolation = cv::INTER_AREA)     const;
+    cv::Mat resizedColor            (const cv::Size& size, int interpolation = cv::INTER_AREA)     const;
+
+    // BGR color, whatever the way it is stored
+    cv::Mat getColor                ()                                                              const;
+    cv::Size getColorSize           ()                                                              const;
+    inline bool hasColor            ()                                                              const { return !color.empty() || !yuv.empty(); }
+
+    // the buffers of the frame, with the levels of its pyramids
+    void collectMemory              (MemoryReport& report, const std::string& owner)              const;
 };
 
 
@@ -57,6 +101,12 @@ public:
     virtual float getFrameRate      () = 0;
 	virtual cv::Size getSourceFrameSize() = 0;
     virtual ~FlowGrabber            ()                  {}
+
+    // real-time mode: downscaling of the frames and stride of the flow, for the next frames
+    virtual void  setQuality        (int /*scalingFactor*/, int /*flowStride*/)     {}
+
+    // frame returned by getFrame(frame), as numbered in the cache of the FlowManager
+    virtual int   sourceFrame       (int frame)                         const { return frame; }
 };
 
 
@@ -66,9 +116,11 @@ class FileFlowGrabber : public FlowGrabber {
 
     std::vector<std::string> m_filelist;
     std::string              m_colorImagePath;
+    boost::shared_ptr<FlowContainer>
+                             m_container;
 
 public:
-    FileFlowGrabber                     (const std::vector<std::string> &filelist, const std::string& colorImgPath = "") : m_filelist(filelist), m_colorImagePath(colorImgPath) {}
+    FileFlowGrabber                     (const std::vector<std::string> &filelist, const std::string& colorImgPath = "");
     virtual ~FileFlowGrabber            () 									{}
 
     virtual float   getFrameRate        ()                  { return 30.0f; }
@@ -85,18 +137,38 @@ class VideoFlowGrabber : public FlowGrabber {
 
 #ifdef GPU_MODE
     cv::Ptr<cv::cuda::DenseOpticalFlow> m_compute;
-    cv::cuda::GpuMat                    m_gpuframe;
 #else
     cv::Ptr<cv::DenseOpticalFlow> m_compute;
 #endif
 
 	cv::VideoCapture 			  m_capture;
+#ifdef FFMPEG_MODE
+    FFmpegVideoReader             m_reader;         // native YUV ingest
+#endif
+    bool                          m_nativeYUV;
     int							  m_curFrame;
     cv::Mat 					  m_frame;
     cv::Mat                       m_colorFrame;
 
     int                           m_scalingFactor;
 
+    std::string                   m_filename;
+    boost::shared_ptr<FlowStore>  m_store;
+
+    int                           m_flowStride;
+    std::deque<Flow>              m_pending;
+
+    FlowMode                      m_flowMode;
+    int                           m_gridWidth;
+    std::vector<cv::Point2f>      m_gridPoints;
+    cv::Size                      m_gridFrameSize;
+
+    FlowProjection                m_projection;
+    boost::shared_ptr<CubemapFlow> m_cubemap;
+    boost::shared_ptr<TiledFlow>  m_tiled;
+    int                           m_nbTiles;
+    int                           m_tileOverlap;
+
 
 public:
 	VideoFlowGrabber		        (const std::string& filename);
@@ -104,36 +176,120 @@ public:
 
     virtual Flow  getFrame          (int frame);
     virtual float getFrameRate      ();
-    int           getFrameCount     ();
+    virtual int   getFrameCount     ();
 	virtual cv::Size getSourceFrameSize();
+
+    // there is no flow before frame 1: frame 0 is frame 1
+    virtual int   sourceFrame       (int frame)                         const { return frame == 0 ? 1 : frame; }
+
+    // read/write the flows from/to an on-disk store located in directory
+    bool          enableFlowStore   (const std::string& directory);
+    std::string   getFlowAlgorithm  ()                                  const;
+
+    // compute the flow every stride frames, the in-between flows are interpolated
+    inline void   setFlowStride     (int stride)                        { m_flowStride = std::max(1, stride); }
+
+    // the mode must be set before enabling the flow store. The grid keeps the aspect ratio of the video
+    inline void   setFlowMode       (FlowMode mode, int gridWidth = 84) { m_flowMode = mode; m_gridWidth = std::max(2, gridWidth); }
+    inline FlowMode getFlowMode     ()                                  const { return m_flowMode; }
+    cv::Size      getFlowSize       ();
+
+    // only used by the dense flow. Must be set before enabling the flow store
+    inline void   setFlowProjection (FlowProjection projection)        { m_projection = projection; }
+    inline void   setFlowTiles      (int nbTiles, int overlap)          { m_nbTiles = std::max(1, nbTiles); m_tileOverlap = std::max(0, overlap); }
+
+    // ignored with a flow store, whose flows are computed with fixed settings. The flows keep the units
+    // of the default scaling factor
+    virtual void  setQuality        (int scalingFactor, int flowStride);
+
+protected:
+    // frames provided by the subclass (see PushFlowGrabber): no file is opened
+    VideoFlowGrabber                ();
+
+    inline int    getScalingFactor  ()                                  const { return m_scalingFactor; }
+
+    // next frame, resized by the scaling factor. Either color (BGR) or yuv (compact I420) is set
+    virtual bool  isOpened          ()                                  const;
+    virtual bool  readFrame         (cv::Mat& color, cv::Mat& yuv);
+
+private:
+    void          init              ();
+
+    // the next readFrame returns frame. False if the input cannot seek, the frames are then read up to it
+    bool          seek              (int frame);
+    void          computeFlow       (const cv::Mat& from, const cv::Mat& to, cv::Mat& flow);
+    void          computeGridFlow   (const cv::Mat& from, const cv::Mat& to, cv::Mat& flow);
 }; 
 
 
 
+#ifdef FFMPEG_MODE
+
+// Flow from the motion vectors of the compressed bitstream: no dense flow estimation.
+// Block vectors are rasterized to the CV_32FC2 format of VideoFlowGrabber (same scaling factor).
+
+class MotionVectorFlowGrabber : public FlowGrabber {
+
+    FFmpegVideoReader             m_reader;
+    int                           m_curFrame;
+    int                           m_scalingFactor;
+    cv::Mat                       m_lastFlow;
+
+public:
+    MotionVectorFlowGrabber         (const std::string& filename);
+    virtual ~MotionVectorFlowGrabber()                                  {}
+
+    virtual Flow  getFrame          (int frame);
+    virtual float getFrameRate      ();
+    int           getFrameCount     ();
+	virtual cv::Size getSourceFrameSize();
+    virtual int   sourceFrame       (int frame)                         const { return frame == 0 ? 1 : frame; }
+
+private:
+    cv::Mat       rasterizeMotionVectors();
+};
+
+#endif
+
+
+
 class FlowManager {
 
     boost::shared_ptr<FlowGrabber>      m_grabber;
     std::list<Flow>                     m_cache;
     size_t                              m_cacheSize;
-    static FlowManager                 *m_This;
+    float                               m_frameRate;
+    boost::mutex                        m_cacheLock;    // the stages of FramePipeline share the manager
+    boost::mutex                        m_grabLock;
 
 
 public:
-    static FlowManager *get();
+    FlowManager() : m_cacheSize(30), m_frameRate(-1) {};
 
-    void setFlowGrabber(boost::shared_ptr<FlowGrabber> grabber)         { m_grabber = grabber; }
+    void setFlowGrabber(boost::shared_ptr<FlowGrabber> grabber)         { boost::mutex::scoped_lock grabLock(m_grabLock); boost::mutex::scoped_lock lock(m_cacheLock); m_grabber = grabber; m_frameRate = -1; m_cache.clear(); }
     
     boost::shared_ptr<FlowGrabber>
          getFlowGrabber()                                               { return m_grabber; }
 
     Flow    getFrame      (int frame);
     float   getFrameRate  ();
+    void    setFlowQuality(int scalingFactor, int flowStride);
 	cv::Size
 		getSourceFrameSize();
 
+    // number of frames kept in memory. The frames read ahead by a pipeline must fit with the temporal window
+    void    setCacheSize  (size_t size)                                 { boost::mutex::scoped_lock lock(m_cacheLock); m_cacheSize = size; }
+    size_t  getCacheSize  ()                                            const { return m_cacheSize; }
+
+    // the frames of the cache
+    void    collectMemory (MemoryReport& report);
+
 
 private:
-    FlowManager() : m_cacheSize(30) {};
+    FlowManager(const FlowManager&);
+    FlowManager& operator=(const FlowManager&);
+
+    bool    findCached    (int frame, Flow& flow);
 
 } ;
 
@@ -27,6 +27,10 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <boost/interprocess/exceptions.hpp>
 
 
 cv::Mat readFlow(const std::string& filename) {
@@ -85,3 +89,165 @@ void writeFlow(const std::string& filename, const cv::Mat &flow) {
 
 
 
+
+
+
+
+// ------------------------------------------------------------------------------------------------
+// Flow container
+
+namespace {
+
+    const char  CONTAINER_MAGIC[8]  = { 'V', 'B', 'M', 'S', 'F', 'L', 'O', 'C' };
+    const int   CONTAINER_VERSION   = 1;
+
+    struct ContainerHeader {
+        char    magic[8];
+        int     version;
+        int     nbFrames;
+        int     storage;
+        int     reserved;
+    };
+
+    float halfToFloat(unsigned short value) {
+        unsigned int sign     = (value & 0x8000) << 16;
+        int          exponent = (value >> 10) & 0x1f;
+        unsigned int mantissa = value & 0x3ff;
+        unsigned int f;
+
+        if(exponent == 0) {
+            if(mantissa == 0) {
+                f = sign;
+            } else {
+                // denormalized half -> normalized float
+                exponent = 1;
+                while(!(mantissa & 0x400)) { mantissa <<= 1; --exponent; }
+                mantissa &= 0x3ff;
+                f = sign | static_cast<unsigned int>(exponent + 127 - 15) << 23 | (mantissa << 13);
+            }
+        } else if(exponent == 31) {
+            f = sign | 0x7f800000 | (mantissa << 13);
+        } else {
+            f = sign | static_cast<unsigned int>(exponent + 127 - 15) << 23 | (mantissa << 13);
+        }
+
+        float result;
+        std::memcpy(&result, &f, sizeof(result));
+        return result;
+    }
+
+    size_t sampleSize(int storage) {
+        switch(storage) {
+            case FLOW_FLOAT16:  return sizeof(unsigned short);
+            case FLOW_UINT8:    return sizeof(unsigned char);
+            default:            return sizeof(float);
+        }
+    }
+
+}
+
+
+bool isFlowContainer(const std::string& filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(f == NULL) return false;
+
+    char magic[8];
+    bool valid = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, CONTAINER_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+
+    return valid;
+}
+
+
+FlowContainer::FlowContainer() : m_storage(FLOW_FLOAT32), m_index(NULL), m_nbFrames(0) {
+
+}
+
+
+bool FlowContainer::open(const std::string& filename) {
+    m_index     = NULL;
+    m_nbFrames  = 0;
+
+    if(!isFlowContainer(filename)) {
+        std::cerr << "[E] FlowContainer::open: " << filename << " is not a flow container" << std::endl;
+        return false;
+    }
+
+    // private mapping: the consumers may modify the flows in place without affecting the file
+    try {
+        m_file   = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only);
+        m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::copy_on_write);
+    } catch(boost::interprocess::interprocess_exception &e) {
+        std::cerr << "[E] FlowContainer::open: cannot map " << filename << " (" << e.what() << ")" << std::endl;
+        return false;
+    }
+
+    unsigned long long fileSize = m_region.get_size();
+    if(fileSize < sizeof(ContainerHeader)) {
+        std::cerr << "[E] FlowContainer::open: " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    const char *base = static_cast<const char*>(m_region.get_address());
+    const ContainerHeader *header = reinterpret_cast<const ContainerHeader*>(base);
+
+    if(header->version != CONTAINER_VERSION) {
+        std::cerr << "[E] FlowContainer::open: unsupported version " << header->version << std::endl;
+        return false;
+    }
+
+    if(header->storage < FLOW_FLOAT32 || header->storage > FLOW_UINT8) {
+        std::cerr << "[E] FlowContainer::open: unsupported storage " << header->storage << std::endl;
+        return false;
+    }
+
+    if(header->nbFrames < 0 || sizeof(ContainerHeader) + static_cast<unsigned long long>(header->nbFrames) * sizeof(IndexEntry) > fileSize) {
+        std::cerr << "[E] FlowContainer::open: the index of " << filename << " does not fit in the file (" << header->nbFrames << " frames)" << std::endl;
+        return false;
+    }
+
+    m_storage   = header->storage;
+    m_nbFrames  = header->nbFrames;
+    m_index     = reinterpret_cast<const IndexEntry*>(base + sizeof(ContainerHeader));
+
+    return true;
+}
+
+
+cv::Mat FlowContainer::getFrame(int frame) const {
+    if(m_index == NULL || frame < 0 || frame >= m_nbFrames) return cv::Mat();
+
+    const IndexEntry &entry = m_index[frame];
+    if(entry.width <= 0 || entry.height <= 0) return cv::Mat();
+
+    // the payload must lie in the file: a corrupted index would read out of the mapping
+    unsigned long long fileSize = m_region.get_size();
+    unsigned long long payload  = static_cast<unsigned long long>(entry.width) * entry.height * 2 * sampleSize(m_storage);
+    if(entry.offset > fileSize || payload > fileSize - entry.offset) {
+        std::cerr << "[E] FlowContainer::getFrame: the flow of frame " << frame << " is out of the file" << std::endl;
+        return cv::Mat();
+    }
+
+    char *data = static_cast<char*>(m_region.get_address()) + entry.offset;
+
+    if(m_storage == FLOW_FLOAT32)
+        return cv::Mat(entry.height, entry.width, CV_32FC2, data);
+
+    cv::Mat flow(entry.height, entry.width, CV_32FC2);
+    float *dst = reinterpret_cast<float*>(flow.data);
+    size_t nbSamples = static_cast<size_t>(entry.width) * entry.height * 2;
+
+    if(m_storage == FLOW_FLOAT16) {
+        const unsigned short *src = reinterpret_cast<const unsigned short*>(data);
+        for(size_t i = 0 ; i < nbSamples ; ++i)
+            dst[i] = halfToFloat(src[i]);
+    } else {
+        const unsigned char *src = reinterpret_cast<const unsigned char*>(data);
+        for(size_t i = 0 ; i < nbSamples ; ++i) {
+            int c = static_cast<int>(i & 1);
+            dst[i] = src[i] * entry.scale[c] + entry.bias[c];
+        }
+    }
+
+    return flow;
+}
@@ -27,6 +27,9 @@
 
 
 #include<opencv2/core.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <vector>
 
 
 cv::Mat readFlow(const std::string& filename); 
@@ -34,6 +37,50 @@ void writeFlow(const std::string& filename, const cv::Mat &flow);
 
 
 
+// ------------------------------------------------------------------------------------------------
+// Flow container: all the flows of a video in a single file (.vfc), with an index in the header.
+// Samples are stored as float32, float16, or quantized to 8 bits with a per frame/channel scale.
+// The containers are written by python/floToContainer.py.
+
+enum FlowStorage {
+    FLOW_FLOAT32 = 0,
+    FLOW_FLOAT16,
+    FLOW_UINT8
+};
+
+bool isFlowContainer    (const std::string& filename);
+
+
+class FlowContainer {
+
+    struct IndexEntry {
+        unsigned long long  offset;
+        int                 width;
+        int                 height;
+        float               scale[2];
+        float               bias[2];
+    };
+
+    boost::interprocess::file_mapping   m_file;
+    boost::interprocess::mapped_region  m_region;
+
+    int                                 m_storage;
+    const IndexEntry                   *m_index;
+    int                                 m_nbFrames;
+
+public:
+    FlowContainer                       ();
+
+    bool    open                        (const std::string& filename);
+    inline int
+            size                        ()                          const { return m_nbFrames; }
+
+    // float32 containers return a view on the (private) file mapping, other formats are decoded.
+    cv::Mat getFrame                    (int frame)                 const;
+};
+
+
+
 
 
 
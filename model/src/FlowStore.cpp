@@ -0,0 +1,222 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+#include "FlowStore.h"
+
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/cstdint.hpp>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <cstring>
+#include <vector>
+
+
+namespace {
+
+    const char          STORE_MAGIC[8]  = { 'V', 'B', 'M', 'S', 'F', 'L', 'O', 'W' };
+    const boost::int32_t STORE_VERSION  = 1;
+    const size_t        HASH_CHUNK      = 1 << 20;      // bytes hashed at the beginning and at the end of the video file
+
+    struct StoreHeader {
+        char            magic[8];
+        boost::int32_t  version;
+        boost::int32_t  width;
+        boost::int32_t  height;
+        boost::int32_t  nbFrames;
+        boost::int32_t  scalingFactor;
+        boost::int32_t  reserved[9];
+    };
+
+    void fnv1a(boost::uint64_t &hash, const char *data, size_t size) {
+        for(size_t i = 0 ; i < size ; ++i) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+}
+
+
+
+FlowStore::FlowStore() : m_nbFrames(0), m_valid(NULL), m_data(NULL) {
+
+}
+
+FlowStore::~FlowStore() {
+    close();
+}
+
+
+std::string FlowStore::videoHash(const std::string &videoPath) {
+    std::ifstream file(videoPath.c_str(), std::ios::binary);
+    if(!file.is_open()) return std::string();
+
+    file.seekg(0, std::ios::end);
+    boost::uint64_t fileSize = static_cast<boost::uint64_t>(file.tellg());
+    file.seekg(0, std::ios::beg);
+
+    // hash the size of the file, as well as its first and last MB: the full file is not read.
+    boost::uint64_t hash = 14695981039346656037ULL;
+    fnv1a(hash, reinterpret_cast<const char*>(&fileSize), sizeof(fileSize));
+
+    std::vector<char> buffer(HASH_CHUNK);
+    file.read(&buffer[0], buffer.size());
+    fnv1a(hash, &buffer[0], static_cast<size_t>(file.gcount()));
+
+    if(fileSize > 2 * HASH_CHUNK) {
+        file.clear();
+        file.seekg(-static_cast<std::streamoff>(HASH_CHUNK), std::ios::end);
+        file.read(&buffer[0], buffer.size());
+        fnv1a(hash, &buffer[0], static_cast<size_t>(file.gcount()));
+    }
+
+    std::ostringstream ss;
+    ss << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return ss.str();
+}
+
+
+size_t FlowStore::slotSize() const {
+    return static_cast<size_t>(m_flowSize.width) * m_flowSize.height * 2 * sizeof(float);
+}
+
+size_t FlowStore::headerSize() const {
+    // header + one validity byte per frame, then align the flow slots on 4KB pages
+    size_t size = sizeof(StoreHeader) + m_nbFrames;
+    return (size + 4095) & ~static_cast<size_t>(4095);
+}
+
+
+bool FlowStore::open(const std::string &directory, const std::string &videoPath, int scalingFactor, const std::string &algorithm, int nbFrames, const cv::Size &flowSize) {
+    close();
+
+    if(nbFrames <= 0 || flowSize.area() <= 0) return false;
+
+    std::string hash = videoHash(videoPath);
+    if(hash.empty()) {
+        std::cerr << "[W] FlowStore::open: cannot read " << videoPath << ", flow store disabled." << std::endl;
+        return false;
+    }
+
+    std::ostringstream ss;
+    ss << directory << "/" << hash << "_x" << scalingFactor << "_" << algorithm << ".vfs";
+    m_filename   = ss.str();
+    m_nbFrames   = nbFrames;
+    m_flowSize   = flowSize;
+
+    size_t fileSize = headerSize() + static_cast<size_t>(nbFrames) * slotSize();
+
+    // check if a compatible store already exists, otherwise (re)create it.
+    bool create = true;
+    {
+        std::ifstream file(m_filename.c_str(), std::ios::binary);
+        StoreHeader header;
+        if(file.is_open() && file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            create = !(std::memcmp(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) == 0
+                    && header.version       == STORE_VERSION
+                    && header.width         == flowSize.width
+                    && header.height        == flowSize.height
+                    && header.nbFrames      == nbFrames
+                    && header.scalingFactor == scalingFactor);
+        }
+    }
+
+    if(create) {
+        std::ofstream file(m_filename.c_str(), std::ios::binary | std::ios::trunc);
+        if(!file.is_open()) {
+            std::cerr << "[W] FlowStore::open: cannot create " << m_filename << ", flow store disabled." << std::endl;
+            return false;
+        }
+
+        StoreHeader header;
+        std::memset(&header, 0, sizeof(header));
+        std::memcpy(header.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+        header.version       = STORE_VERSION;
+        header.width         = flowSize.width;
+        header.height        = flowSize.height;
+        header.nbFrames      = nbFrames;
+        header.scalingFactor = scalingFactor;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        // grow the file to its final size, untouched slots stay sparse on disk
+        file.seekp(static_cast<std::streamoff>(fileSize - 1));
+        file.put(0);
+    }
+
+    try {
+        m_file   = boost::interprocess::file_mapping(m_filename.c_str(), boost::interprocess::read_write);
+        m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_write, 0, fileSize);
+    } catch(boost::interprocess::interprocess_exception &e) {
+        std::cerr << "[W] FlowStore::open: cannot map " << m_filename << " (" << e.what() << "), flow store disabled." << std::endl;
+        return false;
+    }
+
+    unsigned char *base = static_cast<unsigned char*>(m_region.get_address());
+    m_valid = base + sizeof(StoreHeader);
+    m_data  = base + headerSize();
+
+    return true;
+}
+
+
+void FlowStore::close() {
+    if(m_data != NULL) {
+        m_region.flush();
+    }
+
+    m_region = boost::interprocess::mapped_region();
+    m_file   = boost::interprocess::file_mapping();
+    m_valid  = NULL;
+    m_data   = NULL;
+}
+
+
+bool FlowStore::read(int frame, cv::Mat &flow) const {
+    if(!isOpen() || frame < 0 || frame >= m_nbFrames || !m_valid[frame]) return false;
+
+    flow = cv::Mat(m_flowSize, CV_32FC2, m_data + frame * slotSize());
+    return true;
+}
+
+
+void FlowStore::write(int frame, const cv::Mat &flow) {
+    if(!isOpen() || frame < 0 || frame >= m_nbFrames) return;
+    if(flow.type() != CV_32FC2 || flow.size() != m_flowSize) return;
+
+    cv::Mat slot(m_flowSize, CV_32FC2, m_data + frame * slotSize());
+    flow.copyTo(slot);
+
+    // only flag the slot once its content is on the disk: the system may write the pages back in any
+    // order, a crash would otherwise leave a flagged slot with garbage
+    unsigned char *base = static_cast<unsigned char*>(m_region.get_address());
+    if(!m_region.flush(static_cast<size_t>(slot.data - base), slotSize(), false)) {
+        std::cerr << "[W] FlowStore::write: cannot flush the flow of frame " << frame << " to " << m_filename << std::endl;
+        return;
+    }
+
+    m_valid[frame] = 1;
+    m_region.flush(static_cast<size_t>(m_valid + frame - base), 1);
+}
@@ -0,0 +1,75 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FlowStore_
+#define _FlowStore_
+
+#include <opencv2/core.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <string>
+
+
+// On-disk store of the optical flow of a video. One file per (video, scaling factor, flow algorithm).
+// Each frame has a fixed-size slot, the file is memory mapped and slots are filled as flows are computed,
+// so that a later run on the same video with the same flow settings can skip the flow estimation.
+
+class FlowStore {
+
+    boost::interprocess::file_mapping   m_file;
+    boost::interprocess::mapped_region  m_region;
+
+    std::string                         m_filename;
+    int                                 m_nbFrames;
+    cv::Size                            m_flowSize;
+
+    unsigned char                      *m_valid;
+    unsigned char                      *m_data;
+
+
+public:
+    FlowStore                           ();
+    virtual ~FlowStore                  ();
+
+    bool            open                (const std::string &directory, const std::string &videoPath, int scalingFactor, const std::string &algorithm, int nbFrames, const cv::Size &flowSize);
+    void            close               ();
+    inline bool     isOpen              ()                                                  const { return m_data != NULL; }
+    inline const std::string&
+                    getFilename         ()                                                  const { return m_filename; }
+
+    // returns a view on the mapped slot. The view is only valid while the store is open.
+    bool            read                (int frame, cv::Mat &flow)                          const;
+    void            write               (int frame, const cv::Mat &flow);
+
+    static std::string videoHash        (const std::string &videoPath);
+
+
+private:
+    size_t          slotSize            ()                                                  const;
+    size_t          headerSize          ()                                                  const;
+
+};
+
+
+
+#endif
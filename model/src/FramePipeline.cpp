@@ -0,0 +1,145 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "FramePipeline.h"
+#include <opencv2/imgproc.hpp>
+#include <boost/thread.hpp>
+#include <boost/bind.hpp>
+
+#include "Saliency360.h"
+#include "SaliencyContext.h"
+#include "Trace.h"
+
+
+FramePipeline::FramePipeline(Saliency360& salient, const cv::Size& targetSize, int depth) : m_salient(salient), m_targetSize(targetSize), m_depth(std::max(0, depth)) {
+
+}
+
+
+void FramePipeline::computePriors(FrameMap& item) const {
+    if(item.map.empty()) return;
+
+    m_salient.applyPriors(item.frame, item.map);
+
+    TraceScope trace("resample", item.frame);
+    if(m_targetSize.area() > 0)
+        cv::resize(item.map, item.output, m_targetSize);
+    else
+        cv::resize(item.map, item.output, m_salient.getContext()->getFlowManager().getSourceFrameSize());
+}
+
+
+void FramePipeline::decodeStage(int first, int last, BoundedQueue<int>& out) {
+    for(int frame = first ; frame <= last ; ++frame) {
+        // the frames land in the cache of the FlowManager
+        m_salient.getContext()->getFlowManager().getFrame(frame);
+
+        if(!out.push(frame)) break;
+    }
+
+    out.close();
+}
+
+
+void FramePipeline::featureStage(BoundedQueue<int>& in, BoundedQueue<FrameMap>& out) {
+    int frame;
+    while(in.pop(frame)) {
+        FrameMap item;
+        item.frame = frame;
+        item.map = m_salient.computeFeatures(frame);
+
+        // end of the video: the frames read ahead are not needed
+        if(!out.push(item) || item.map.empty()) {
+            in.close();
+            break;
+        }
+    }
+
+    out.close();
+}
+
+
+void FramePipeline::priorStage(BoundedQueue<FrameMap>& in, BoundedQueue<FrameMap>& out) {
+    FrameMap item;
+    while(in.pop(item)) {
+        computePriors(item);
+
+        if(!out.push(item)) {
+            in.close();
+            break;
+        }
+    }
+
+    out.close();
+}
+
+
+int FramePipeline::run(int first, int last, const boost::function<void (int, const cv::Mat&)>& output) {
+    int lastFrame = first - 1;
+
+    if(m_depth == 0) {
+        for(int frame = first ; frame <= last ; ++frame) {
+            FrameMap item;
+            item.frame = frame;
+            item.map = m_salient.computeFeatures(frame);
+            computePriors(item);
+            m_salient.overlay(frame, item.map);
+
+            output(frame, item.output);
+            lastFrame = frame;
+            if(item.map.empty()) break;
+        }
+
+        return lastFrame;
+    }
+
+    // the frames decoded ahead must not push out of the cache the frames of the temporal window
+    size_t cacheSize = m_salient.getContext()->getFlowManager().getCacheSize();
+    m_salient.getContext()->getFlowManager().setCacheSize(cacheSize + 2 * m_depth + 2);
+
+    BoundedQueue<int>       decoded(m_depth);
+    BoundedQueue<FrameMap>  features(m_depth);
+    BoundedQueue<FrameMap>  priors(m_depth);
+
+    // the stages block on their queues: they have their own threads, not the workers of the WorkerPool
+    boost::thread_group stages;
+    stages.create_thread(boost::bind(&FramePipeline::decodeStage, this, first, last, boost::ref(decoded)));
+    stages.create_thread(boost::bind(&FramePipeline::featureStage, this, boost::ref(decoded), boost::ref(features)));
+    stages.create_thread(boost::bind(&FramePipeline::priorStage, this, boost::ref(features), boost::ref(priors)));
+
+    // the overlay may display the frame: it stays on the calling thread with the output
+    FrameMap item;
+    while(priors.pop(item)) {
+        m_salient.overlay(item.frame, item.map);
+
+        output(item.frame, item.output);
+        lastFrame = item.frame;
+        if(item.map.empty()) break;
+    }
+
+    priors.close();
+    stages.join_all();
+
+    m_salient.getContext()->getFlowManager().setCacheSize(cacheSize);
+    return lastFrame;
+}
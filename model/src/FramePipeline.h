@@ -0,0 +1,69 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FramePipeline_
+#define _FramePipeline_
+
+#include <opencv2/core.hpp>
+#include <boost/function.hpp>
+
+#include "BoundedQueue.h"
+
+class Saliency360;
+
+
+// Runs the stages of Saliency360 on consecutive frames in parallel: while the maps of frame f are
+// written, the priors of f+1, the feature maps of f+2 and the decoding/flow of f+3 are computed.
+// Each stage has its own thread and processes the frames in order, the stages are connected by
+// bounded queues of depth items. With a depth of 0 the stages are run one after the other.
+
+class FramePipeline {
+
+    struct FrameMap {
+        int         frame;
+        cv::Mat     map;            // map of the model, before resizing
+        cv::Mat     output;         // map at the output resolution
+    };
+
+    Saliency360                    &m_salient;
+    cv::Size                        m_targetSize;
+    int                             m_depth;
+
+public:
+    // an empty target size keeps the resolution of the source
+    FramePipeline                   (Saliency360& salient, const cv::Size& targetSize, int depth = 2);
+
+    // computes the frames [first, last] and gives the maps to output, in order, from the calling thread.
+    // Stops after the first empty map (end of the video). Returns the last frame given to output.
+    int         run                 (int first, int last, const boost::function<void (int, const cv::Mat&)>& output);
+
+private:
+    void        decodeStage         (int first, int last, BoundedQueue<int>& out);
+    void        featureStage        (BoundedQueue<int>& in, BoundedQueue<FrameMap>& out);
+    void        priorStage          (BoundedQueue<FrameMap>& in, BoundedQueue<FrameMap>& out);
+
+    void        computePriors       (FrameMap& item)                    const;
+};
+
+
+#endif
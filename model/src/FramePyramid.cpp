@@ -0,0 +1,80 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "FramePyramid.h"
+#include "MemoryAccounting.h"
+#include <cmath>
+
+
+cv::Mat FramePyramid::getSource() {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    if(m_source.empty() && !m_encoded.empty())
+        cv::cvtColor(m_encoded, m_source, m_conversion);
+
+    return m_source;
+}
+
+
+cv::Mat FramePyramid::get(const cv::Size& size, int interpolation) {
+    cv::Mat source = getSource();
+    if(source.empty() || size.area() <= 0) return cv::Mat();
+    if(size == source.size()) return source;
+
+    Level level = { size.width, size.height, interpolation };
+
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        std::map<Level, cv::Mat>::const_iterator it = m_levels.find(level);
+        if(it != m_levels.end()) return it->second;
+    }
+
+    // resize outside of the lock, if two consumers request the same level at the same time the first one is kept
+    cv::Mat resized;
+    cv::resize(source, resized, size, 0, 0, interpolation);
+
+    boost::mutex::scoped_lock lock(m_lock);
+    return m_levels.insert(std::make_pair(level, resized)).first->second;
+}
+
+
+cv::Mat FramePyramid::getMaxDim(int maxDim, int interpolation) {
+    cv::Mat source = getSource();
+    float w = static_cast<float>(source.cols);
+    float h = static_cast<float>(source.rows);
+    float maxD = std::fmax(w, h);
+
+    if(maxD <= 0) return cv::Mat();
+
+    return get(cv::Size(static_cast<int>(maxDim * w / maxD), static_cast<int>(maxDim * h / maxD)), interpolation);
+}
+
+
+void FramePyramid::collectMemory(MemoryReport& report, const std::string& owner) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    report.add(owner, m_source);
+    report.add(owner, m_encoded);
+    for(std::map<Level, cv::Mat>::const_iterator it = m_levels.begin() ; it != m_levels.end() ; ++it)
+        report.add(owner, it->second);
+}
@@ -0,0 +1,80 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _FramePyramid_
+#define _FramePyramid_
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <boost/thread/mutex.hpp>
+#include <map>
+#include <string>
+
+class MemoryReport;
+
+
+// Resized versions of a frame (color image or flow), computed on demand and shared between all the
+// consumers of the frame. The levels are shared: they must be cloned before being modified.
+// The source may be given in a compact encoding (e.g. I420), it is then converted on first use.
+
+class FramePyramid {
+
+    struct Level {
+        int width;
+        int height;
+        int interpolation;
+
+        bool operator<(const Level& l) const {
+            if(width != l.width) return width < l.width;
+            if(height != l.height) return height < l.height;
+            return interpolation < l.interpolation;
+        }
+    };
+
+    cv::Mat                         m_source;
+    cv::Mat                         m_encoded;
+    int                             m_conversion;
+    std::map<Level, cv::Mat>        m_levels;
+    boost::mutex                    m_lock;
+
+
+public:
+    FramePyramid                    (const cv::Mat& source) : m_source(source), m_conversion(-1) {}
+    FramePyramid                    (const cv::Mat& encoded, int conversion) : m_encoded(encoded), m_conversion(conversion) {}
+
+    // full resolution frame, converted from the encoded source if needed
+    cv::Mat     getSource           ();
+
+    // the frame resized to size
+    cv::Mat     get                 (const cv::Size& size, int interpolation = cv::INTER_AREA);
+
+    // the frame resized such as its largest dimension is maxDim
+    cv::Mat     getMaxDim           (int maxDim, int interpolation = cv::INTER_AREA);
+
+    // the source and the levels computed so far
+    void        collectMemory       (MemoryReport& report, const std::string& owner);
+
+};
+
+
+#endif
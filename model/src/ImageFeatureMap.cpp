@@ -23,36 +23,43 @@
 
 
 #include "ImageFeatureMap.h"
+#include "SaliencyContext.h"
 
 ImageFeatureMap::ImageFeatureMap() {
     m_bms = boost::shared_ptr<BMSSaliency>(new BMSSaliency(true, m_ocl));
 
-    m_bms->m_maxDim = 2000; // was 2000
-    m_bms->m_dilatationWidth1 = static_cast<int>(fmax(round(7 * m_bms->m_maxDim / 400.f), 1.f));
-    m_bms->m_dilatationWidth2 = static_cast<int>(fmax(round(9 * m_bms->m_maxDim / 400.f), 1.f));
-    m_bms->m_blurStd = round(9 * m_bms->m_maxDim / 400);
+    m_bms->setMaxDim(2000);
     
 }
 
+void ImageFeatureMap::setQuality(const QualityLevel &level) {
+    m_bms->setMaxDim(level.bmsMaxDim);
+    m_bms->m_sampleStep = level.bmsSampleStep;
+    m_bms->m_nb_projections = level.bmsProjections;
+}
+
 cv::Mat ImageFeatureMap::compute(int frame) {
 
     grabRequiredData(frame);
 
-    if(m_frame.color.empty()) return cv::Mat();
+    if(!m_frame.hasColor()) return cv::Mat();
 
     cv::Mat master_map;
-    m_bms->process(m_frame.color, master_map, true);
+    if(m_frame.colorPyramid)
+        m_bms->process(*m_frame.colorPyramid, master_map, true);
+    else
+        m_bms->process(m_frame.getColor(), master_map, true);
 
     return master_map;
 }
 
 
 void ImageFeatureMap::grabRequiredData(int frame) {
-    m_frame = FlowManager::get()->getFrame(frame);
+    m_frame = m_context->getFlowManager().getFrame(frame);
 }
 
 cv::Mat ImageFeatureMap::getColor(int frame) {
-    return FlowManager::get()->getFrame(frame).color;
+    return m_context->getFlowManager().getFrame(frame).getColor();
 }
 
 
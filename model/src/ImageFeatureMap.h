@@ -48,6 +48,9 @@ public:
     virtual cv::Mat compute                 (int frame);
     virtual void    grabRequiredData        (int targetFrame);
     virtual cv::Mat getColor                (int frame);
+    virtual void    reset                   ()                  { m_frame = Flow(); }
+    virtual void    setQuality              (const QualityLevel &level);
+    virtual FlowMode requiredFlowMode       ()                  const { return NoFlow; }
     
 
 };
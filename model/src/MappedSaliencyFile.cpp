@@ -0,0 +1,141 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "MappedSaliencyFile.h"
+#include "Trace.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <boost/interprocess/exceptions.hpp>
+
+
+namespace {
+
+    // the maps of a video do not fit in a 32 bits long
+    int seek64(FILE *f, long long offset, int origin) {
+#ifdef _WIN32
+        return _fseeki64(f, offset, origin);
+#else
+        return fseeko(f, static_cast<off_t>(offset), origin);
+#endif
+    }
+
+    long long tell64(FILE *f) {
+#ifdef _WIN32
+        return _ftelli64(f);
+#else
+        return static_cast<long long>(ftello(f));
+#endif
+    }
+
+    // grows the file to its final size, without truncating it
+    bool preallocate(const std::string& filename, long long fileSize) {
+        FILE *f = fopen(filename.c_str(), "ab");
+        if(f == NULL) return false;
+        fclose(f);
+
+        f = fopen(filename.c_str(), "r+b");
+        if(f == NULL) return false;
+
+        bool ok = seek64(f, 0, SEEK_END) == 0;
+        long long current = tell64(f);
+
+        if(ok && current > fileSize) {
+            std::cerr << "[E] MappedSaliencyFile: " << filename << " is larger than the expected output" << std::endl;
+            ok = false;
+        }
+
+        // sparse where the system allows it
+        if(ok && current < fileSize)
+            ok = seek64(f, fileSize - 1, SEEK_SET) == 0 && fputc(0, f) != EOF;
+
+        return fclose(f) == 0 && ok;
+    }
+
+}
+
+
+MappedSaliencyFile::MappedSaliencyFile() : m_format(SampleFloat32), m_nbFrames(0), m_headerSize(0), m_frameSize(0) {
+
+}
+
+
+bool MappedSaliencyFile::open(const std::string& filename, int nbFrames, const cv::Size& size, SampleFormat format) {
+    m_nbFrames = 0;
+
+    if(nbFrames <= 0 || size.area() <= 0) {
+        std::cerr << "[E] MappedSaliencyFile::open: the number of frames and the size must be known" << std::endl;
+        return false;
+    }
+
+    m_format     = format;
+    m_size       = size;
+    m_headerSize = format == SampleFloat32 ? 0 : SaliencyWriter::HEADER_SIZE;
+    m_frameSize  = static_cast<size_t>(size.area()) * SaliencyWriter::sampleSize(format);
+
+    long long fileSize = static_cast<long long>(m_headerSize) + static_cast<long long>(m_frameSize) * nbFrames;
+    if(!preallocate(filename, fileSize)) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    try {
+        m_file   = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_write);
+        m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_write);
+    } catch(boost::interprocess::interprocess_exception &e) {
+        std::cerr << "[E] MappedSaliencyFile::open: cannot map " << filename << " (" << e.what() << ")" << std::endl;
+        return false;
+    }
+
+    // every segment writes the same header
+    if(m_headerSize > 0)
+        SaliencyWriter::encodeHeader(format, size, static_cast<unsigned char*>(m_region.get_address()));
+
+    m_nbFrames = nbFrames;
+    return true;
+}
+
+
+bool MappedSaliencyFile::writeFrame(int frame, const cv::Mat& map) {
+    if(frame < 0 || frame >= m_nbFrames || map.empty()) return false;
+
+    if(map.size() != m_size || map.type() != CV_32F) {
+        std::cerr << "[E] MappedSaliencyFile::writeFrame: the maps must be CV_32F, " << m_size.width << "x" << m_size.height << std::endl;
+        return false;
+    }
+
+    TraceScope trace("write", frame);
+
+    unsigned char *slot = static_cast<unsigned char*>(m_region.get_address()) + m_headerSize + m_frameSize * static_cast<size_t>(frame);
+    SaliencyWriter::encodeSamples(map, m_format, slot);
+
+    return true;
+}
+
+
+bool MappedSaliencyFile::flush() {
+    if(m_nbFrames == 0) return false;
+
+    return m_region.flush();
+}
@@ -0,0 +1,70 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _MappedSaliencyFile_
+#define _MappedSaliencyFile_
+
+#include <opencv2/core.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <string>
+
+#include "SaliencyWriter.h"
+
+
+// .bin output preallocated for the whole video and mapped in memory. Frame k has a fixed slot, so the
+// maps can be written in any order, by several threads or by several processes computing segments of
+// the same video (--frame/--duration), without a writer to serialize them. An existing file of the
+// right size is kept: the frames already written by the other segments are not lost.
+
+class MappedSaliencyFile {
+
+    boost::interprocess::file_mapping   m_file;
+    boost::interprocess::mapped_region  m_region;
+
+    SampleFormat                        m_format;
+    cv::Size                            m_size;
+    int                                 m_nbFrames;
+    size_t                              m_headerSize;
+    size_t                              m_frameSize;
+
+public:
+    MappedSaliencyFile                  ();
+
+    bool    open                        (const std::string& filename, int nbFrames, const cv::Size& size, SampleFormat format = SampleFloat32);
+
+    // the slots are independent: no lock. False if the frame is out of the file or the size differs
+    bool    writeFrame                  (int frame, const cv::Mat& map);
+
+    // the pages are written back by the system anyway, flush only waits for them
+    bool    flush                       ();
+
+    inline int  size                    ()                          const { return m_nbFrames; }
+
+private:
+    MappedSaliencyFile                  (const MappedSaliencyFile&);
+    MappedSaliencyFile& operator=       (const MappedSaliencyFile&);
+};
+
+
+#endif
@@ -0,0 +1,406 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "MemoryAccounting.h"
+
+#include "SaliencyContext.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <unordered_map>
+#include <boost/thread/mutex.hpp>
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+// report
+
+MemoryReport::Owner& MemoryReport::findOwner(const std::string& owner) {
+    for(size_t i = 0 ; i < m_owners.size() ; ++i) {
+        if(m_owners[i].name == owner) return m_owners[i];
+    }
+
+    Owner entry;
+    entry.name  = owner;
+    entry.bytes = 0;
+    m_owners.push_back(entry);
+    return m_owners.back();
+}
+
+
+void MemoryReport::add(const std::string& owner, const cv::Mat& m) {
+    if(m.empty()) return;
+
+    // the allocated buffer, not the view: a ROI keeps its whole parent alive
+    if(m.u != NULL) addBytes(owner, m.u, m.u->size);
+    else            addBytes(owner, m.datastart, static_cast<size_t>(m.dataend - m.datastart));
+}
+
+
+void MemoryReport::addBytes(const std::string& owner, const void *key, size_t bytes) {
+    Owner &entry = findOwner(owner);
+    if(entry.buffers.insert(key).second)    entry.bytes += bytes;
+    if(m_buffers.insert(key).second)        m_total += bytes;
+}
+
+
+size_t MemoryReport::getBytes(const std::string& owner) const {
+    for(size_t i = 0 ; i < m_owners.size() ; ++i) {
+        if(m_owners[i].name == owner) return m_owners[i].bytes;
+    }
+    return 0;
+}
+
+
+void MemoryReport::print(std::ostream& out) const {
+    out << std::fixed << std::setprecision(1);
+    for(size_t i = 0 ; i < m_owners.size() ; ++i)
+        out << "    " << std::left << std::setw(32) << m_owners[i].name << std::right << std::setw(10) << m_owners[i].bytes / 1048576.0 << " MB" << std::endl;
+    out << "    " << std::left << std::setw(32) << "total (shared buffers once)" << std::right << std::setw(10) << m_total / 1048576.0 << " MB" << std::endl;
+    out << std::defaultfloat;
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+// counting allocator
+
+namespace {
+
+#if CV_VERSION_MAJOR >= 4
+    typedef cv::AccessFlag AccessFlags;
+#else
+    typedef int AccessFlags;
+#endif
+
+    struct StageAllocations {
+        size_t      nbAllocations;
+        size_t      bytes;
+        size_t      live;               // bytes allocated by the stage, not yet released
+        size_t      peak;
+        size_t      frameAllocations;   // since the previous report
+        size_t      frameBytes;
+        size_t      framePeak;
+    };
+
+    struct Allocation {
+        StageAllocations   *stage;
+        size_t              size;
+    };
+
+    const char *stageName(const char *stage) {
+        return stage != NULL ? stage : "(none)";
+    }
+
+    // never destroyed: cv::Mat may be released by the destructors of other static objects
+    struct AllocatorState {
+        boost::mutex                                        lock;
+        std::map<std::string, StageAllocations>             stages;
+        // the stages are named by literals, identical names of several translation units are different
+        // pointers: the literals are only resolved to their stage once
+        std::unordered_map<const char*, StageAllocations*>  literals;       // NULL: outside of any stage
+        std::unordered_map<const void*, Allocation>         allocations;
+        size_t                                              live;
+    };
+
+    AllocatorState                 *s_state = NULL;
+    std::atomic<bool>               s_enabled(false);
+
+    // under the lock of the state
+    StageAllocations &stageOf(const char *literal) {
+        std::unordered_map<const char*, StageAllocations*>::iterator it = s_state->literals.find(literal);
+        if(it != s_state->literals.end()) return *it->second;
+
+        StageAllocations *stage = &s_state->stages[stageName(literal)];
+        s_state->literals[literal] = stage;
+        return *stage;
+    }
+
+    void allocated(const cv::UMatData *u) {
+        const char *name = Trace::currentStage();
+
+        boost::mutex::scoped_lock lock(s_state->lock);
+        StageAllocations &stage = stageOf(name);
+
+        Allocation allocation = { &stage, u->size };
+        s_state->allocations[u] = allocation;
+        s_state->live += u->size;
+
+        stage.nbAllocations++;
+        stage.frameAllocations++;
+        stage.bytes         += u->size;
+        stage.frameBytes    += u->size;
+        stage.live          += u->size;
+        stage.peak           = std::max(stage.peak, stage.live);
+        stage.framePeak      = std::max(stage.framePeak, stage.live);
+    }
+
+    void released(const cv::UMatData *u) {
+        boost::mutex::scoped_lock lock(s_state->lock);
+        std::unordered_map<const void*, Allocation>::iterator it = s_state->allocations.find(u);
+        if(it == s_state->allocations.end()) return;
+
+        it->second.stage->live -= it->second.size;
+        s_state->live -= it->second.size;
+        s_state->allocations.erase(it);
+    }
+
+
+    // the standard allocator, with the buffers it allocates counted
+    class CountingAllocator : public cv::MatAllocator {
+
+        cv::MatAllocator           *m_std;
+
+    public:
+        CountingAllocator(cv::MatAllocator *stdAllocator) : m_std(stdAllocator) {}
+
+        cv::UMatData* allocate(int dims, const int *sizes, int type, void *data, size_t *step, AccessFlags flags, cv::UMatUsageFlags usageFlags) const CV_OVERRIDE {
+            cv::UMatData *u = m_std->allocate(dims, sizes, type, data, step, flags, usageFlags);
+
+            // the buffers of the user are not counted, and go back to the standard allocator
+            if(u != NULL && data == NULL) {
+                u->currAllocator = this;
+                allocated(u);
+            }
+            return u;
+        }
+
+        bool allocate(cv::UMatData *u, AccessFlags accessFlags, cv::UMatUsageFlags usageFlags) const CV_OVERRIDE {
+            return m_std->allocate(u, accessFlags, usageFlags);
+        }
+
+        void deallocate(cv::UMatData *u) const CV_OVERRIDE {
+            if(u == NULL) return;
+
+            released(u);
+            m_std->deallocate(u);
+        }
+
+        // cv::Mat releases its buffer through unmap
+        void unmap(cv::UMatData *u) const CV_OVERRIDE {
+            if(u->urefcount == 0 && u->refcount == 0)
+                deallocate(u);
+        }
+    };
+
+
+    // per frame reports
+    boost::mutex                    s_reportLock;
+    std::ofstream                   s_log;
+    size_t                          s_budget = 0;
+    bool                            s_overBudget = false;
+    int                             s_dumpInterval = 0;
+    int                             s_nbReports = 0;
+    size_t                          s_peakHeld = 0;
+    std::map<std::string, size_t>   s_ownerPeaks;
+
+    size_t readStatus(const char *field) {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        size_t length = std::char_traits<char>::length(field);
+
+        while(std::getline(status, line)) {
+            if(line.compare(0, length, field) == 0)
+                return static_cast<size_t>(std::atol(line.c_str() + length)) * 1024;
+        }
+
+        return 0;
+    }
+
+    void printStages(std::ostream& out, const std::map<std::string, StageAllocations>& stages, bool frame) {
+        out << "    " << std::left << std::setw(24) << "stage" << std::right << std::setw(12) << "allocations"
+            << std::setw(16) << "allocated (MB)" << std::setw(12) << "peak (MB)" << std::endl;
+
+        out << std::fixed << std::setprecision(1);
+        for(std::map<std::string, StageAllocations>::const_iterator it = stages.begin() ; it != stages.end() ; ++it) {
+            const StageAllocations &stage = it->second;
+            if((frame ? stage.frameAllocations : stage.nbAllocations) == 0) continue;
+
+            out << "    " << std::left << std::setw(24) << it->first << std::right
+                << std::setw(12) << (frame ? stage.frameAllocations : stage.nbAllocations)
+                << std::setw(16) << (frame ? stage.frameBytes : stage.bytes) / 1048576.0
+                << std::setw(12) << (frame ? stage.framePeak : stage.peak) / 1048576.0 << std::endl;
+        }
+        out << std::defaultfloat;
+    }
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------------------------------------
+
+void MemoryAccounting::enable() {
+    if(s_enabled) return;
+
+    s_state = new AllocatorState();
+    s_state->live = 0;
+    cv::Mat::setDefaultAllocator(new CountingAllocator(cv::Mat::getStdAllocator()));
+
+    Trace::trackStages(true);
+    s_enabled = true;
+}
+
+
+bool MemoryAccounting::enabled() {
+    return s_enabled;
+}
+
+
+size_t MemoryAccounting::residentBytes() {
+    return readStatus("VmRSS:");
+}
+
+
+size_t MemoryAccounting::peakResidentBytes() {
+    return readStatus("VmHWM:");
+}
+
+
+size_t MemoryAccounting::liveBytes() {
+    if(!s_enabled) return 0;
+
+    boost::mutex::scoped_lock lock(s_state->lock);
+    return s_state->live;
+}
+
+
+void MemoryAccounting::setBudget(size_t bytes) {
+    boost::mutex::scoped_lock lock(s_reportLock);
+    s_budget = bytes;
+}
+
+
+bool MemoryAccounting::setLog(const std::string& filename) {
+    boost::mutex::scoped_lock lock(s_reportLock);
+
+    s_log.open(filename.c_str());
+    if(!s_log) {
+        std::cerr << "[E] cannot write the memory log: " << filename << std::endl;
+        return false;
+    }
+
+    s_log << "frame,kind,name,count,bytes" << std::endl;
+    return true;
+}
+
+
+void MemoryAccounting::setDumpInterval(int nbFrames) {
+    boost::mutex::scoped_lock lock(s_reportLock);
+    s_dumpInterval = nbFrames;
+}
+
+
+void MemoryAccounting::reportFrame(int frame, SaliencyContext& context) {
+    if(!s_enabled) return;
+
+    MemoryReport report;
+    context.collectMemory(report);
+    size_t resident = residentBytes();
+
+    // the allocations since the previous report, then a new period starts
+    std::map<std::string, StageAllocations> stages;
+    size_t live;
+    {
+        boost::mutex::scoped_lock lock(s_state->lock);
+        stages  = s_state->stages;
+        live    = s_state->live;
+
+        for(std::map<std::string, StageAllocations>::iterator it = s_state->stages.begin() ; it != s_state->stages.end() ; ++it) {
+            it->second.frameAllocations = 0;
+            it->second.frameBytes       = 0;
+            it->second.framePeak        = it->second.live;
+        }
+    }
+
+    boost::mutex::scoped_lock lock(s_reportLock);
+
+    s_peakHeld = std::max(s_peakHeld, report.getTotal());
+    for(size_t i = 0 ; i < report.getNbOwners() ; ++i) {
+        size_t &peak = s_ownerPeaks[report.getOwner(i)];
+        peak = std::max(peak, report.getBytes(i));
+    }
+
+    if(s_log.is_open()) {
+        for(size_t i = 0 ; i < report.getNbOwners() ; ++i)
+            s_log << frame << ",held," << report.getOwner(i) << ",," << report.getBytes(i) << "\n";
+        s_log << frame << ",held,total,," << report.getTotal() << "\n";
+
+        for(std::map<std::string, StageAllocations>::const_iterator it = stages.begin() ; it != stages.end() ; ++it) {
+            if(it->second.frameAllocations == 0) continue;
+            s_log << frame << ",alloc," << it->first << "," << it->second.frameAllocations << "," << it->second.frameBytes << "\n";
+            s_log << frame << ",peak," << it->first << ",," << it->second.framePeak << "\n";
+        }
+
+        s_log << frame << ",process,mat,," << live << "\n";
+        s_log << frame << ",process,resident,," << resident << std::endl;
+    }
+
+    ++s_nbReports;
+    bool dump = s_dumpInterval > 0 && s_nbReports % s_dumpInterval == 0;
+
+    // warns once each time the budget is crossed
+    bool overBudget = s_budget > 0 && resident > s_budget;
+    if(overBudget && !s_overBudget) {
+        std::cerr << "[W] frame " << frame << ": resident memory " << resident / 1048576 << " MB exceeds the budget of " << s_budget / 1048576 << " MB" << std::endl;
+        dump = true;
+    }
+    s_overBudget = overBudget;
+
+    if(dump) {
+        std::cerr << "[I] memory at frame " << frame << ": resident " << resident / 1048576 << " MB, cv::Mat " << live / 1048576 << " MB" << std::endl;
+        report.print(std::cerr);
+        printStages(std::cerr, stages, true);
+    }
+}
+
+
+void MemoryAccounting::printSummary(std::ostream& out) {
+    if(!s_enabled) return;
+
+    std::map<std::string, StageAllocations> stages;
+    {
+        boost::mutex::scoped_lock lock(s_state->lock);
+        stages = s_state->stages;
+    }
+
+    boost::mutex::scoped_lock lock(s_reportLock);
+
+    out << std::endl << "memory: peak resident " << peakResidentBytes() / 1048576 << " MB, peak held by the engine " << s_peakHeld / 1048576 << " MB" << std::endl;
+
+    out << std::endl;
+    printStages(out, stages, false);
+    out << std::fixed << std::setprecision(1);
+    out << std::endl << "    " << std::left << std::setw(32) << "owner" << std::right << std::setw(13) << "peak (MB)" << std::endl;
+    for(std::map<std::string, size_t>::const_iterator it = s_ownerPeaks.begin() ; it != s_ownerPeaks.end() ; ++it)
+        out << "    " << std::left << std::setw(32) << it->first << std::right << std::setw(13) << it->second / 1048576.0 << std::endl;
+    out << std::defaultfloat;
+}
+
+
+void MemoryAccounting::close() {
+    boost::mutex::scoped_lock lock(s_reportLock);
+    if(s_log.is_open()) s_log.close();
+}
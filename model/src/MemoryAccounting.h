@@ -0,0 +1,115 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _MemoryAccounting_
+#define _MemoryAccounting_
+
+#include <opencv2/core.hpp>
+#include <ostream>
+#include <set>
+#include <string>
+#include <vector>
+
+
+class SaliencyContext;
+
+
+// Bytes held by the buffers of an engine, per owner (the cache of frames, the window of a feature map, ...).
+// A buffer is counted once per owner, and once in the total: the frames of the cache are also in the
+// windows of the feature maps, the owners sum to more than the total.
+
+class MemoryReport {
+
+    struct Owner {
+        std::string                 name;
+        size_t                      bytes;
+        std::set<const void*>       buffers;
+    };
+
+    std::vector<Owner>              m_owners;
+    std::set<const void*>           m_buffers;
+    size_t                          m_total;
+
+public:
+    MemoryReport                    () : m_total(0) {}
+
+    // the whole buffer of m, also when m is a view of it
+    void        add                 (const std::string& owner, const cv::Mat& m);
+
+    // bytes not held by a cv::Mat (e.g. a network), identified by key
+    void        addBytes            (const std::string& owner, const void *key, size_t bytes);
+
+    inline size_t
+                getTotal            ()                                  const { return m_total; }
+    size_t      getBytes            (const std::string& owner)          const;
+    size_t      getNbOwners         ()                                  const { return m_owners.size(); }
+    const std::string&
+                getOwner            (size_t i)                          const { return m_owners[i].name; }
+    size_t      getBytes            (size_t i)                          const { return m_owners[i].bytes; }
+
+    void        print               (std::ostream& out)                 const;
+
+private:
+    Owner&      findOwner           (const std::string& owner);
+};
+
+
+// Memory of the process, sampled per frame. Enabled, the cv::Mat of the process are allocated through a counting
+// allocator: the allocations are attributed to the stage of the allocating thread (see TraceScope), with the bytes
+// each stage holds at its peak (scratch buffers of BMS, ...). After each frame, the buffers held by the engine are
+// reported (MemoryReport), optionally logged, and compared to the memory budget.
+
+class MemoryAccounting {
+
+public:
+    // installs the counting allocator: to be called before the first cv::Mat is allocated
+    static void     enable              ();
+    static bool     enabled             ();
+
+    // resident memory of the process (VmRSS) and its peak (VmHWM), 0 if unknown
+    static size_t   residentBytes       ();
+    static size_t   peakResidentBytes   ();
+
+    // bytes of the cv::Mat currently allocated through the counting allocator
+    static size_t   liveBytes           ();
+
+    // warning, with the breakdown of the memory, when the resident memory exceeds budget. 0: no budget
+    static void     setBudget           (size_t bytes);
+
+    // one row per frame, owner and stage: frame,kind,name,count,bytes
+    static bool     setLog              (const std::string& filename);
+
+    // prints the breakdown every nbFrames frames. 0: never
+    static void     setDumpInterval     (int nbFrames);
+
+    // after frame: the buffers held by the engine, the allocations since the previous report
+    static void     reportFrame         (int frame, SaliencyContext& context);
+
+    // allocations per stage, peak of each owner, peak resident memory
+    static void     printSummary        (std::ostream& out);
+
+    static void     close               ();
+};
+
+
+#endif
@@ -24,11 +24,13 @@
 
 
 #include "MotionFeatureMap.h"
+#include "SaliencyContext.h"
+#include "MemoryAccounting.h"
 
 
 void MotionFeatureMap::grabRequiredData(int frame) {
     
-    if(!FlowManager::get()->getFlowGrabber()) return;
+    if(!m_context->getFlowManager().getFlowGrabber()) return;
 
     std::vector<Flow> lFlow;
     // we need [frame frame+window]
@@ -43,26 +45,48 @@ void MotionFeatureMap::grabRequiredData(int frame) {
         }
 
         if(needCompute) {
-            Flow flow = FlowManager::get()->getFrame(i);
+            Flow flow = m_context->getFlowManager().getFrame(i);
             if(!flow.frame.empty()) {
                 lFlow.push_back(flow);
             }   
         }
     }
-    
+
+    // the real-time mode changes the scaling of the frames on the fly: the flows of the window computed
+    // before are resampled to the size of the latest one. The flows are in pixels of the frames downscaled
+    // by the default factor whatever their size, only their resolution differs
+    if(!lFlow.empty()) {
+        cv::Size size = lFlow.back().frame.size();
+        for(size_t k = 0 ; k + 1 < lFlow.size() ; ++k) {
+            if(lFlow[k].frame.size() == size) continue;
+
+            lFlow[k].frame = lFlow[k].resizedFrame(size);
+            lFlow[k].flowPyramid.reset();
+            lFlow[k].flowProb = cv::Mat();
+        }
+    }
+
     m_optFlow = lFlow;
 }
 
 
-cv::Mat MotionFeatureMap::getFrontFlow() {
+cv::Mat MotionFeatureMap::getFrontFlow(const cv::Size& size) {
     
     if(m_optFlow.empty()) return cv::Mat();
 
+    if(size.area() > 0)
+        return m_optFlow.front().resizedFrame(size);
+
     return m_optFlow.front().frame;
 }
 
 cv::Mat MotionFeatureMap::getColor(int frame) {
-    return FlowManager::get()->getFrame(frame).color;
+    return m_context->getFlowManager().getFrame(frame).getColor();
 }
 
 
+// the window of frames, with their flow and probabilities
+void MotionFeatureMap::collectMemory(MemoryReport& report, const std::string& owner) {
+    for(size_t k = 0 ; k < m_optFlow.size() ; ++k)
+        m_optFlow[k].collectMemory(report, owner + ".window");
+}
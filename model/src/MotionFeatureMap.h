@@ -54,8 +54,10 @@ public:
     virtual cv::Mat compute             (int frame) = 0;
 
     virtual void    grabRequiredData    (int targetFrame);
+    virtual void    reset               ()                          { m_optFlow.clear(); }
     virtual cv::Mat getColor            (int frame);
-    cv::Mat         getFrontFlow        ();
+    virtual void    collectMemory       (MemoryReport& report, const std::string& owner);
+    cv::Mat         getFrontFlow        (const cv::Size& size = cv::Size());
     
 };
 
@@ -24,6 +24,7 @@
 
 
 #include "MotionSourceFeatureMap.h"
+#include "Trace.h"
 
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
@@ -269,6 +270,10 @@ bool MotionSourceFeatureMap::init() {
     m_salmapmaxsize_v.clear();
 	m_salmapmaxsize_v.push_back(static_cast<int>(round(height * scale)));
     m_salmapmaxsize_v.push_back(static_cast<int>(round(width  * scale)));
+
+    // the transition matrices of the window were computed at the previous resolution (real-time mode)
+    for(size_t i = 0 ; i < m_optFlow.size() ; ++i)
+        m_optFlow[i].flowProb = cv::Mat();
     
     m_initDone = true;
 
@@ -282,12 +287,8 @@ cv::Mat MotionSourceFeatureMap::computeFeature() {
 
     // if(m_optFlow.back().flowProb.empty()) 
     {
-        cv::Mat &A = m_optFlow.back().frame;
-
-        cv::Mat fmap;
-
         // reshape the matrix to avoid too much computation.
-        cv::resize(A, fmap, cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
+        cv::Mat fmap = m_optFlow.back().resizedFrame(cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]));
 
 		// rescale motion vectors such as they scale to the right amplitude
 		//cv::divide(fmap, cv::Scalar(static_cast<float>(A.cols) / static_cast<float>(m_salmapmaxsize_v[1]), static_cast<float>(A.rows) / static_cast<float>(m_salmapmaxsize_v[2])), fmap);
@@ -306,11 +307,9 @@ cv::Mat MotionSourceFeatureMap::computeFeature() {
     // for(int i = 1 ; i < static_cast<int>(m_optFlow.size()) ; ++i) {
         cv::Mat lp;
         
-        if(m_optFlow[i].flowProb.empty()) {
-            cv::Mat fmap;
-
+        if(m_optFlow[i].flowProb.empty() || m_optFlow[i].flowProb.rows != p.cols) {
             // resize the optical flow to avoid too much computation
-            cv::resize(m_optFlow[i].frame, fmap, cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]), 0, 0, cv::INTER_AREA);
+            cv::Mat fmap = m_optFlow[i].resizedFrame(cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]));
 
 			// rescale motion vectors such as they scale to the right amplitude
 			//cv::divide(fmap, cv::Scalar(static_cast<float>(m_optFlow[i].frame.cols) / static_cast<float>(m_salmapmaxsize_v[1]), static_cast<float>(m_optFlow[i].frame.rows) / static_cast<float>(m_salmapmaxsize_v[2])), fmap);
@@ -324,8 +323,9 @@ cv::Mat MotionSourceFeatureMap::computeFeature() {
             for(int s = 1 ; s < m_multires ; ++s) {
                 pTwo *= 2;
 
-                cv::resize(m_optFlow[i].frame, fmap, cv::Size(m_salmapmaxsize_v[1]/pTwo, m_salmapmaxsize_v[0]/pTwo), 0, 0, cv::INTER_AREA);
-                cv::resize(fmap, fmap, cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]));
+                // the pyramid levels are shared, upsample into a new matrix
+                fmap = cv::Mat();
+                cv::resize(m_optFlow[i].resizedFrame(cv::Size(m_salmapmaxsize_v[1]/pTwo, m_salmapmaxsize_v[0]/pTwo)), fmap, cv::Size(m_salmapmaxsize_v[1], m_salmapmaxsize_v[0]));
 
 				// rescale motion vectors such as they scale to the right amplitude
 				//cv::divide(fmap, cv::Scalar(static_cast<float>(m_optFlow[i].frame.cols) / static_cast<float>(m_salmapmaxsize_v[1]), static_cast<float>(m_optFlow[i].frame.rows) / static_cast<float>(m_salmapmaxsize_v[2])), fmap);
@@ -389,16 +389,25 @@ cv::Mat MotionSourceFeatureMap::compute(int frame) {
         init();
 
     // Compute feature maps
-    cv::Mat p = computeFeature();
+    cv::Mat p;
+    {
+        TraceScope trace("markov.build", frame);
+        p = computeFeature();
+    }
 
     if(p.empty()) return cv::Mat();
 
     // Compute activation
-    cv::Mat master_map = computeActivation(p);
+    cv::Mat master_map;
+    {
+        TraceScope trace("markov.solve", frame);
+        master_map = computeActivation(p);
+    }
 
-    // Rescale master map to original size
+    // Rescale master map to original size (the flow may only be a coarse grid)
     cv::Mat result;
-    cv::resize(master_map, result, cv::Size(m_optFlow[0].frame.cols, m_optFlow[0].frame.rows), 0, 0, cv::INTER_LANCZOS4);
+    cv::Size size = m_optFlow[0].hasColor() ? m_optFlow[0].getColorSize() : m_optFlow[0].frame.size();
+    cv::resize(master_map, result, size, 0, 0, cv::INTER_LANCZOS4);
 
     // apply 360 degree normalization
     scaleSaliency(result);
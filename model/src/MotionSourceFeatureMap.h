@@ -48,6 +48,13 @@ public:
 
 
     virtual cv::Mat compute(int frame);
+    virtual void    reset() { MotionFeatureMap::reset(); m_initDone = false; }
+
+    // the resolution of the master map, and the transition matrices of the window, are updated with the next frame
+    virtual void    setQuality(const QualityLevel &level) { m_salmapmaxsize = level.salMapMaxSize; m_multires = level.multiRes; m_initDone = false; }
+
+    // the flow is immediately reduced to m_salmapmaxsize points wide
+    virtual FlowMode requiredFlowMode() const { return GridFlow; }
 
 
 private:
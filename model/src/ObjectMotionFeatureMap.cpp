@@ -33,13 +33,16 @@ ObjectMotionFeatureMap::ObjectMotionFeatureMap() : MotionFeatureMap(1) {
 
     m_bms = boost::shared_ptr<BMSSaliency>(new BMSSaliency(true, m_ocl));
 
-    m_bms->m_maxDim = 2000;
-    m_bms->m_dilatationWidth1 = static_cast<int>(fmax(round(7 * m_bms->m_maxDim / 400.f), 1.f));
-    m_bms->m_dilatationWidth2 = static_cast<int>(fmax(round(9 * m_bms->m_maxDim / 400.f), 1.f));
-    m_bms->m_blurStd = round(9 * m_bms->m_maxDim / 400);
+    m_bms->setMaxDim(2000);
 
 }
 
+void ObjectMotionFeatureMap::setQuality(const QualityLevel &level) {
+    m_bms->setMaxDim(level.bmsMaxDim);
+    m_bms->m_sampleStep = level.bmsSampleStep;
+    m_bms->m_nb_projections = level.bmsProjections;
+}
+
 cv::Mat ObjectMotionFeatureMap::compute(int frame) {
 
     if(m_optFlow.empty()) 
@@ -47,11 +50,10 @@ cv::Mat ObjectMotionFeatureMap::compute(int frame) {
 
     if(m_optFlow.empty()) return cv::Mat();
 
-    cv::Mat motionMap = m_optFlow[0].frame; 
-
-    if(motionMap.empty()) return cv::Mat();
+    if(m_optFlow[0].frame.empty()) return cv::Mat();
 
-    motionMap *= 15;
+    // the flow is shared with the other consumers, it must not be modified in place
+    cv::Mat motionMap = m_optFlow[0].frame * 15;
     cv::Mat colMotion(motionMap.size(), CV_8UC3, cv::Scalar(0,0,0));
     for(int i = 0 ; i < motionMap.rows ; ++i) {
         float c = std::cos(3.1415926535898f * static_cast<float>(motionMap.rows / 2 - i) / motionMap.rows );
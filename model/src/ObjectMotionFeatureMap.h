@@ -45,6 +45,7 @@ public:
 
 
     virtual cv::Mat compute     (int frame);
+    virtual void    setQuality  (const QualityLevel &level);
 
 };
 
@@ -24,6 +24,7 @@
 
 
 #include "PedestrianDetectFeatureMap.h"
+#include "SaliencyContext.h"
 
 #include <opencv2/core.hpp>
 #include <opencv2/highgui.hpp>
@@ -46,7 +47,7 @@ PedestrianFeatureMap::PedestrianFeatureMap(PedestrianMode mode) {
 
 cv::Mat PedestrianFeatureMap::compute(int frame) {
 
-    cv::Mat img = m_frame.color;
+    cv::Mat img = m_frame.getColor();
 
     std::vector<cv::Rect> found, found_filtered;
     std::vector<double> weights;
@@ -79,8 +80,7 @@ cv::Mat PedestrianFeatureMap::compute(int frame) {
 
     if(m_FaceCascadeEnabled) {
         cv::Mat gray;
-        cv::cvtColor(img, gray, cv::COLOR_BGR2GRAY);
-        cv::resize(gray, gray, cv::Size(1400, 788));
+        cv::cvtColor(m_frame.resizedColor(cv::Size(1400, 788), cv::INTER_LINEAR), gray, cv::COLOR_BGR2GRAY);
         std::vector<cv::Rect> faceFeatures;
         if (m_FaceCascadeEnabled)
             m_face_cascade.detectMultiScale(gray, faceFeatures, 1.1, 2, 0 | cv::CASCADE_SCALE_IMAGE, cv::Size(15, 15));
@@ -112,7 +112,7 @@ cv::Mat PedestrianFeatureMap::compute(int frame) {
 bool PedestrianFeatureMap::havePedestrian(int frame) {
     grabRequiredData(frame);
 
-    cv::Mat img = m_frame.color;
+    cv::Mat img = m_frame.getColor();
 
     std::vector<cv::Rect> found, found_filtered;
     std::vector<double> weights;
@@ -123,11 +123,11 @@ bool PedestrianFeatureMap::havePedestrian(int frame) {
 
 
 void PedestrianFeatureMap::grabRequiredData(int frame) {
-    m_frame = FlowManager::get()->getFrame(frame);
+    m_frame = m_context->getFlowManager().getFrame(frame);
 }
 
 cv::Mat PedestrianFeatureMap::getColor(int frame) {
-    return FlowManager::get()->getFrame(frame).color;
+    return m_context->getFlowManager().getFrame(frame).getColor();
 }
 
 
@@ -60,6 +60,8 @@ public:
     virtual cv::Mat compute                 (int frame);
     virtual void    grabRequiredData        (int targetFrame);
     virtual cv::Mat getColor                (int frame);
+    virtual void    reset                   ()                  { m_frame = Flow(); }
+    virtual FlowMode requiredFlowMode       ()                  const { return NoFlow; }
     bool            havePedestrian          (int frame);
     
 
@@ -0,0 +1,103 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "PushFlowGrabber.h"
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+
+
+PushFlowGrabber::PushFlowGrabber(const cv::Size& sourceSize, float frameRate) : m_nbPushed(0), m_closed(false) {
+    setSource(sourceSize, frameRate);
+}
+
+
+void PushFlowGrabber::setSource(const cv::Size& sourceSize, float frameRate) {
+    m_sourceSize = sourceSize;
+    m_frameRate = frameRate;
+
+    cv::Size size = sourceSize / getScalingFactor();
+    m_size = cv::Size(std::max(2, size.width & ~1), std::max(2, size.height & ~1));
+}
+
+
+bool PushFlowGrabber::push(const cv::Mat& bgr) {
+    if(m_closed) {
+        std::cerr << "[E] PushFlowGrabber::push: the stream is closed." << std::endl;
+        return false;
+    }
+
+    if(bgr.type() != CV_8UC3 || bgr.size() != m_sourceSize) {
+        std::cerr << "[E] PushFlowGrabber::push: expected a BGR frame of " << m_sourceSize.width << "x" << m_sourceSize.height << std::endl;
+        return false;
+    }
+
+    cv::Mat color;
+    cv::resize(bgr, color, m_size, 0, 0, cv::INTER_AREA);
+
+    m_colorFrames.push_back(color);
+    m_yuvFrames.push_back(cv::Mat());
+    ++m_nbPushed;
+    return true;
+}
+
+
+bool PushFlowGrabber::pushI420(const cv::Mat& y, const cv::Mat& u, const cv::Mat& v) {
+    if(m_closed) {
+        std::cerr << "[E] PushFlowGrabber::pushI420: the stream is closed." << std::endl;
+        return false;
+    }
+
+    cv::Size chromaSize((m_sourceSize.width + 1) / 2, (m_sourceSize.height + 1) / 2);
+    if(y.type() != CV_8UC1 || u.type() != CV_8UC1 || v.type() != CV_8UC1
+        || y.size() != m_sourceSize || u.size() != chromaSize || v.size() != chromaSize) {
+        std::cerr << "[E] PushFlowGrabber::pushI420: expected I420 planes of " << m_sourceSize.width << "x" << m_sourceSize.height << std::endl;
+        return false;
+    }
+
+    // the planes are resized straight into the compact layout used by the native YUV ingest
+    cv::Mat yuv(m_size.height * 3 / 2, m_size.width, CV_8UC1);
+    cv::Size uvSize = m_size / 2;
+    cv::Mat uPlane(uvSize, CV_8UC1, yuv.data + m_size.area());
+    cv::Mat vPlane(uvSize, CV_8UC1, yuv.data + m_size.area() + uvSize.area());
+
+    cv::Mat yPlane = yuv.rowRange(0, m_size.height);
+    cv::resize(y, yPlane, m_size, 0, 0, cv::INTER_AREA);
+    cv::resize(u, uPlane, uvSize, 0, 0, cv::INTER_AREA);
+    cv::resize(v, vPlane, uvSize, 0, 0, cv::INTER_AREA);
+
+    m_colorFrames.push_back(cv::Mat());
+    m_yuvFrames.push_back(yuv);
+    ++m_nbPushed;
+    return true;
+}
+
+
+bool PushFlowGrabber::readFrame(cv::Mat& color, cv::Mat& yuv) {
+    if(m_colorFrames.empty()) return false;
+
+    color = m_colorFrames.front();
+    yuv = m_yuvFrames.front();
+    m_colorFrames.pop_front();
+    m_yuvFrames.pop_front();
+    return true;
+}
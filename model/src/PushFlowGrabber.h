@@ -0,0 +1,80 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _PushFlowGrabber_
+#define _PushFlowGrabber_
+
+#include <opencv2/core.hpp>
+#include <deque>
+
+#include "FlowGrabber.h"
+
+
+// Flow of frames given by the caller instead of a decoder (see SaliencyStream). A pushed frame is only
+// read once, to resize it by the scaling factor of the grabber: the caller may reuse its buffer right
+// after the push. The frames wait in a queue until the flow reaches them.
+
+class PushFlowGrabber : public VideoFlowGrabber {
+
+    cv::Size                      m_sourceSize;
+    cv::Size                      m_size;           // resized frames, even for the chroma planes of I420
+    float                         m_frameRate;
+
+    std::deque<cv::Mat>           m_colorFrames;
+    std::deque<cv::Mat>           m_yuvFrames;
+    int                           m_nbPushed;
+    bool                          m_closed;
+
+public:
+    PushFlowGrabber                 (const cv::Size& sourceSize, float frameRate);
+    virtual ~PushFlowGrabber        ()                                  {}
+
+    virtual float getFrameRate      ()                                  { return m_frameRate; }
+    virtual int   getFrameCount     ()                                  { return m_nbPushed; }
+	virtual cv::Size getSourceFrameSize()                               { return m_sourceSize; }
+
+    // 8 bits BGR frame of the source size, any row stride
+    bool          push              (const cv::Mat& bgr);
+
+    // 8 bits I420 planes: luma of the source size, chroma of half the source size, any row strides
+    bool          pushI420          (const cv::Mat& y, const cv::Mat& u, const cv::Mat& v);
+
+    // end of the stream: the flow ends after the last pushed frame
+    inline void   close             ()                                  { m_closed = true; }
+    inline bool   isClosed          ()                                  const { return m_closed; }
+
+    inline int    getNbPushed       ()                                  const { return m_nbPushed; }
+
+    // the frames are resized when pushed: only the stride of the flow can change
+    virtual void  setQuality        (int scalingFactor, int flowStride) { VideoFlowGrabber::setQuality(getScalingFactor(), flowStride); }
+
+protected:
+    // for the sources whose format is only known once opened
+    void          setSource         (const cv::Size& sourceSize, float frameRate);
+
+    virtual bool  isOpened          ()                                  const { return true; }
+    virtual bool  readFrame         (cv::Mat& color, cv::Mat& yuv);
+};
+
+
+#endif
@@ -0,0 +1,89 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "QualityController.h"
+
+
+// averaging of the frame time, and frames to wait after a change for the new level to show
+static const double SMOOTHING       = 0.2;
+static const int    COOLDOWN        = 5;
+
+// the level goes up after HEADROOM_FRAMES frames under HEADROOM * budget
+static const double HEADROOM        = 0.7;
+static const int    HEADROOM_FRAMES = 30;
+
+
+QualityController::QualityController(double budget) : m_budget(budget), m_level(0), m_average(0), m_cooldown(0), m_headroomFrames(0), m_started(false) {
+    //                          BMS dim   step  proj   salmap  multires  scaling  stride
+    QualityLevel levels[] = { { 2000.f,    8,    4,     42,     3,        2,       1 },
+                              { 1200.f,    8,    4,     42,     3,        2,       1 },
+                              {  800.f,   12,    3,     36,     2,        2,       2 },
+                              {  600.f,   16,    2,     32,     2,        3,       2 },
+                              {  400.f,   16,    2,     24,     1,        4,       3 },
+                              {  300.f,   24,    1,     20,     1,        4,       4 } };
+
+    m_levels.assign(levels, levels + sizeof(levels) / sizeof(levels[0]));
+}
+
+
+bool QualityController::frameDone() {
+    using namespace std::chrono;
+    high_resolution_clock::time_point now = high_resolution_clock::now();
+
+    if(!m_started) {
+        m_started = true;
+        m_lastFrame = now;
+        return false;
+    }
+
+    double elapsed = duration_cast<duration<double>>(now - m_lastFrame).count();
+    m_lastFrame = now;
+
+    m_average = m_average > 0 ? (1 - SMOOTHING) * m_average + SMOOTHING * elapsed : elapsed;
+
+    if(m_cooldown > 0) {
+        --m_cooldown;
+        return false;
+    }
+
+    if(m_average > m_budget) {
+        m_headroomFrames = 0;
+        if(m_level + 1 >= static_cast<int>(m_levels.size())) return false;
+
+        ++m_level;
+        m_cooldown = COOLDOWN;
+        return true;
+    }
+
+    if(m_average < HEADROOM * m_budget) {
+        if(++m_headroomFrames < HEADROOM_FRAMES || m_level == 0) return false;
+
+        --m_level;
+        m_headroomFrames = 0;
+        m_cooldown = COOLDOWN;
+        return true;
+    }
+
+    m_headroomFrames = 0;
+    return false;
+}
@@ -0,0 +1,73 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _QualityController_
+#define _QualityController_
+
+#include <chrono>
+#include <vector>
+
+
+// Settings of the expensive parts of the model. The first level is the offline quality (the defaults
+// of the feature maps), the following ones are faster and coarser.
+struct QualityLevel {
+    float   bmsMaxDim;              // BMSSaliency::m_maxDim of the image and object motion maps
+    int     bmsSampleStep;          // BMSSaliency::m_sampleStep
+    int     bmsProjections;         // BMSSaliency::m_nb_projections
+    int     salMapMaxSize;          // MotionSourceFeatureMap::m_salmapmaxsize
+    int     multiRes;               // MotionSourceFeatureMap::m_multires
+    int     flowScaling;            // downscaling of the frames before the flow
+    int     flowStride;             // flow computed every flowStride frames
+};
+
+
+// Real-time mode: adapts the quality level to keep the time between two frames under a budget. The
+// level goes down as soon as the average time exceeds the budget and only goes back up after a while
+// with enough headroom, so that it does not oscillate.
+
+class QualityController {
+
+    std::vector<QualityLevel>       m_levels;
+    double                          m_budget;           // seconds per frame
+    int                             m_level;
+    double                          m_average;          // exponential moving average of the frame time
+    int                             m_cooldown;         // frames before the next change
+    int                             m_headroomFrames;
+
+    bool                            m_started;
+    std::chrono::high_resolution_clock::time_point
+                                    m_lastFrame;
+
+public:
+    QualityController               (double budget);
+
+    // to be called once per frame. Returns true when the level changed
+    bool        frameDone           ();
+
+    inline const QualityLevel& getLevel ()                          const { return m_levels[m_level]; }
+    inline int  getLevelIndex       ()                              const { return m_level; }
+    inline double getAverage        ()                              const { return m_average; }
+};
+
+
+#endif
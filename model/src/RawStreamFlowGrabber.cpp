@@ -0,0 +1,194 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "RawStreamFlowGrabber.h"
+#include "Trace.h"
+#include <iostream>
+#include <sstream>
+#include <climits>
+#include <cstdlib>
+
+#ifdef _WIN32
+    #include <io.h>
+    #include <fcntl.h>
+#endif
+
+
+RawStreamFlowGrabber::RawStreamFlowGrabber(const std::string& path, RawFormat format, const cv::Size& size, float frameRate) : PushFlowGrabber(size, frameRate), m_file(NULL), m_ownsFile(false), m_format(format) {
+
+    if(path == "-") {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        m_file = stdin;
+    } else {
+        // a named pipe blocks here until the writer opens it
+        m_file = fopen(path.c_str(), "rb");
+        m_ownsFile = true;
+    }
+
+    if(m_file == NULL) {
+        std::cerr << "cannot open: " << path << std::endl;
+        return;
+    }
+
+    if(m_format == RawY4M && !readY4MHeader()) {
+        std::cerr << "[E] RawStreamFlowGrabber: invalid YUV4MPEG2 header: " << path << std::endl;
+        if(m_ownsFile) fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+
+    cv::Size sourceSize = getSourceFrameSize();
+    if(sourceSize.area() <= 0) {
+        std::cerr << "[E] RawStreamFlowGrabber: the size of the frames is required" << std::endl;
+        if(m_ownsFile) fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+
+    cv::Size chromaSize((sourceSize.width + 1) / 2, (sourceSize.height + 1) / 2);
+    if(m_format == RawBGR24)
+        m_buffer.resize(sourceSize.area() * 3);
+    else
+        m_buffer.resize(sourceSize.area() + 2 * chromaSize.area());
+}
+
+
+RawStreamFlowGrabber::~RawStreamFlowGrabber() {
+    if(m_file != NULL && m_ownsFile)
+        fclose(m_file);
+}
+
+
+bool RawStreamFlowGrabber::parseFormat(const std::string& name, RawFormat& format) {
+    if(name == "bgr24")         format = RawBGR24;
+    else if(name == "yuv420p")  format = RawYUV420p;
+    else if(name == "y4m")      format = RawY4M;
+    else return false;
+
+    return true;
+}
+
+
+int RawStreamFlowGrabber::getFrameCount() {
+    if(m_file == NULL) return -1;
+    if(isClosed()) return getNbPushed();
+
+    return INT_MAX;
+}
+
+
+bool RawStreamFlowGrabber::readLine(std::string& line) {
+    line.clear();
+
+    int c;
+    while((c = fgetc(m_file)) != EOF && c != '\n')
+        line.push_back(static_cast<char>(c));
+
+    return c == '\n';
+}
+
+
+// YUV4MPEG2 W<width> H<height> F<num>:<den> [I.. A.. C<colorspace> X..]
+bool RawStreamFlowGrabber::readY4MHeader() {
+    std::string line;
+    if(!readLine(line)) return false;
+
+    std::istringstream tokens(line);
+    std::string token;
+    tokens >> token;
+    if(token != "YUV4MPEG2") return false;
+
+    cv::Size size;
+    float frameRate = 30.f;
+    while(tokens >> token) {
+        switch(token[0]) {
+            case 'W': size.width  = atoi(token.c_str() + 1); break;
+            case 'H': size.height = atoi(token.c_str() + 1); break;
+
+            case 'F': {
+                int num = 0, den = 0;
+                if(sscanf(token.c_str() + 1, "%d:%d", &num, &den) == 2 && num > 0 && den > 0)
+                    frameRate = static_cast<float>(num) / den;
+                break;
+            }
+
+            // only 8 bits 4:2:0 (C420, C420jpeg, C420mpeg2, C420paldv)
+            case 'C':
+                if(token != "C420" && token != "C420jpeg" && token != "C420mpeg2" && token != "C420paldv") {
+                    std::cerr << "[E] RawStreamFlowGrabber: unsupported colorspace " << token.substr(1) << std::endl;
+                    return false;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    setSource(size, frameRate);
+    return true;
+}
+
+
+bool RawStreamFlowGrabber::readRawFrame() {
+    if(m_file == NULL) return false;
+
+    if(m_format == RawY4M) {
+        std::string line;
+        if(!readLine(line) || line.compare(0, 5, "FRAME") != 0) return false;
+    }
+
+    // a pipe returns the data by pieces
+    size_t size = 0;
+    while(size < m_buffer.size()) {
+        size_t read = fread(&m_buffer[size], 1, m_buffer.size() - size, m_file);
+        if(read == 0) break;
+        size += read;
+    }
+
+    if(size < m_buffer.size()) return false;
+
+    cv::Size sourceSize = getSourceFrameSize();
+    if(m_format == RawBGR24)
+        return push(cv::Mat(sourceSize, CV_8UC3, &m_buffer[0]));
+
+    cv::Size chromaSize((sourceSize.width + 1) / 2, (sourceSize.height + 1) / 2);
+    unsigned char *u = &m_buffer[0] + sourceSize.area();
+    unsigned char *v = u + chromaSize.area();
+
+    return pushI420(cv::Mat(sourceSize, CV_8UC1, &m_buffer[0]), cv::Mat(chromaSize, CV_8UC1, u), cv::Mat(chromaSize, CV_8UC1, v));
+}
+
+
+bool RawStreamFlowGrabber::readFrame(cv::Mat& color, cv::Mat& yuv) {
+    // one frame is read at a time: the latency is the one of the temporal window of the model
+    if(!isClosed()) {
+        TraceScope trace("decode");
+        if(!readRawFrame())
+            close();
+    }
+
+    return PushFlowGrabber::readFrame(color, yuv);
+}
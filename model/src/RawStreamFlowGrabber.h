@@ -0,0 +1,76 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _RawStreamFlowGrabber_
+#define _RawStreamFlowGrabber_
+
+#include <opencv2/core.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "PushFlowGrabber.h"
+
+
+// Format of the decoded frames read by RawStreamFlowGrabber
+enum RawFormat {
+    RawBGR24,           // packed 8 bits BGR, as ffmpeg -f rawvideo -pix_fmt bgr24
+    RawYUV420p,         // planar 8 bits I420, as ffmpeg -f rawvideo -pix_fmt yuv420p
+    RawY4M              // YUV4MPEG2 stream (4:2:0), carrying its own size and frame rate
+};
+
+
+// Flow of the decoded frames written by another process on stdin or in a named pipe: no container, no
+// decoder, no temporary file. The frames are read as the flow needs them, the end of the stream is the
+// end of the video.
+
+class RawStreamFlowGrabber : public PushFlowGrabber {
+
+    FILE                         *m_file;
+    bool                          m_ownsFile;
+    RawFormat                     m_format;
+    std::vector<unsigned char>    m_buffer;
+
+public:
+    // "-" reads stdin. The size and frame rate are ignored for a Y4M stream
+    RawStreamFlowGrabber            (const std::string& path, RawFormat format, const cv::Size& size, float frameRate);
+    virtual ~RawStreamFlowGrabber   ();
+
+    // unknown (INT_MAX) until the end of the stream is reached, -1 if the stream could not be opened
+    virtual int   getFrameCount     ();
+
+    // bgr24, yuv420p or y4m
+    static bool   parseFormat       (const std::string& name, RawFormat& format);
+
+protected:
+    virtual bool  isOpened          ()                                  const { return m_file != NULL; }
+    virtual bool  readFrame         (cv::Mat& color, cv::Mat& yuv);
+
+private:
+    bool          readLine          (std::string& line);
+    bool          readY4MHeader     ();
+    bool          readRawFrame      ();
+};
+
+
+#endif
@@ -31,12 +31,20 @@
 #include "common-method.h"
 
 #include <iostream>
+#include <limits>
 #include "FlowIO.h"
 #include <chrono>
 
-#include "SalientFeatureFactory.h"
+#include "SaliencyContext.h"
 #include "EquatorialPrior.h"
 #include "TemporalPrior.h"
+#include "QualityController.h"
+#include "MemoryAccounting.h"
+#include "Trace.h"
+
+
+// resolution at which erodeK (iterations of a 3x3 erosion) and the equatorial prior were tuned
+static const cv::Size REFERENCE_SIZE(2048, 1024);
 
 
 
@@ -44,127 +52,226 @@ Saliency360::Saliency360() {
     
     temporalWindow  = 15;
     model           = 6;
-    benchmark       = false;
     m_callCount     = 0;
     equatorialPrior = false;
     temporalPrior   = 0;
 	enableOverlay   = true;
 	ocl				= false;
     erodeK          = 71;
+    frameBudget     = 0;
+
+    m_context       = boost::shared_ptr<SaliencyContext>(new SaliencyContext());
 }
 
 
+Saliency360::Saliency360(const Saliency360& other) :
+    temporalWindow(other.temporalWindow), model(other.model), equatorialPrior(other.equatorialPrior),
+    temporalPrior(other.temporalPrior), enableOverlay(other.enableOverlay), ocl(other.ocl), erodeK(other.erodeK), frameBudget(other.frameBudget), logOutput(other.logOutput),
+    m_callCount(0), m_context(new SaliencyContext()) {
 
+}
 
-cv::Mat Saliency360::compute(int frame) {
 
-    using namespace std::chrono;
 
-    high_resolution_clock::time_point t1 = high_resolution_clock::now();
-    high_resolution_clock::time_point t2;
 
-    cv::Mat master_map;
-    SalientFeatureMap *salientFeature;
+// feature map computing the saliency of the model
+static SalientFeatureFactory::FeatureMap featureOfModel(int model) {
     switch(model) {
-        case 0: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ObjectMotionFeature);
-            break;
-        }
+        case 0:     return SalientFeatureFactory::ObjectMotionFeature;
+        case 1:     return SalientFeatureFactory::MotionSourceFeature;
+        case 2:
+        default:    return SalientFeatureFactory::AdaptiveMotionFeature;
+        case 3:     return SalientFeatureFactory::ImageFeature;
+        case 4:     return SalientFeatureFactory::PedestrianFeature;
+        case 5:     return SalientFeatureFactory::AdaptiveMotionFeature;
+        case 6:     return SalientFeatureFactory::SpatioTemporalFeature;
+    }
+}
 
-        case 1: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::MotionSourceFeature);
-            break;
-        }
 
-        case 2:
-        default: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::AdaptiveMotionFeature);
-            break;
-        }
+SalientFeatureMap* Saliency360::getSalientFeature() const {
+    SalientFeatureMap *salientFeature = m_context->getFactory().getModel(featureOfModel(model));
 
-        case 3: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ImageFeature);
-            break;
+    if(model == 5) {
+        AdaptiveMotionFeatureMap *adaptiveModel = dynamic_cast<AdaptiveMotionFeatureMap*>(salientFeature);
+        if(adaptiveModel) {
+            adaptiveModel->setPedestrianDriven(true);
         }
+    }
 
-        case 4: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::PedestrianFeature);
-            break;
-        }
+    return salientFeature;
+}
 
-        case 5: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::AdaptiveMotionFeature);
-            AdaptiveMotionFeatureMap *adaptiveModel = dynamic_cast<AdaptiveMotionFeatureMap*>(salientFeature);
-            if(adaptiveModel) {
-                adaptiveModel->setPedestrianDriven(true);
-            }
-            break;
-        }
 
-        case 6: {
-            salientFeature = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::SpatioTemporalFeature);
-            break;
-        }
-    }
+FlowMode Saliency360::requiredFlowMode() const {
+    return getSalientFeature()->requiredFlowMode();
+}
+
+
+cv::Mat Saliency360::compute(int frame) {
+    TraceScope trace("frame", frame);
+
+    cv::Mat master_map = computeFeatures(frame);
+
+    applyPriors(frame, master_map);
+    overlay(frame, master_map);
+
+    return master_map;
+}
+
+
+cv::Mat Saliency360::computeFeatures(int frame) {
+    TraceScope trace("features", frame);
+
+    adaptQuality();
+
+    cv::Mat master_map;
+    SalientFeatureMap *salientFeature = getSalientFeature();
 
 	salientFeature->setOCLMode(ocl);
 
 	std::cout << "[FL]";
     salientFeature->grabRequiredData(frame);
-    t2 = high_resolution_clock::now();
 
 	std::cout << "[SM]";
-    master_map = salientFeature->compute(frame);
-
+    master_map = m_context->getFactory().compute(featureOfModel(model), frame, "");
 
+    // the maps of the feature graph are shared, the priors modify the map in place.
+    // erodeK iterations of a 3x3 kernel at the reference size are a single rectangle of the same radius:
+    // the map stays at the resolution of the features, it is resized once, to the output
     if(!master_map.empty() && erodeK > 0) {
-        cv::resize(master_map, master_map, cv::Size(2048, 1024));
-		erode(master_map, master_map, cv::Mat(), cv::Point(-1, -1), erodeK);
+        TraceScope traceErode("erode", frame);
+
+        int rx = static_cast<int>(static_cast<float>(erodeK) * master_map.cols / REFERENCE_SIZE.width + .5f);
+        int ry = static_cast<int>(static_cast<float>(erodeK) * master_map.rows / REFERENCE_SIZE.height + .5f);
+
+        cv::Mat eroded;
+		cv::erode(master_map, eroded, cv::getStructuringElement(cv::MORPH_RECT, cv::Size(2 * rx + 1, 2 * ry + 1)));
+        master_map = eroded;
+    } else {
+        master_map = master_map.clone();
     }
 
+    // the windows and the states of the feature maps are only modified by this thread
+    MemoryAccounting::reportFrame(frame, *m_context);
+    m_context->storeState(frame);
+
+    return master_map;
+}
+
+
+// real-time mode: the time between two frames is the time of the slowest stage of the pipeline
+void Saliency360::adaptQuality() {
+    if(frameBudget <= 0) return;
+
+    if(!m_quality)
+        m_quality = boost::shared_ptr<QualityController>(new QualityController(frameBudget / 1000.0));
+
+    if(!m_quality->frameDone()) return;
+
+    const QualityLevel &level = m_quality->getLevel();
+    m_context->getFactory().setQuality(level);
+    m_context->getFlowManager().setFlowQuality(level.flowScaling, level.flowStride);
+
+    std::cout << "[I] Real-time: quality level " << m_quality->getLevelIndex() << " (" << 1000 * m_quality->getAverage() << " ms per frame)" << std::endl;
+}
+
+
+// both priors weight the map (equatorial: per row, temporal: per column), each followed by a min-max
+// normalization. The normalizations are fused: the scale of the first one cancels in the second, only its
+// offset remains, and the min over the map of the rows weighted is the min of the weighted row minima.
+static void applyPriorWeights(cv::Mat &sMap, const std::vector<float> &rowWeights, const std::vector<float> &colWeights) {
+	float offset = 0.f;
+
+	if (!rowWeights.empty() && !colWeights.empty()) {
+		cv::Mat rowMin;
+		cv::reduce(sMap, rowMin, 1, cv::REDUCE_MIN);
+
+		offset = std::numeric_limits<float>::max();
+		for (int i = 0; i < sMap.rows; ++i)
+			offset = std::min(offset, rowWeights[i] * rowMin.at<float>(i));
+	}
+
+	float mn = std::numeric_limits<float>::max();
+	float mx = -std::numeric_limits<float>::max();
+
+	for (int i = 0; i < sMap.rows; ++i) {
+		float *row = sMap.ptr<float>(i);
+		float rowWeight = rowWeights.empty() ? 1.f : rowWeights[i];
+
+		if (colWeights.empty()) {
+			for (int j = 0; j < sMap.cols; ++j) {
+				row[j] *= rowWeight;
+				mn = std::min(mn, row[j]);
+				mx = std::max(mx, row[j]);
+			}
+		} else {
+			for (int j = 0; j < sMap.cols; ++j) {
+				row[j] = (row[j] * rowWeight - offset) * colWeights[j];
+				mn = std::min(mn, row[j]);
+				mx = std::max(mx, row[j]);
+			}
+		}
+	}
+
+	if (mx > mn)
+		sMap.convertTo(sMap, CV_32F, 1.0 / (mx - mn), -mn / (mx - mn));
+	else
+		sMap.setTo(0.f);
+}
+
+
+void Saliency360::applyPriors(int frame, cv::Mat &sMap) const {
+	if (sMap.empty()) return;
+
+	TraceScope trace("priors", frame);
+
+	std::vector<float> rowWeights, colWeights;
+
 	if (equatorialPrior) {
-		std::cout << "[SP]";
-		applyEquatorialPrior(master_map, FlowManager::get()->getFrame(frame).color);
+		Flow current = m_context->getFlowManager().getFrame(frame);
+		if (current.colorPyramid) {
+			std::cout << "[SP]";
+			gaussianEquatorialWeights(sMap.rows, rowWeights, equatorialLatitude(sMap, *current.colorPyramid, REFERENCE_SIZE.width));
+		}
 	}
-    
+
     if(temporalPrior > 0) {
 		std::cout << "[TP]";
         std::vector<float> startP;
         for(int k = 0 ; k < temporalPrior ; ++k) {
             startP.push_back(0.5f + static_cast<float>(k) * 1.f / static_cast<float>(temporalPrior));
         }
-        applyTemporalPrior(master_map, frame / FlowManager::get()->getFrameRate(), startP);
+        temporalPriorWeights(sMap.cols, frame / m_context->getFlowManager().getFrameRate(), startP, colWeights);
     }
 
-    high_resolution_clock::time_point t3 = high_resolution_clock::now();
-
-	if(enableOverlay)
-	    showOverlay(FlowManager::get()->getFrame(frame).color, master_map);
-
-    
+	if (!rowWeights.empty() || !colWeights.empty())
+		applyPriorWeights(sMap, rowWeights, colWeights);
+}
 
-    duration<double> time_span1 = duration_cast<duration<double>>(t2 - t1);
-    duration<double> time_span2 = duration_cast<duration<double>>(t3 - t2);
-    
-    if(benchmark)
-        std::cout << "Chronometer -- grab " << time_span1.count() << " computeFeature " << time_span2.count() << std::endl;
-    
 
-    return master_map;
+void Saliency360::overlay(int frame, cv::Mat &sMap) const {
+	if(enableOverlay && !sMap.empty()) {
+	    TraceScope trace("overlay", frame);
+	    showOverlay(m_context->getFlowManager().getFrame(frame), sMap);
+	}
 }
 
 
-
-void Saliency360::showOverlay(const cv::Mat &colorImage, cv::Mat &sMap) const {
-    if (colorImage.empty()) {
+void Saliency360::showOverlay(const Flow &frame, cv::Mat &sMap) const {
+    if (!frame.hasColor()) {
         std::cout << "color image is empty..." << std::endl;
     }  else {
 
-        cv::Mat localColor;
-        cv::resize(colorImage, localColor, sMap.size(), 0, 0);
+        // the maps stay at the resolution of the features, the overlay is shown at the reference size
+        cv::Mat shown = sMap;
+        if (erodeK > 0 && sMap.size() != REFERENCE_SIZE)
+            cv::resize(sMap, shown, REFERENCE_SIZE);
+
+        cv::Mat localColor = frame.resizedColor(shown.size(), cv::INTER_LINEAR).clone();
 
-        localColor.forEach<cv::Point3_<unsigned char>>([sMap](cv::Point3_<unsigned char> &p, const int *position) -> void {
-            float sal = sMap.at<float>(position[0], position[1]);
+        localColor.forEach<cv::Point3_<unsigned char>>([shown](cv::Point3_<unsigned char> &p, const int *position) -> void {
+            float sal = shown.at<float>(position[0], position[1]);
             p.x = static_cast<int>(p.x) / 2;
             p.y = static_cast<int>(p.y) / 2;
             p.z = std::min(255.f, static_cast<int>(p.z) / 2 + 255 * sal);
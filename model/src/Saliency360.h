@@ -31,6 +31,12 @@
 
 #include <boost/shared_ptr.hpp>
 
+#include "FlowGrabber.h"
+
+class SalientFeatureMap;
+class SaliencyContext;
+class QualityController;
+
 
 class Saliency360 {
 
@@ -38,12 +44,12 @@ public:
     
     int                 temporalWindow;
     int                 model;
-    bool                benchmark;
     bool                equatorialPrior;
     int                 temporalPrior;
 	bool				enableOverlay;
 	bool				ocl;
     int                 erodeK;
+    float               frameBudget;        // real-time mode: time per frame in ms, the quality is adapted to it. 0 for the offline quality
     
     std::string         logOutput;
     
@@ -52,16 +58,36 @@ private:
     cv::Mat                              m_curColorFrame;
     int                                  m_callCount;
 
+    boost::shared_ptr<SaliencyContext>   m_context;
+    boost::shared_ptr<QualityController> m_quality;
+
 public:
     Saliency360                     ();
+
+    // copies the settings. The copy is a distinct engine, with its own context
+    Saliency360                     (const Saliency360& other);
+
+    inline SaliencyContext* getContext()                                                                         const { return m_context.get(); }
     
 
     cv::Mat compute                 (int frame);
 
+    // stages of compute, to be called in this order for each frame. A stage processes the frames in order
+    cv::Mat computeFeatures         (int frame);
+    void    applyPriors             (int frame, cv::Mat &sMap)                                                   const;
+    void    overlay                 (int frame, cv::Mat &sMap)                                                   const;
+
+    // motion required by the selected model, to be set on the flow grabber
+    FlowMode requiredFlowMode       ()                                                                           const;
+
 
 private:
 
-    void    showOverlay             (const cv::Mat &colorImage, cv::Mat &sMap)                                   const;
+    Saliency360& operator=          (const Saliency360&);
+
+    SalientFeatureMap* getSalientFeature()                                                                       const;
+    void    adaptQuality            ();
+    void    showOverlay             (const Flow &frame, cv::Mat &sMap)                                           const;
 
     void    cameraMotionEstimation  (int frame);
     std::vector<float>  flowClassif (int frame);
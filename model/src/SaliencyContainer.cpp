@@ -0,0 +1,419 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "SaliencyContainer.h"
+#include "SaliencyWriter.h"
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <boost/interprocess/exceptions.hpp>
+
+
+namespace {
+
+    const char  CONTAINER_MAGIC[8]  = { 'V', 'B', 'M', 'S', 'S', 'A', 'L', 'C' };
+    const int   CONTAINER_VERSION   = 1;
+
+    struct ContainerHeader {
+        char                magic[8];
+        int                 version;
+        int                 nbFrames;
+        int                 width;
+        int                 height;
+        float               frameRate;
+        int                 model;
+        int                 bits;
+        int                 parametersSize;
+        unsigned long long  indexOffset;
+    };
+
+    inline void putVarint(std::vector<unsigned char>& out, unsigned int value) {
+        while(value >= 0x80) {
+            out.push_back(static_cast<unsigned char>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<unsigned char>(value));
+    }
+
+    inline bool getVarint(const unsigned char *&src, const unsigned char *end, unsigned int& value) {
+        value = 0;
+        for(int shift = 0 ; src < end && shift < 32 ; shift += 7) {
+            unsigned char byte = *src++;
+            value |= static_cast<unsigned int>(byte & 0x7f) << shift;
+            if(!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    // quantized map -> (zigzag residual | 0, run)* 
+    void encodeMap(const cv::Mat& map, int bits, SaliencyContainerIndex& entry, std::vector<unsigned char>& out) {
+        double mn, mx;
+        cv::minMaxLoc(map, &mn, &mx);
+
+        float levels = static_cast<float>((1 << bits) - 1);
+        entry.bias  = static_cast<float>(mn);
+        entry.scale = mx > mn ? static_cast<float>(mx - mn) / levels : 1.f;
+
+        std::vector<int> previous(map.cols, 0), current(map.cols, 0);
+        unsigned int run = 0;
+        out.clear();
+
+        for(int i = 0 ; i < map.rows ; ++i) {
+            const float *src = map.ptr<float>(i);
+            for(int j = 0 ; j < map.cols ; ++j)
+                current[j] = static_cast<int>(std::min(levels, std::max(0.f, std::round((src[j] - entry.bias) / entry.scale))));
+
+            for(int j = 0 ; j < map.cols ; ++j) {
+                int left    = j > 0 ? current[j-1] : 0;
+                int upLeft  = j > 0 ? previous[j-1] : 0;
+                int residual = current[j] - left - previous[j] + upLeft;
+
+                if(residual == 0) {
+                    ++run;
+                    continue;
+                }
+
+                if(run > 0) {
+                    putVarint(out, 0);
+                    putVarint(out, run);
+                    run = 0;
+                }
+                putVarint(out, (static_cast<unsigned int>(residual) << 1) ^ static_cast<unsigned int>(residual >> 31));
+            }
+
+            std::swap(previous, current);
+        }
+
+        if(run > 0) {
+            putVarint(out, 0);
+            putVarint(out, run);
+        }
+    }
+
+    // the gradient predictor is inverted by a cumulative sum over the columns, then over the rows
+    bool decodeMap(const unsigned char *src, const unsigned char *end, const SaliencyContainerIndex& entry, cv::Mat& map) {
+        std::vector<int> columns(map.cols, 0);
+        unsigned int run = 0;
+
+        for(int i = 0 ; i < map.rows ; ++i) {
+            float *dst = map.ptr<float>(i);
+            int value = 0;
+
+            for(int j = 0 ; j < map.cols ; ++j) {
+                int residual = 0;
+
+                if(run > 0) {
+                    --run;
+                } else {
+                    unsigned int token;
+                    if(!getVarint(src, end, token)) return false;
+
+                    if(token == 0) {
+                        if(!getVarint(src, end, run) || run == 0) return false;
+                        --run;
+                    } else {
+                        residual = static_cast<int>(token >> 1) ^ -static_cast<int>(token & 1);
+                    }
+                }
+
+                columns[j] += residual;
+                value += columns[j];
+                dst[j] = value * entry.scale + entry.bias;
+            }
+        }
+
+        return true;
+    }
+
+}
+
+
+bool isSaliencyContainer(const std::string& filename) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if(f == NULL) return false;
+
+    char magic[8];
+    bool valid = fread(magic, 1, sizeof(magic), f) == sizeof(magic) && std::memcmp(magic, CONTAINER_MAGIC, sizeof(magic)) == 0;
+    fclose(f);
+
+    return valid;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// Writer
+
+SaliencyContainerWriter::SaliencyContainerWriter() : m_file(NULL), m_bits(16), m_offset(0) {
+
+}
+
+
+SaliencyContainerWriter::~SaliencyContainerWriter() {
+    close();
+}
+
+
+bool SaliencyContainerWriter::open(const std::string& filename, float frameRate, int model, int bits, const std::string& parameters) {
+    // the header is read back and completed on close
+    m_file = fopen(filename.c_str(), "w+b");
+    if(m_file == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    m_bits = bits <= 8 ? 8 : 16;
+    m_size = cv::Size();
+    m_index.clear();
+    m_lastMap.release();
+    m_lastData.clear();
+
+    ContainerHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC));
+    header.version          = CONTAINER_VERSION;
+    header.frameRate        = frameRate;
+    header.model            = model;
+    header.bits             = m_bits;
+    header.parametersSize   = static_cast<int>(parameters.size());
+
+    // the frame count, the size and the index are known at the end
+    bool ok = fwrite(&header, sizeof(header), 1, m_file) == 1;
+    if(!parameters.empty())
+        ok = ok && fwrite(parameters.data(), 1, parameters.size(), m_file) == parameters.size();
+
+    m_offset = sizeof(header) + parameters.size();
+
+    if(!ok) {
+        std::cerr << "[E] SaliencyContainerWriter::open: cannot write " << filename << std::endl;
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    return ok;
+}
+
+
+bool SaliencyContainerWriter::append(const cv::Mat& map) {
+    if(m_file == NULL) return false;
+
+    SaliencyContainerIndex entry;
+    std::memset(&entry, 0, sizeof(entry));
+    entry.offset    = m_offset;
+    entry.reference = static_cast<int>(m_index.size());
+    entry.scale     = 1.f;
+
+    if(map.empty()) {
+        m_index.push_back(entry);
+        return true;
+    }
+
+    if(m_size.area() == 0) m_size = map.size();
+    if(map.size() != m_size || map.type() != CV_32F) {
+        std::cerr << "[E] SaliencyContainerWriter::append: the maps must be CV_32F, of a single size" << std::endl;
+        return false;
+    }
+
+    // the padding at the end of a video repeats the same map
+    if(!m_index.empty() && m_index.back().size > 0 && map.data == m_lastMap.data) {
+        m_index.push_back(m_index.back());
+        return true;
+    }
+
+    encodeMap(map, m_bits, entry, m_data);
+    m_lastMap = map;
+
+    const SaliencyContainerIndex *last = m_index.empty() ? NULL : &m_index.back();
+    if(last != NULL && last->size > 0 && last->scale == entry.scale && last->bias == entry.bias && m_data == m_lastData) {
+        m_index.push_back(*last);
+        return true;
+    }
+
+    entry.size = static_cast<unsigned int>(m_data.size());
+    if(fwrite(m_data.data(), 1, m_data.size(), m_file) != m_data.size()) return false;
+
+    m_offset += m_data.size();
+    m_lastData.swap(m_data);
+    m_index.push_back(entry);
+
+    return true;
+}
+
+
+bool SaliencyContainerWriter::flush() {
+    return m_file != NULL && SaliencyWriter::syncFile(m_file);
+}
+
+
+bool SaliencyContainerWriter::resume(const std::string& filename, const std::vector<SaliencyContainerIndex>& index, unsigned long long offset, const cv::Size& size) {
+    m_file = fopen(filename.c_str(), "r+b");
+    if(m_file == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    // the settings of the run are in the header, the frame count and the index are written on close
+    ContainerHeader header;
+    bool ok = fread(&header, sizeof(header), 1, m_file) == 1 && std::memcmp(header.magic, CONTAINER_MAGIC, sizeof(CONTAINER_MAGIC)) == 0;
+    ok = ok && offset >= sizeof(header) + static_cast<unsigned long long>(header.parametersSize);
+    ok = ok && SaliencyWriter::truncateFile(m_file, static_cast<long long>(offset)) && fseek(m_file, 0, SEEK_END) == 0;
+
+    if(!ok) {
+        std::cerr << "[E] SaliencyContainerWriter::resume: " << filename << " does not match its checkpoint" << std::endl;
+        fclose(m_file);
+        m_file = NULL;
+        return false;
+    }
+
+    m_bits   = header.bits;
+    m_offset = offset;
+    m_size   = size;
+    m_index  = index;
+    m_lastMap.release();
+    m_lastData.clear();
+
+    return true;
+}
+
+
+bool SaliencyContainerWriter::writeHeader(int nbFrames, unsigned long long indexOffset) {
+    ContainerHeader header;
+
+    fseek(m_file, 0, SEEK_SET);
+    if(fread(&header, sizeof(header), 1, m_file) != 1) return false;
+
+    header.nbFrames     = nbFrames;
+    header.width        = m_size.width;
+    header.height       = m_size.height;
+    header.indexOffset  = indexOffset;
+
+    fseek(m_file, 0, SEEK_SET);
+    return fwrite(&header, sizeof(header), 1, m_file) == 1;
+}
+
+
+bool SaliencyContainerWriter::close() {
+    if(m_file == NULL) return true;
+
+    fseek(m_file, 0, SEEK_END);
+    bool ok = m_index.empty() || fwrite(m_index.data(), sizeof(SaliencyContainerIndex), m_index.size(), m_file) == m_index.size();
+    ok = ok && writeHeader(static_cast<int>(m_index.size()), m_offset);
+
+    fclose(m_file);
+    m_file = NULL;
+    m_lastMap.release();
+
+    return ok;
+}
+
+
+
+// ------------------------------------------------------------------------------------------------
+// Reader
+
+SaliencyContainer::SaliencyContainer() : m_index(NULL), m_nbFrames(0), m_frameRate(0), m_model(0), m_bits(16) {
+
+}
+
+
+bool SaliencyContainer::open(const std::string& filename) {
+    m_index     = NULL;
+    m_nbFrames  = 0;
+
+    if(!isSaliencyContainer(filename)) {
+        std::cerr << "[E] SaliencyContainer::open: " << filename << " is not a saliency container" << std::endl;
+        return false;
+    }
+
+    try {
+        m_file   = boost::interprocess::file_mapping(filename.c_str(), boost::interprocess::read_only);
+        m_region = boost::interprocess::mapped_region(m_file, boost::interprocess::read_only);
+    } catch(boost::interprocess::interprocess_exception &e) {
+        std::cerr << "[E] SaliencyContainer::open: cannot map " << filename << " (" << e.what() << ")" << std::endl;
+        return false;
+    }
+
+    unsigned long long fileSize = m_region.get_size();
+    if(fileSize < sizeof(ContainerHeader)) {
+        std::cerr << "[E] SaliencyContainer::open: " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    const char *base = static_cast<const char*>(m_region.get_address());
+    const ContainerHeader *header = reinterpret_cast<const ContainerHeader*>(base);
+
+    if(header->version != CONTAINER_VERSION) {
+        std::cerr << "[E] SaliencyContainer::open: unsupported version " << header->version << std::endl;
+        return false;
+    }
+
+    // the fields read below must describe data inside the file
+    if(header->nbFrames < 0 || header->width < 0 || header->height < 0 || header->parametersSize < 0
+       || sizeof(ContainerHeader) + static_cast<unsigned long long>(header->parametersSize) > fileSize) {
+        std::cerr << "[E] SaliencyContainer::open: " << filename << " has an invalid header" << std::endl;
+        return false;
+    }
+
+    // a container which was not closed has no index
+    unsigned long long indexSize = static_cast<unsigned long long>(header->nbFrames) * sizeof(SaliencyContainerIndex);
+    if(header->indexOffset > fileSize || indexSize > fileSize - header->indexOffset || (header->nbFrames > 0 && header->indexOffset == 0)) {
+        std::cerr << "[E] SaliencyContainer::open: " << filename << " is truncated" << std::endl;
+        return false;
+    }
+
+    m_size          = cv::Size(header->width, header->height);
+    m_frameRate     = header->frameRate;
+    m_model         = header->model;
+    m_bits          = header->bits;
+    m_parameters    = std::string(base + sizeof(ContainerHeader), header->parametersSize);
+    m_nbFrames      = header->nbFrames;
+    m_index         = reinterpret_cast<const SaliencyContainerIndex*>(base + header->indexOffset);
+
+    return true;
+}
+
+
+cv::Mat SaliencyContainer::getFrame(int frame) const {
+    if(m_index == NULL || frame < 0 || frame >= m_nbFrames) return cv::Mat();
+
+    const SaliencyContainerIndex &entry = m_index[frame];
+    if(entry.size == 0 || m_size.area() == 0) return cv::Mat();
+
+    unsigned long long fileSize = m_region.get_size();
+    if(entry.offset > fileSize || entry.size > fileSize - entry.offset) {
+        std::cerr << "[E] SaliencyContainer::getFrame: frame " << frame << " is out of the file" << std::endl;
+        return cv::Mat();
+    }
+
+    const unsigned char *data = static_cast<const unsigned char*>(m_region.get_address()) + entry.offset;
+
+    cv::Mat map(m_size, CV_32F);
+    if(!decodeMap(data, data + entry.size, entry, map)) {
+        std::cerr << "[E] SaliencyContainer::getFrame: frame " << frame << " is corrupted" << std::endl;
+        return cv::Mat();
+    }
+
+    return map;
+}
@@ -0,0 +1,137 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+
+#ifndef _SaliencyContainer_
+#define _SaliencyContainer_
+
+
+#include <opencv2/core.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+
+// ------------------------------------------------------------------------------------------------
+// Saliency container (.vsc): the maps of a video in a single file, with the settings of the run and
+// an index to seek to any frame. Layout (little-endian):
+//   header:      magic 'VBMSSALC', version, nbFrames, width, height, frame rate, model, bits, parameters size, index offset
+//   parameters:  text of the options of the run
+//   data:        compressed maps
+//   index:       nbFrames x (offset, size, reference, scale, bias), written once all the maps are in
+//
+// The maps are quantized on 8 or 16 bits between their min and max. The residual of the gradient
+// predictor (left + up - upleft) is zigzag coded in varints, with the runs of zeros collapsed to
+// (0, run length). A map identical to the previous one shares its data: 'reference' is the frame
+// which owns it.
+
+struct SaliencyContainerIndex {
+    unsigned long long  offset;
+    unsigned int        size;
+    int                 reference;
+    float               scale;
+    float               bias;
+};
+
+
+class SaliencyContainerWriter {
+
+    FILE                               *m_file;
+    int                                 m_bits;
+    unsigned long long                  m_offset;
+    cv::Size                            m_size;
+    std::vector<SaliencyContainerIndex> m_index;
+
+    cv::Mat                             m_lastMap;
+    std::vector<unsigned char>          m_lastData;
+    std::vector<unsigned char>          m_data;
+
+public:
+    SaliencyContainerWriter             ();
+    ~SaliencyContainerWriter            ();
+
+    // bits: 8 or 16
+    bool    open                        (const std::string& filename, float frameRate, int model, int bits, const std::string& parameters);
+
+    // CV_32F map. The map must not be modified afterwards: a map appended twice is stored once
+    bool    append                      (const cv::Mat& map);
+
+    // writes the index. False if a write failed
+    bool    close                       ();
+
+    // the maps appended so far on disk, with the index to resume the container after an interruption
+    bool    flush                       ();
+    inline unsigned long long
+            getOffset                   ()                              const { return m_offset; }
+    inline const std::vector<SaliencyContainerIndex>&
+            getIndex                    ()                              const { return m_index; }
+    inline cv::Size
+            getSize                     ()                              const { return m_size; }
+
+    // reopens an unfinished container: the data after offset is dropped, the maps are appended after it
+    bool    resume                      (const std::string& filename, const std::vector<SaliencyContainerIndex>& index, unsigned long long offset, const cv::Size& size);
+
+private:
+    SaliencyContainerWriter             (const SaliencyContainerWriter&);
+    SaliencyContainerWriter& operator=  (const SaliencyContainerWriter&);
+
+    bool    writeHeader                 (int nbFrames, unsigned long long indexOffset);
+};
+
+
+class SaliencyContainer {
+
+    boost::interprocess::file_mapping   m_file;
+    boost::interprocess::mapped_region  m_region;
+
+    const SaliencyContainerIndex       *m_index;
+    int                                 m_nbFrames;
+    cv::Size                            m_size;
+    float                               m_frameRate;
+    int                                 m_model;
+    int                                 m_bits;
+    std::string                         m_parameters;
+
+public:
+    SaliencyContainer                   ();
+
+    bool    open                        (const std::string& filename);
+
+    inline int          size            ()                          const { return m_nbFrames; }
+    inline cv::Size     getFrameSize    ()                          const { return m_size; }
+    inline float        getFrameRate    ()                          const { return m_frameRate; }
+    inline int          getModel        ()                          const { return m_model; }
+    inline const std::string&
+                        getParameters   ()                          const { return m_parameters; }
+
+    // decoded CV_32F map, empty if the frame had no map
+    cv::Mat getFrame                    (int frame)                 const;
+};
+
+
+bool isSaliencyContainer                (const std::string& filename);
+
+
+#endif
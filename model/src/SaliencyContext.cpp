@@ -0,0 +1,91 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "SaliencyContext.h"
+#include "MemoryAccounting.h"
+#include <boost/bind.hpp>
+
+
+static cv::Mat grabFlow(FlowManager *flowManager, int frame) {
+    return flowManager->getFrame(frame).frame;
+}
+
+
+cv::Mat SaliencyContext::getFlow(int frame, const std::string& consumer) {
+    return m_featureGraph.get(frame, "flow", consumer, boost::bind(grabFlow, &m_flowManager, frame));
+}
+
+
+void SaliencyContext::collectMemory(MemoryReport& report) {
+    m_flowManager.collectMemory(report);
+    m_factory.collectMemory(report);
+    m_featureGraph.collectMemory(report);
+}
+
+
+void SaliencyContext::keepStates(bool enable) {
+    boost::mutex::scoped_lock lock(m_stateLock);
+    m_keepStates = enable;
+    m_states.clear();
+}
+
+
+void SaliencyContext::storeState(int frame) {
+    {
+        boost::mutex::scoped_lock lock(m_stateLock);
+        if(!m_keepStates) return;
+    }
+
+    std::map<std::string, cv::Mat> state;
+    m_factory.saveState(state);
+
+    boost::mutex::scoped_lock lock(m_stateLock);
+    m_states[frame].swap(state);
+}
+
+
+bool SaliencyContext::takeState(int frame, std::map<std::string, cv::Mat>& state) {
+    boost::mutex::scoped_lock lock(m_stateLock);
+
+    std::map<int, std::map<std::string, cv::Mat> >::iterator it = m_states.find(frame);
+    bool found = it != m_states.end();
+    if(found) state.swap(it->second);
+
+    m_states.erase(m_states.begin(), m_states.upper_bound(frame));
+    return found;
+}
+
+
+void SaliencyContext::restoreState(const std::map<std::string, cv::Mat>& state) {
+    m_factory.restoreState(state);
+}
+
+
+void SaliencyContext::reset() {
+    m_flowManager.setFlowGrabber(boost::shared_ptr<FlowGrabber>());
+    m_factory.reset();
+    m_featureGraph.clear();
+
+    boost::mutex::scoped_lock lock(m_stateLock);
+    m_states.clear();
+}
@@ -0,0 +1,79 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _SaliencyContext_
+#define _SaliencyContext_
+
+#include "FlowGrabber.h"
+#include "SalientFeatureFactory.h"
+#include "FeatureGraph.h"
+#include <map>
+#include <string>
+
+
+// State of one saliency engine: the input (grabber and cache of frames), the feature maps with
+// their per-video state and their outputs of the current frames. Each Saliency360 owns its context, so several engines can process
+// different videos concurrently. The worker pool and the loaded classifiers are shared.
+
+class SaliencyContext {
+
+    FlowManager                     m_flowManager;
+    SalientFeatureFactory           m_factory;
+    FeatureGraph                    m_featureGraph;
+
+    // state of the feature maps after each frame, until the output of the frame takes it
+    bool                            m_keepStates;
+    std::map<int, std::map<std::string, cv::Mat> >
+                                    m_states;
+    boost::mutex                    m_stateLock;
+
+public:
+    SaliencyContext                 () : m_factory(this), m_keepStates(false) {}
+
+    inline FlowManager&             getFlowManager  ()                  { return m_flowManager; }
+    inline SalientFeatureFactory&   getFactory      ()                  { return m_factory; }
+    inline FeatureGraph&            getFeatureGraph ()                  { return m_featureGraph; }
+
+    // flow of frame, as a node of the feature graph
+    cv::Mat                         getFlow         (int frame, const std::string& consumer);
+
+    // the buffers held by the engine: cache of frames, feature maps, outputs of the feature graph
+    void                            collectMemory   (MemoryReport& report);
+
+    // checkpoints: the state of the feature maps is kept after each frame (storeState, by the feature maps
+    // thread) until its output (takeState, which drops the states of the previous frames)
+    void                            keepStates      (bool enable);
+    void                            storeState      (int frame);
+    bool                            takeState       (int frame, std::map<std::string, cv::Mat>& state);
+    void                            restoreState    (const std::map<std::string, cv::Mat>& state);
+
+    // before processing another video: drops the cached frames and the state of the feature maps
+    void                            reset           ();
+
+private:
+    SaliencyContext                 (const SaliencyContext&);
+    SaliencyContext& operator=      (const SaliencyContext&);
+};
+
+
+#endif
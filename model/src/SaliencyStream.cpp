@@ -0,0 +1,118 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "SaliencyStream.h"
+#include <opencv2/imgproc.hpp>
+
+#include "PushFlowGrabber.h"
+#include "SaliencyContext.h"
+
+
+SaliencyStream::SaliencyStream(const Saliency360& settings, const cv::Size& frameSize, float frameRate, const cv::Size& outputSize, int flowStride) : m_salient(settings), m_outputSize(outputSize), m_nextFrame(0), m_ended(false) {
+    if(m_outputSize.area() <= 0)
+        m_outputSize = frameSize;
+
+    // the maps are given to the caller, nothing is displayed or written
+    m_salient.enableOverlay = false;
+    m_salient.logOutput.clear();
+
+    m_grabber = boost::shared_ptr<PushFlowGrabber>(new PushFlowGrabber(frameSize, frameRate));
+    m_grabber->setFlowStride(flowStride);
+    m_grabber->setFlowMode(m_salient.requiredFlowMode());
+
+    // the motion feature maps look at the frames [f, f + temporalWindow[, the grabber decodes blocks of stride frames
+    int window = m_salient.requiredFlowMode() == NoFlow ? 1 : std::max(1, m_salient.temporalWindow);
+    m_lookahead = window + std::max(1, flowStride);
+
+    FlowManager& flowManager = m_salient.getContext()->getFlowManager();
+    flowManager.setFlowGrabber(m_grabber);
+    flowManager.setCacheSize(std::max(flowManager.getCacheSize(), static_cast<size_t>(2 * m_lookahead)));
+}
+
+
+bool SaliencyStream::push(const cv::Mat& bgr) {
+    if(!m_grabber->push(bgr)) return false;
+
+    process();
+    return true;
+}
+
+
+bool SaliencyStream::pushI420(const cv::Mat& y, const cv::Mat& u, const cv::Mat& v) {
+    if(!m_grabber->pushI420(y, u, v)) return false;
+
+    process();
+    return true;
+}
+
+
+void SaliencyStream::flush() {
+    if(m_grabber->isClosed()) return;
+
+    m_grabber->close();
+    process();
+}
+
+
+bool SaliencyStream::pull(cv::Mat& map) {
+    if(m_maps.empty()) return false;
+
+    m_maps.front().copyTo(map);
+    m_maps.pop_front();
+    return true;
+}
+
+
+void SaliencyStream::process() {
+    int nbPushed = m_grabber->getNbPushed();
+
+    while(!m_ended && m_nextFrame < nbPushed) {
+        // the grabber maps frame 0 to frame 1
+        if(!m_grabber->isClosed() && std::max(m_nextFrame, 1) + m_lookahead > nbPushed) return;
+
+        cv::Mat map = m_salient.computeFeatures(m_nextFrame);
+        if(map.empty()) {
+            m_ended = true;
+            break;
+        }
+
+        m_salient.applyPriors(m_nextFrame, map);
+
+        cv::Mat output;
+        cv::resize(map, output, m_outputSize);
+        output.convertTo(output, CV_32F);
+
+        m_maps.push_back(output);
+        m_lastMap = output;
+        ++m_nextFrame;
+    }
+
+    if(!m_grabber->isClosed()) return;
+
+    // Perform padding to have the same number of maps as pushed frames
+    if(m_lastMap.empty())
+        m_lastMap = cv::Mat::zeros(m_outputSize, CV_32F);
+
+    for( ; m_nextFrame < nbPushed ; ++m_nextFrame)
+        m_maps.push_back(m_lastMap);
+}
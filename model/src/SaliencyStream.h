@@ -0,0 +1,79 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _SaliencyStream_
+#define _SaliencyStream_
+
+#include <opencv2/core.hpp>
+#include <boost/shared_ptr.hpp>
+#include <deque>
+
+#include "Saliency360.h"
+
+class PushFlowGrabber;
+
+
+// Saliency of a video whose frames are given one at a time by the caller (see vbms360.h). A frame is
+// processed as soon as the frames of its temporal window have been pushed: the maps come out with a
+// delay of about temporalWindow + flow stride frames, the last ones after flush. There is one map per
+// pushed frame, in order. Not thread safe: one stream per thread, the streams share the worker pool.
+
+class SaliencyStream {
+
+    Saliency360                         m_salient;
+    boost::shared_ptr<PushFlowGrabber>  m_grabber;
+    cv::Size                            m_outputSize;
+    int                                 m_lookahead;    // frames to push after a frame before processing it
+
+    int                                 m_nextFrame;
+    bool                                m_ended;
+    cv::Mat                             m_lastMap;
+    std::deque<cv::Mat>                 m_maps;
+
+public:
+    // the settings (model, priors) are copied. An empty output size keeps the size of the frames
+    SaliencyStream                      (const Saliency360& settings, const cv::Size& frameSize, float frameRate, const cv::Size& outputSize, int flowStride = 1);
+
+    // the frame is resized when pushed, the buffers can be reused right after. Maps may become available
+    bool            push                (const cv::Mat& bgr);
+    bool            pushI420            (const cv::Mat& y, const cv::Mat& u, const cv::Mat& v);
+
+    // end of the stream: the maps of all the pushed frames become available. No frame can be pushed after
+    void            flush               ();
+
+    // next map, CV_32F of the output size. When map already has this size and type, it is written in
+    // place (e.g. a header on a buffer of the caller). Returns false when no map is available yet
+    bool            pull                (cv::Mat& map);
+    inline size_t   available           ()                                  const { return m_maps.size(); }
+
+    inline cv::Size getOutputSize       ()                                  const { return m_outputSize; }
+
+private:
+    SaliencyStream                      (const SaliencyStream&);
+    SaliencyStream& operator=           (const SaliencyStream&);
+
+    void            process             ();
+};
+
+
+#endif
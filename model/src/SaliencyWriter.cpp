@@ -0,0 +1,350 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "SaliencyWriter.h"
+#include "Trace.h"
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <boost/bind.hpp>
+
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+
+// maps queued between the computation and the disk
+static const int QUEUE_DEPTH = 2;
+
+
+// IEEE 754 half precision, rounded to nearest
+static unsigned short toHalf(float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    unsigned int sign = (bits >> 16) & 0x8000;
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    unsigned int mantissa = bits & 0x7fffff;
+
+    if(exponent <= 0) {
+        // subnormal or zero
+        if(exponent < -10) return static_cast<unsigned short>(sign);
+        mantissa |= 0x800000;
+        unsigned int shift = 14 - exponent;
+        unsigned int half = mantissa >> shift;
+        if((mantissa >> (shift - 1)) & 1) ++half;
+        return static_cast<unsigned short>(sign | half);
+    }
+
+    // overflow, infinity and NaN
+    if(exponent >= 31) return static_cast<unsigned short>(sign | 0x7c00 | (((bits >> 23) & 0xff) == 0xff && mantissa ? 0x200 : 0));
+
+    unsigned int half = sign | (exponent << 10) | (mantissa >> 13);
+    if(mantissa & 0x1000) ++half;       // the carry may round up to the next exponent, as expected
+    return static_cast<unsigned short>(half);
+}
+
+
+SaliencyWriter::SaliencyWriter() : m_file(NULL), m_format(SampleFloat32), m_headerDone(false), m_failed(false), m_offset(0), m_nbFrames(0), m_queue(QUEUE_DEPTH) {
+
+}
+
+
+SaliencyWriter::~SaliencyWriter() {
+    close();
+}
+
+
+bool SaliencyWriter::parseFormat(const std::string& name, SampleFormat& format) {
+    if(name == "float32")       format = SampleFloat32;
+    else if(name == "float16")  format = SampleFloat16;
+    else if(name == "uint16")   format = SampleUInt16;
+    else if(name == "uint8")    format = SampleUInt8;
+    else return false;
+
+    return true;
+}
+
+
+bool SaliencyWriter::open(const std::string& filename, SampleFormat format) {
+    m_file = fopen(filename.c_str(), "wb");
+    if(m_file == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    m_format = format;
+    m_headerDone = (format == SampleFloat32);
+    m_failed = false;
+    m_offset = 0;
+    m_nbFrames = 0;
+    m_thread = boost::thread(boost::bind(&SaliencyWriter::writerLoop, this));
+    return true;
+}
+
+
+bool SaliencyWriter::resume(const std::string& filename, SampleFormat format, const OutputPosition& position) {
+    m_file = fopen(filename.c_str(), "r+b");
+    if(m_file == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    if(!truncateFile(m_file, position.offset) || fseek(m_file, 0, SEEK_END) != 0) {
+        std::cerr << "[E] SaliencyWriter::resume: " << filename << " is shorter than its checkpoint" << std::endl;
+        fclose(m_file);
+        m_file = NULL;
+        return false;
+    }
+
+    // the header is written with the first map
+    m_format = format;
+    m_headerDone = (format == SampleFloat32) || position.offset > 0;
+    m_failed = false;
+    m_offset = position.offset;
+    m_nbFrames = position.nbFrames;
+    m_thread = boost::thread(boost::bind(&SaliencyWriter::writerLoop, this));
+    return true;
+}
+
+
+bool SaliencyWriter::resumeContainer(const std::string& filename, const OutputPosition& position) {
+    m_container.reset(new SaliencyContainerWriter());
+    if(!m_container->resume(filename, position.index, static_cast<unsigned long long>(position.offset), position.size)) {
+        m_container.reset();
+        return false;
+    }
+
+    m_file = NULL;
+    m_failed = false;
+    m_nbFrames = position.nbFrames;
+    m_thread = boost::thread(boost::bind(&SaliencyWriter::writerLoop, this));
+    return true;
+}
+
+
+void SaliencyWriter::write(const cv::Mat& map) {
+    if((m_file == NULL && !m_container) || map.empty()) return;
+
+    QueuedItem item;
+    item.map = map;
+    m_queue.push(item);
+}
+
+
+void SaliencyWriter::checkpoint(const CheckpointHandler& handler) {
+    if(m_file == NULL && !m_container) return;
+
+    QueuedItem item;
+    item.checkpoint = handler;
+    m_queue.push(item);
+}
+
+
+bool SaliencyWriter::openContainer(const std::string& filename, float frameRate, int model, int bits, const std::string& parameters) {
+    m_container.reset(new SaliencyContainerWriter());
+    if(!m_container->open(filename, frameRate, model, bits, parameters)) {
+        m_container.reset();
+        return false;
+    }
+
+    // the container owns the file
+    m_file = NULL;
+    m_failed = false;
+    m_nbFrames = 0;
+    m_thread = boost::thread(boost::bind(&SaliencyWriter::writerLoop, this));
+    return true;
+}
+
+
+bool SaliencyWriter::close() {
+    if(m_file == NULL && !m_container) return !m_failed;
+
+    m_queue.close();
+    m_thread.join();
+
+    if(m_container) {
+        if(!m_container->close()) m_failed = true;
+        m_container.reset();
+    } else {
+        fclose(m_file);
+        m_file = NULL;
+    }
+
+    if(m_failed)
+        std::cerr << "[E] SaliencyWriter: the saliency maps could not be written" << std::endl;
+
+    return !m_failed;
+}
+
+
+void SaliencyWriter::writerLoop() {
+    QueuedItem item;
+    while(m_queue.pop(item)) {
+        // keep consuming the queue after a failure: the computation must not block
+        if(m_failed) continue;
+
+        if(!item.checkpoint) {
+            if(writeMap(item.map))  ++m_nbFrames;
+            else                    m_failed = true;
+            continue;
+        }
+
+        // a checkpoint must not refer to maps which are not on the disk
+        if(!(m_container ? m_container->flush() : syncFile(m_file))) {
+            m_failed = true;
+            continue;
+        }
+
+        OutputPosition position;
+        position.nbFrames = m_nbFrames;
+        if(m_container) {
+            position.offset = static_cast<long long>(m_container->getOffset());
+            position.size   = m_container->getSize();
+            position.index  = m_container->getIndex();
+        } else {
+            position.offset = m_offset;
+        }
+
+        item.checkpoint(position);
+    }
+}
+
+
+bool SaliencyWriter::syncFile(FILE *file) {
+    if(fflush(file) != 0) return false;
+
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+
+bool SaliencyWriter::truncateFile(FILE *file, long long size) {
+    if(fflush(file) != 0) return false;
+
+#ifdef _WIN32
+    int fd = _fileno(file);
+    if(_filelengthi64(fd) < size) return false;
+    return _chsize_s(fd, size) == 0;
+#else
+    int fd = fileno(file);
+    off_t length = lseek(fd, 0, SEEK_END);
+    if(length < 0 || static_cast<long long>(length) < size) return false;
+    return ftruncate(fd, static_cast<off_t>(size)) == 0;
+#endif
+}
+
+
+size_t SaliencyWriter::sampleSize(SampleFormat format) {
+    switch(format) {
+        case SampleFloat16:
+        case SampleUInt16:  return 2;
+        case SampleUInt8:   return 1;
+        default:            return sizeof(float);
+    }
+}
+
+
+void SaliencyWriter::encodeHeader(SampleFormat format, const cv::Size& size, unsigned char *header) {
+    unsigned short version = 1;
+    unsigned short code = static_cast<unsigned short>(format);
+    unsigned int width = static_cast<unsigned int>(size.width);
+    unsigned int height = static_cast<unsigned int>(size.height);
+
+    memcpy(header, "VSAL", 4);
+    for(int i = 0 ; i < 2 ; ++i) {
+        header[4 + i] = static_cast<unsigned char>(version >> (8 * i));
+        header[6 + i] = static_cast<unsigned char>(code >> (8 * i));
+    }
+    for(int i = 0 ; i < 4 ; ++i) {
+        header[8 + i]  = static_cast<unsigned char>(width >> (8 * i));
+        header[12 + i] = static_cast<unsigned char>(height >> (8 * i));
+    }
+}
+
+
+void SaliencyWriter::encodeSamples(const cv::Mat& map, SampleFormat format, unsigned char *dst) {
+    cv::Mat samples = map.isContinuous() ? map : map.clone();
+    const float *src = samples.ptr<float>();
+    size_t nbSamples = samples.total();
+
+    switch(format) {
+        case SampleFloat32:
+            memcpy(dst, src, nbSamples * sizeof(float));
+            break;
+
+        case SampleFloat16: {
+            unsigned short *half = reinterpret_cast<unsigned short*>(dst);
+            for(size_t i = 0 ; i < nbSamples ; ++i)
+                half[i] = toHalf(src[i]);
+            break;
+        }
+
+        case SampleUInt16: {
+            unsigned short *quantized = reinterpret_cast<unsigned short*>(dst);
+            for(size_t i = 0 ; i < nbSamples ; ++i)
+                quantized[i] = static_cast<unsigned short>(std::min(1.f, std::max(0.f, src[i])) * 65535.f + .5f);
+            break;
+        }
+
+        case SampleUInt8: {
+            for(size_t i = 0 ; i < nbSamples ; ++i)
+                dst[i] = static_cast<unsigned char>(std::min(1.f, std::max(0.f, src[i])) * 255.f + .5f);
+            break;
+        }
+    }
+}
+
+
+bool SaliencyWriter::writeMap(const cv::Mat& map) {
+    TraceScope trace("write");
+
+    if(m_container) return m_container->append(map);
+
+    if(!m_headerDone) {
+        unsigned char header[HEADER_SIZE];
+        encodeHeader(m_format, map.size(), header);
+        m_headerDone = true;
+        if(fwrite(header, 1, sizeof(header), m_file) != sizeof(header)) return false;
+        m_offset += sizeof(header);
+    }
+
+    // the float maps are written as they are
+    if(m_format == SampleFloat32 && map.isContinuous()) {
+        if(fwrite(map.ptr<float>(), sizeof(float), map.total(), m_file) != map.total()) return false;
+        m_offset += static_cast<long long>(map.total() * sizeof(float));
+        return true;
+    }
+
+    m_samples.resize(map.total() * sampleSize(m_format));
+    encodeSamples(map, m_format, &m_samples[0]);
+
+    if(fwrite(&m_samples[0], 1, m_samples.size(), m_file) != m_samples.size()) return false;
+    m_offset += static_cast<long long>(m_samples.size());
+    return true;
+}
@@ -0,0 +1,141 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _SaliencyWriter_
+#define _SaliencyWriter_
+
+#include <opencv2/core.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/function.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "BoundedQueue.h"
+#include "SaliencyContainer.h"
+
+
+// Samples of the binary output. Float32 is the historical format: the maps are written one after the
+// other, without header. The compact formats start with a 16 bytes header (little endian):
+//     "VSAL"  uint16 version (1)  uint16 format  uint32 width  uint32 height
+// the quantized formats map [0, 1] to the full range of the integers.
+enum SampleFormat {
+    SampleFloat32   = 0,
+    SampleFloat16   = 1,
+    SampleUInt16    = 2,
+    SampleUInt8     = 3
+};
+
+
+// End of the maps written so far: where to append to the output after an interruption (see Checkpoint)
+struct OutputPosition {
+    int                             nbFrames;
+    long long                       offset;         // bytes of the file
+    cv::Size                        size;           // container: size of the maps
+    std::vector<SaliencyContainerIndex>
+                                    index;          // container: the index, written on close
+};
+
+
+// Writes the saliency maps to a binary file or a saliency container from a background thread. The computation only waits when
+// two maps are already waiting for the disk. The maps are queued by reference: they must not be modified
+// once given to write, so that the same map can be written several times without copy.
+
+class SaliencyWriter {
+
+public:
+    typedef boost::function<void (const OutputPosition&)> CheckpointHandler;
+
+private:
+    // a map, or a checkpoint reached once the maps queued before it are on disk
+    struct QueuedItem {
+        cv::Mat                     map;
+        CheckpointHandler           checkpoint;
+    };
+
+    FILE                           *m_file;
+    SampleFormat                    m_format;
+    bool                            m_headerDone;
+    bool                            m_failed;
+    long long                       m_offset;
+    int                             m_nbFrames;
+
+    boost::shared_ptr<SaliencyContainerWriter>
+                                    m_container;
+
+    BoundedQueue<QueuedItem>        m_queue;
+    boost::thread                   m_thread;
+    std::vector<unsigned char>      m_samples;
+
+public:
+    SaliencyWriter                  ();
+    ~SaliencyWriter                 ();
+
+    bool    open                    (const std::string& filename, SampleFormat format = SampleFloat32);
+
+    // compressed and indexed container (.vsc) instead of a raw stream
+    bool    openContainer           (const std::string& filename, float frameRate, int model, int bits, const std::string& parameters);
+
+    // appends to an output interrupted at position: what was written after it is dropped
+    bool    resume                  (const std::string& filename, SampleFormat format, const OutputPosition& position);
+    bool    resumeContainer         (const std::string& filename, const OutputPosition& position);
+
+    // CV_32F map, in [0, 1] for the quantized formats
+    void    write                   (const cv::Mat& map);
+
+    // handler is called from the writer thread with the position of the output, once the maps written
+    // before are synced to the disk. Not called after a failed write
+    void    checkpoint              (const CheckpointHandler& handler);
+
+    // waits for the queued maps to be written. False if a write failed
+    bool    close                   ();
+
+    // float32, float16, uint16 or uint8
+    static bool parseFormat         (const std::string& name, SampleFormat& format);
+
+    // size of the header of the compact formats
+    static const int HEADER_SIZE = 16;
+
+    static size_t sampleSize        (SampleFormat format);
+    static void encodeHeader        (SampleFormat format, const cv::Size& size, unsigned char *header);
+
+    // CV_32F map -> total() samples at dst
+    static void encodeSamples       (const cv::Mat& map, SampleFormat format, unsigned char *dst);
+
+    // flushed to the disk, not only to the system
+    static bool syncFile            (FILE *file);
+
+    // drops the end of the file after size. False if the file is shorter
+    static bool truncateFile        (FILE *file, long long size);
+
+private:
+    SaliencyWriter                  (const SaliencyWriter&);
+    SaliencyWriter& operator=       (const SaliencyWriter&);
+
+    void    writerLoop              ();
+    bool    writeMap                (const cv::Mat& map);
+};
+
+
+#endif
@@ -24,18 +24,9 @@
 
 
 #include "SalientFeatureFactory.h"
-
-SalientFeatureFactory* SalientFeatureFactory::m_This = NULL;
-
-
-SalientFeatureFactory *SalientFeatureFactory::get() {
-    if(m_This == NULL) {
-        m_This = new SalientFeatureFactory();
-
-    }
-
-    return m_This;
-}
+#include "SaliencyContext.h"
+#include "Trace.h"
+#include <boost/bind.hpp>
 
 SalientFeatureFactory::~SalientFeatureFactory() {
     if(m_imageFeature != NULL)              delete m_imageFeature;
@@ -44,48 +35,168 @@ SalientFeatureFactory::~SalientFeatureFactory() {
     if(m_adaptiveMotionFeature != NULL)     delete m_adaptiveMotionFeature;
     if(m_trackedObjectFeature != NULL)      delete m_trackedObjectFeature;
     if(m_pedestrianFeature != NULL)         delete m_pedestrianFeature;
+    if(m_spatioTemporalFeature != NULL)     delete m_spatioTemporalFeature;
+}
+
+void SalientFeatureFactory::reset() {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    if(m_imageFeature != NULL)              m_imageFeature->reset();
+    if(m_motionSourceFeature != NULL)       m_motionSourceFeature->reset();
+    if(m_objectMotionFeature != NULL)       m_objectMotionFeature->reset();
+    if(m_adaptiveMotionFeature != NULL)     m_adaptiveMotionFeature->reset();
+    if(m_trackedObjectFeature != NULL)      m_trackedObjectFeature->reset();
+    if(m_pedestrianFeature != NULL)         m_pedestrianFeature->reset();
+    if(m_spatioTemporalFeature != NULL)     m_spatioTemporalFeature->reset();
+}
+
+void SalientFeatureFactory::collectMemory(MemoryReport &report) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    if(m_imageFeature != NULL)              m_imageFeature->collectMemory(report, getName(ImageFeature));
+    if(m_motionSourceFeature != NULL)       m_motionSourceFeature->collectMemory(report, getName(MotionSourceFeature));
+    if(m_objectMotionFeature != NULL)       m_objectMotionFeature->collectMemory(report, getName(ObjectMotionFeature));
+    if(m_adaptiveMotionFeature != NULL)     m_adaptiveMotionFeature->collectMemory(report, getName(AdaptiveMotionFeature));
+    if(m_trackedObjectFeature != NULL)      m_trackedObjectFeature->collectMemory(report, getName(TrackedObjectFeature));
+    if(m_pedestrianFeature != NULL)         m_pedestrianFeature->collectMemory(report, getName(PedestrianFeature));
+    if(m_spatioTemporalFeature != NULL)     m_spatioTemporalFeature->collectMemory(report, getName(SpatioTemporalFeature));
+}
+
+void SalientFeatureFactory::saveState(std::map<std::string, cv::Mat> &state) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    if(m_imageFeature != NULL)              m_imageFeature->saveState(state, getName(ImageFeature));
+    if(m_motionSourceFeature != NULL)       m_motionSourceFeature->saveState(state, getName(MotionSourceFeature));
+    if(m_objectMotionFeature != NULL)       m_objectMotionFeature->saveState(state, getName(ObjectMotionFeature));
+    if(m_adaptiveMotionFeature != NULL)     m_adaptiveMotionFeature->saveState(state, getName(AdaptiveMotionFeature));
+    if(m_trackedObjectFeature != NULL)      m_trackedObjectFeature->saveState(state, getName(TrackedObjectFeature));
+    if(m_pedestrianFeature != NULL)         m_pedestrianFeature->saveState(state, getName(PedestrianFeature));
+    if(m_spatioTemporalFeature != NULL)     m_spatioTemporalFeature->saveState(state, getName(SpatioTemporalFeature));
+}
+
+void SalientFeatureFactory::restoreState(const std::map<std::string, cv::Mat> &state) {
+    for(int model = ImageFeature ; model <= SpatioTemporalFeature ; ++model) {
+        std::string prefix = std::string(getName(static_cast<FeatureMap>(model))) + ".";
+
+        // the entries of a model follow its name: the first one after the prefix
+        std::map<std::string, cv::Mat>::const_iterator it = state.lower_bound(prefix);
+        if(it == state.end() || it->first.compare(0, prefix.size(), prefix) != 0) continue;
+
+        SalientFeatureMap *featureMap = getModel(static_cast<FeatureMap>(model));
+        if(featureMap != NULL) featureMap->restoreState(state, getName(static_cast<FeatureMap>(model)));
+    }
+}
+
+void SalientFeatureFactory::setQuality(const QualityLevel &level) {
+    boost::mutex::scoped_lock lock(m_lock);
+
+    // also applied to the feature maps created later
+    m_quality = level;
+    m_hasQuality = true;
+
+    if(m_imageFeature != NULL)              m_imageFeature->setQuality(level);
+    if(m_motionSourceFeature != NULL)       m_motionSourceFeature->setQuality(level);
+    if(m_objectMotionFeature != NULL)       m_objectMotionFeature->setQuality(level);
+    if(m_adaptiveMotionFeature != NULL)     m_adaptiveMotionFeature->setQuality(level);
+    if(m_trackedObjectFeature != NULL)      m_trackedObjectFeature->setQuality(level);
+    if(m_pedestrianFeature != NULL)         m_pedestrianFeature->setQuality(level);
+    if(m_spatioTemporalFeature != NULL)     m_spatioTemporalFeature->setQuality(level);
 }
 
 SalientFeatureMap *SalientFeatureFactory::getModel(FeatureMap model) {
+    boost::mutex::scoped_lock lock(m_lock);
 
     switch(model) {
         case ImageFeature:
-            if(m_imageFeature == NULL)
+            if(m_imageFeature == NULL) {
                 m_imageFeature = new ImageFeatureMap();
+                m_imageFeature->setContext(m_context);
+                if(m_hasQuality) m_imageFeature->setQuality(m_quality);
+            }
             return m_imageFeature;
         
         case MotionSourceFeature:
-            if(m_motionSourceFeature == NULL)
+            if(m_motionSourceFeature == NULL) {
                 m_motionSourceFeature = new MotionSourceFeatureMap();
+                m_motionSourceFeature->setContext(m_context);
+                if(m_hasQuality) m_motionSourceFeature->setQuality(m_quality);
+            }
             return m_motionSourceFeature;
 
         case ObjectMotionFeature:
-            if(m_objectMotionFeature == NULL)
+            if(m_objectMotionFeature == NULL) {
                 m_objectMotionFeature = new ObjectMotionFeatureMap();
+                m_objectMotionFeature->setContext(m_context);
+                if(m_hasQuality) m_objectMotionFeature->setQuality(m_quality);
+            }
             return m_objectMotionFeature;
 
         case AdaptiveMotionFeature:
-            if(m_adaptiveMotionFeature == NULL)
+            if(m_adaptiveMotionFeature == NULL) {
                 m_adaptiveMotionFeature = new AdaptiveMotionFeatureMap();
+                m_adaptiveMotionFeature->setContext(m_context);
+                if(m_hasQuality) m_adaptiveMotionFeature->setQuality(m_quality);
+            }
             return m_adaptiveMotionFeature;
 
         case TrackedObjectFeature:
-            if(m_trackedObjectFeature == NULL)
+            if(m_trackedObjectFeature == NULL) {
                 m_trackedObjectFeature = new TrackedObjectFeatureMap();
+                m_trackedObjectFeature->setContext(m_context);
+                if(m_hasQuality) m_trackedObjectFeature->setQuality(m_quality);
+            }
             return m_trackedObjectFeature;
 
         case PedestrianFeature:
-            if(m_pedestrianFeature == NULL)
+            if(m_pedestrianFeature == NULL) {
                 m_pedestrianFeature = new PedestrianFeatureMap();
+                m_pedestrianFeature->setContext(m_context);
+                if(m_hasQuality) m_pedestrianFeature->setQuality(m_quality);
+            }
             return m_pedestrianFeature;
 
         case SpatioTemporalFeature:
-            if(m_spatioTemporalFeature == NULL)
+            if(m_spatioTemporalFeature == NULL) {
                 m_spatioTemporalFeature = new SpatioTemporalFeatureMap();
+                m_spatioTemporalFeature->setContext(m_context);
+                if(m_hasQuality) m_spatioTemporalFeature->setQuality(m_quality);
+            }
             return m_spatioTemporalFeature;
 
         default:
             return NULL;
     }
 
-}
\ No newline at end of file
+}
+
+
+const char *SalientFeatureFactory::getName(FeatureMap model) {
+    switch(model) {
+        case ImageFeature:              return "image";
+        case MotionSourceFeature:       return "motion-source";
+        case ObjectMotionFeature:       return "object-motion";
+        case AdaptiveMotionFeature:     return "adaptive-motion";
+        case PedestrianFeature:         return "pedestrian";
+        case TrackedObjectFeature:      return "tracked-object";
+        case SpatioTemporalFeature:     return "spatio-temporal";
+        default:                        return "unknown";
+    }
+}
+
+cv::Mat SalientFeatureFactory::compute(FeatureMap model, int frame, const std::string& consumer) {
+    return m_context->getFeatureGraph().get(frame, getName(model), consumer, boost::bind(&SalientFeatureFactory::computeJob, this, model, frame));
+}
+
+cv::Mat SalientFeatureFactory::computeJob(FeatureMap model, int frame) {
+    SalientFeatureMap *featureMap = getModel(model);
+    if(featureMap == NULL) return cv::Mat();
+
+    // the flow of the frame is computed once for all the motion models
+    if(featureMap->requiredFlowMode() != NoFlow)
+        m_context->getFlow(frame, getName(model));
+
+    featureMap->grabRequiredData(frame);
+
+    TraceScope trace(getName(model), frame);
+    return featureMap->compute(frame);
+}
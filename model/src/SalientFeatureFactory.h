@@ -25,6 +25,8 @@
 #ifndef _SalientFeatureFactory_
 #define _SalientFeatureFactory_
 
+#include <boost/thread/mutex.hpp>
+
 #include "SalientFeatureMap.h"
 #include "PedestrianDetectFeatureMap.h"
 #include "ObjectMotionFeatureMap.h"
@@ -37,8 +39,8 @@
 class SalientFeatureFactory {
 
 private:
-    static SalientFeatureFactory *m_This;
-
+    SaliencyContext          *m_context;
+    boost::mutex              m_lock;           // the feature maps of an engine run on several threads
 
     ImageFeatureMap          *m_imageFeature;
     MotionSourceFeatureMap   *m_motionSourceFeature;
@@ -48,6 +50,9 @@ private:
     PedestrianFeatureMap     *m_pedestrianFeature;
     SpatioTemporalFeatureMap *m_spatioTemporalFeature;
 
+    QualityLevel              m_quality;
+    bool                      m_hasQuality;
+
 
 public:
 
@@ -61,15 +66,33 @@ public:
         SpatioTemporalFeature
     } ;
 
-    static SalientFeatureFactory *get();
-
+    // the feature maps are created on demand, for the engine context
+    SalientFeatureFactory(SaliencyContext *context) : m_context(context), m_imageFeature(NULL), m_motionSourceFeature(NULL), m_objectMotionFeature(NULL), m_adaptiveMotionFeature(NULL), m_trackedObjectFeature(NULL), m_pedestrianFeature(NULL), m_spatioTemporalFeature(NULL), m_hasQuality(false) {};
 
     SalientFeatureMap *getModel(FeatureMap model);
+
+    // map of the model for frame, computed once per frame (see FeatureGraph). consumer is the name of the
+    // model requesting it, empty for the engine. The map is shared: read only
+    cv::Mat            compute(FeatureMap model, int frame, const std::string& consumer);
+    static const char *getName(FeatureMap model);
+
+    // reset the state of the instantiated feature maps before processing another video
+    void               reset();
+    void               setQuality(const QualityLevel &level);
+
+    // the buffers of the instantiated feature maps, owned by their names
+    void               collectMemory(MemoryReport &report);
+
+    // the state of the instantiated feature maps, named after them. The feature maps of a restored state are instantiated
+    void               saveState(std::map<std::string, cv::Mat> &state);
+    void               restoreState(const std::map<std::string, cv::Mat> &state);
     ~SalientFeatureFactory();
 
 
 private:
-    SalientFeatureFactory() : m_imageFeature(NULL), m_motionSourceFeature(NULL), m_objectMotionFeature(NULL), m_adaptiveMotionFeature(NULL), m_trackedObjectFeature(NULL), m_pedestrianFeature(NULL), m_spatioTemporalFeature(NULL) {};
+    SalientFeatureFactory(const SalientFeatureFactory&);
+    cv::Mat            computeJob(FeatureMap model, int frame);
+    SalientFeatureFactory& operator=(const SalientFeatureFactory&);
 
 }; 
 
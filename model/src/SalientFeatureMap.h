@@ -27,7 +27,12 @@
 #define _SaliencyFeatureMap_
 
 #include <opencv2/core.hpp>
+#include <map>
+#include <string>
+#include "FlowGrabber.h"
+#include "QualityController.h"
 
+class SaliencyContext;
 
 class SalientFeatureMap {
 
@@ -35,16 +40,33 @@ protected:
 	static bool								m_verbose;
 	static bool								m_ocl;
 
+	SaliencyContext						   *m_context;      // engine owning the feature map, set by its factory
+
 public:
-    SalientFeatureMap                       () {};
+    SalientFeatureMap                       () : m_context(NULL) {};
     virtual ~SalientFeatureMap              () {};
 
 
 
     virtual cv::Mat compute                 (int frame) = 0;
     virtual cv::Mat getColor                (int frame) = 0;
+    virtual FlowMode requiredFlowMode       ()                                                  const { return DenseFlow; }
+
+    // forget the state of the previous video. The loaded models are kept
+    virtual void    reset                   ()                                                  {}
+
+    // real-time mode: coarser settings, between two frames
+    virtual void    setQuality              (const QualityLevel &)                              {}
+
+    // the buffers kept between two frames (see MemoryAccounting)
+    virtual void    collectMemory           (MemoryReport &, const std::string &)               {}
+
+    // the state carried from a frame to the next, named after owner, to resume a run (see Checkpoint)
+    virtual void    saveState               (std::map<std::string, cv::Mat> &, const std::string &)           const {}
+    virtual void    restoreState            (const std::map<std::string, cv::Mat> &, const std::string &)     {}
 	inline void setVerbose					(bool enable)										{ m_verbose = enable; }
 	inline void setOCLMode					(bool enable)										{ m_ocl = enable;  }
+	inline void setContext					(SaliencyContext *context)							{ m_context = context; }
 
 
     // Utility
@@ -23,12 +23,12 @@
 
 
 #include "SpatioTemporalFeatureMap.h"
+#include "SaliencyContext.h"
 
 
 #include <iostream>
-#include <boost/thread.hpp>
+#include "WorkerPool.h"
 #include <boost/bind.hpp>
-#include "SalientFeatureFactory.h"
 
 SpatioTemporalFeatureMap::SpatioTemporalFeatureMap() : MotionFeatureMap(15) {
 
@@ -37,14 +37,14 @@ SpatioTemporalFeatureMap::SpatioTemporalFeatureMap() : MotionFeatureMap(15) {
 
 cv::Mat SpatioTemporalFeatureMap::compute(int frame) {
 	
-	boost::thread_group group;
+	TaskGroup group;
 
 	cv::Mat imageFeature, motionFeature;
 
-	group.create_thread(boost::bind(&SpatioTemporalFeatureMap::getMapJob, this, frame, 1, boost::ref(motionFeature)));
-	group.create_thread(boost::bind(&SpatioTemporalFeatureMap::getMapJob, this, frame, 2, boost::ref(imageFeature)));
+	group.run(boost::bind(&SpatioTemporalFeatureMap::getMapJob, this, frame, 1, boost::ref(motionFeature)));
+	group.run(boost::bind(&SpatioTemporalFeatureMap::getMapJob, this, frame, 2, boost::ref(imageFeature)));
 
-	group.join_all();
+	group.wait();
 
 	if(imageFeature.empty() && !motionFeature.empty()) return motionFeature;
 	if(!imageFeature.empty() && motionFeature.empty()) return imageFeature;
@@ -57,11 +57,13 @@ cv::Mat SpatioTemporalFeatureMap::compute(int frame) {
 }
 
 void SpatioTemporalFeatureMap::getMapJob(int frame, int feature, cv::Mat &smap) {
+	const char *name = SalientFeatureFactory::getName(SalientFeatureFactory::SpatioTemporalFeature);
+
 	if(feature == 1)
-		smap = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::AdaptiveMotionFeature)->compute(frame);
+		smap = m_context->getFactory().compute(SalientFeatureFactory::AdaptiveMotionFeature, frame, name);
 
 	if (feature == 2)
-		smap = SalientFeatureFactory::get()->getModel(SalientFeatureFactory::ImageFeature)->compute(frame);
+		smap = m_context->getFactory().compute(SalientFeatureFactory::ImageFeature, frame, name);
 }
 
 
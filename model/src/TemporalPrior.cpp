@@ -25,19 +25,17 @@
 #include "TemporalPrior.h"
 #include <cstdlib>
 
-void applyTemporalPrior(cv::Mat& image, float timeF, std::vector<float> &startP) {
-    if(image.empty()) return;
-
+void temporalPriorWeights(int cols, float timeF, const std::vector<float> &startP, std::vector<float> &weights) {
     float timeFactor = (30.0f * timeF ) / (161.0720f);
     float cutOff = 180 * (1 - exp(-timeFactor*timeFactor));
 
-    for (int i = 0; i < image.cols; ++i) {
-		
-        
+    weights.resize(cols);
+
+    for (int i = 0; i < cols; ++i) {
         float prior = 0.f;
 
         for(size_t k = 0 ; k < startP.size() ; ++k ) {
-            float lng = std::abs(startP[k] - static_cast<float>(i) / image.cols) * 360.f;
+            float lng = std::abs(startP[k] - static_cast<float>(i) / cols) * 360.f;
             lng = std::min(lng, std::abs(360.f-lng));
 
             if(std::abs(lng) > cutOff) {
@@ -48,15 +46,22 @@ void applyTemporalPrior(cv::Mat& image, float timeF, std::vector<float> &startP)
 
         }
 
-        
+        weights[i] = prior;
+    }
+}
 
-		for (int j = 0 ; j < image.rows ; ++j) {
-			image.at<float>(j, i) = prior * image.at<float>(j, i);
-		}
-	}
 
-    cv::normalize(image, image, 0.0, 1.0, cv::NORM_MINMAX);
-}
+void applyTemporalPrior(cv::Mat& image, float timeF, std::vector<float> &startP) {
+    if(image.empty()) return;
 
+    std::vector<float> weights;
+    temporalPriorWeights(image.cols, timeF, startP, weights);
 
+    for (int j = 0 ; j < image.rows ; ++j) {
+        float *row = image.ptr<float>(j);
+        for (int i = 0; i < image.cols; ++i)
+            row[i] *= weights[i];
+    }
 
+    cv::normalize(image, image, 0.0, 1.0, cv::NORM_MINMAX);
+}
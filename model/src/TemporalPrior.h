@@ -28,9 +28,13 @@
 
 
 #include <opencv2/core.hpp>
+#include <vector>
 
 void applyTemporalPrior(cv::Mat& smap, float time, std::vector<float> &startP);
 
+// weight of each column of the prior
+void temporalPriorWeights(int cols, float time, const std::vector<float> &startP, std::vector<float> &weights);
+
 
 #endif
 
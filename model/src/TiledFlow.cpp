@@ -0,0 +1,123 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "TiledFlow.h"
+#include <iostream>
+#include <algorithm>
+#include "WorkerPool.h"
+#include <boost/bind.hpp>
+
+
+TiledFlow::TiledFlow(int nbTiles, int overlap) : m_nbTiles(std::max(1, nbTiles)), m_overlap(std::max(0, overlap)) {
+
+    #ifdef GPU_MODE
+        m_compute = cv::cuda::OpticalFlowDual_TVL1::create();
+    #else
+        for(int k = 0 ; k < m_nbTiles ; ++k)
+            m_compute.push_back(cv::optflow::createOptFlow_DIS());
+    #endif
+}
+
+
+// frame extended by the overlap on both sides, wrapping across the seam
+static cv::Mat wrapExtend(const cv::Mat& frame, int overlap) {
+    if(overlap == 0) return frame;
+
+    cv::Mat extended;
+    cv::hconcat(std::vector<cv::Mat>({ frame.colRange(frame.cols - overlap, frame.cols), frame, frame.colRange(0, overlap) }), extended);
+    return extended;
+}
+
+
+void TiledFlow::tileFlowJob(int tile, const cv::Mat& from, const cv::Mat& to, cv::Mat& flow) {
+    #ifdef GPU_MODE
+        cv::cuda::GpuMat gpuFrom(from);
+        cv::cuda::GpuMat gpuTo(to);
+        cv::cuda::GpuMat gpuflow;
+        m_compute->calc(gpuFrom, gpuTo, gpuflow);
+        gpuflow.download(flow);
+    #else
+        m_compute[tile]->calc(from, to, flow);
+    #endif
+}
+
+
+void TiledFlow::calc(const cv::Mat& from, const cv::Mat& to, cv::Mat& flow) {
+    int width = from.cols;
+    int overlap = std::min(m_overlap, width / m_nbTiles / 2);
+
+    cv::Mat extFrom = wrapExtend(from, overlap);
+    cv::Mat extTo   = wrapExtend(to, overlap);
+
+    // tile k covers [x0, x1[ of the frame, [x0, x1 + 2 * overlap[ of the extended frame
+    std::vector<int> bounds(m_nbTiles + 1);
+    for(int k = 0 ; k <= m_nbTiles ; ++k)
+        bounds[k] = k * width / m_nbTiles;
+
+    std::vector<cv::Mat> tilesFrom(m_nbTiles), tilesTo(m_nbTiles), tileFlows(m_nbTiles);
+    for(int k = 0 ; k < m_nbTiles ; ++k) {
+        tilesFrom[k] = extFrom.colRange(bounds[k], bounds[k + 1] + 2 * overlap).clone();
+        tilesTo[k]   = extTo.colRange(bounds[k], bounds[k + 1] + 2 * overlap).clone();
+    }
+
+    #ifdef GPU_MODE
+        // a single device: the tiles are processed one after the other
+        for(int k = 0 ; k < m_nbTiles ; ++k)
+            tileFlowJob(k, tilesFrom[k], tilesTo[k], tileFlows[k]);
+    #else
+        TaskGroup g;
+        for(int k = 0 ; k < m_nbTiles ; ++k)
+            g.run(boost::bind(&TiledFlow::tileFlowJob, this, k, boost::ref(tilesFrom[k]), boost::ref(tilesTo[k]), boost::ref(tileFlows[k])));
+        g.wait();
+    #endif
+
+    // linear ramps over the 2 * overlap columns shared by two neighbouring tiles: the weights sum to one
+    std::vector<float> weights(2 * overlap);
+    for(int c = 0 ; c < 2 * overlap ; ++c)
+        weights[c] = (c + .5f) / (2 * overlap);
+
+    flow = cv::Mat::zeros(from.size(), CV_32FC2);
+    for(int k = 0 ; k < m_nbTiles ; ++k) {
+        const cv::Mat& tileFlow = tileFlows[k];
+        int length = tileFlow.cols;
+
+        for(int i = 0 ; i < flow.rows ; ++i) {
+            const cv::Point2f *t = tileFlow.ptr<cv::Point2f>(i);
+            cv::Point2f       *f = flow.ptr<cv::Point2f>(i);
+
+            for(int c = 0 ; c < length ; ++c) {
+                float w = 1.f;
+                if(c < 2 * overlap)
+                    w = weights[c];
+                else if(c >= length - 2 * overlap)
+                    w = weights[length - 1 - c];
+
+                int x = bounds[k] - overlap + c;
+                if(x < 0)      x += width;
+                if(x >= width) x -= width;
+
+                f[x] += w * t[c];
+            }
+        }
+    }
+}
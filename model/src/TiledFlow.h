@@ -0,0 +1,73 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _TiledFlow_
+#define _TiledFlow_
+
+#include <opencv2/core.hpp>
+#include <vector>
+
+#ifdef GPU_MODE
+    #include <opencv2/cudaoptflow.hpp>
+#else
+	#ifndef CV_OVERRIDE
+		#define CV_OVERRIDE
+	#endif
+
+    #include <opencv2/optflow.hpp>
+#endif
+
+
+// Dense flow of an equirectangular frame computed on vertical strips ("tiles" along the horizontal
+// axis) in parallel. Each tile is extended by overlap pixels on both sides, wrapping across the
+// 0/360 degree seam, and the flows of neighbouring tiles are blended linearly within the overlap.
+// The flows of consecutive frames stay sequential: this only parallelizes the flow of one pair.
+
+class TiledFlow {
+
+    int                             m_nbTiles;
+    int                             m_overlap;
+
+#ifdef GPU_MODE
+    cv::Ptr<cv::cuda::DenseOpticalFlow> m_compute;
+#else
+    std::vector< cv::Ptr<cv::DenseOpticalFlow> >
+                                    m_compute;          // one instance per tile, an instance is not reentrant
+#endif
+
+
+public:
+    TiledFlow                       (int nbTiles, int overlap);
+
+    // flow (CV_32FC2) from the gray level frame from to the gray level frame to
+    void            calc            (const cv::Mat& from, const cv::Mat& to, cv::Mat& flow);
+
+    inline int      getNbTiles      ()                                  const { return m_nbTiles; }
+    inline int      getOverlap      ()                                  const { return m_overlap; }
+
+private:
+    void            tileFlowJob     (int tile, const cv::Mat& from, const cv::Mat& to, cv::Mat& flow);
+};
+
+
+#endif
@@ -0,0 +1,198 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <vector>
+#include <boost/thread/mutex.hpp>
+
+
+namespace {
+
+    struct TraceEvent {
+        const char     *stage;
+        int             frame;
+        int             thread;
+        long long       start;
+        long long       duration;
+    };
+
+    typedef std::chrono::steady_clock TraceClock;
+
+    boost::mutex                    s_lock;
+    std::vector<TraceEvent>         s_events;
+    TraceClock::time_point          s_origin = TraceClock::now();
+    std::atomic<int>                s_nbThreads(0);
+
+    thread_local int                t_thread = -1;
+    thread_local int                t_frame = -1;
+    thread_local const char        *t_stage = NULL;
+
+    // nearest rank, on sorted durations
+    long long percentile(const std::vector<long long> &sorted, double p) {
+        size_t rank = static_cast<size_t>(p * (sorted.size() - 1) + .5);
+        return sorted[std::min(rank, sorted.size() - 1)];
+    }
+
+}
+
+
+std::atomic<bool> Trace::s_enabled(false);
+std::atomic<bool> Trace::s_stages(false);
+
+
+void Trace::enable(bool enabled) {
+    if(enabled && !s_enabled) {
+        boost::mutex::scoped_lock lock(s_lock);
+        if(s_events.empty()) s_origin = TraceClock::now();
+    }
+
+    s_enabled = enabled;
+}
+
+
+void Trace::trackStages(bool enabled) {
+    s_stages = enabled;
+}
+
+
+long long Trace::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(TraceClock::now() - s_origin).count();
+}
+
+
+int Trace::currentFrame() {
+    return t_frame;
+}
+
+
+void Trace::setCurrentFrame(int frame) {
+    t_frame = frame;
+}
+
+
+const char* Trace::currentStage() {
+    return t_stage;
+}
+
+
+void Trace::setCurrentStage(const char *stage) {
+    t_stage = stage;
+}
+
+
+void Trace::record(const char *stage, int frame, long long start, long long duration) {
+    if(t_thread < 0) t_thread = s_nbThreads++;
+
+    TraceEvent event = { stage, frame, t_thread, start, duration };
+
+    boost::mutex::scoped_lock lock(s_lock);
+    s_events.push_back(event);
+}
+
+
+void Trace::clear() {
+    boost::mutex::scoped_lock lock(s_lock);
+    s_events.clear();
+    s_origin = TraceClock::now();
+}
+
+
+bool Trace::writeChromeTrace(const std::string &filename) {
+    FILE *f = fopen(filename.c_str(), "w");
+    if(f == NULL) {
+        std::cerr << "[E] Cannot open file for write: " << filename << std::endl;
+        return false;
+    }
+
+    boost::mutex::scoped_lock lock(s_lock);
+
+    // complete events: the nesting of the scopes of a thread follows from their intervals
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for(size_t i = 0 ; i < s_events.size() ; ++i) {
+        const TraceEvent &event = s_events[i];
+        fprintf(f, "%s{\"name\":\"%s\",\"cat\":\"vbms360\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%d}}",
+                i > 0 ? ",\n" : "", event.stage, event.thread, event.start / 1000.0, event.duration / 1000.0, event.frame);
+    }
+
+    int nbThreads = s_nbThreads;
+    for(int t = 0 ; t < nbThreads ; ++t)
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}", s_events.empty() && t == 0 ? "" : ",\n", t, t);
+
+    fprintf(f, "\n]}\n");
+
+    return fclose(f) == 0;
+}
+
+
+void Trace::summarize(std::vector<TraceStats> &stats) {
+    std::map< std::string, std::vector<long long> > stages;
+    {
+        boost::mutex::scoped_lock lock(s_lock);
+        for(size_t i = 0 ; i < s_events.size() ; ++i)
+            stages[s_events[i].stage].push_back(s_events[i].duration);
+    }
+
+    stats.clear();
+    for(std::map< std::string, std::vector<long long> >::iterator it = stages.begin() ; it != stages.end() ; ++it) {
+        std::vector<long long> &durations = it->second;
+        std::sort(durations.begin(), durations.end());
+
+        long long total = 0;
+        for(size_t i = 0 ; i < durations.size() ; ++i) total += durations[i];
+
+        TraceStats stage;
+        stage.stage = it->first;
+        stage.count = durations.size();
+        stage.total = total / 1e6;
+        stage.mean  = stage.total / durations.size();
+        stage.p50   = percentile(durations, .5) / 1e6;
+        stage.p90   = percentile(durations, .9) / 1e6;
+        stage.p99   = percentile(durations, .99) / 1e6;
+        stage.max   = durations.back() / 1e6;
+        stats.push_back(stage);
+    }
+}
+
+
+void Trace::printSummary(std::ostream &out) {
+    std::vector<TraceStats> stats;
+    summarize(stats);
+    if(stats.empty()) return;
+
+    out << std::endl << std::left << std::setw(24) << "stage" << std::right << std::setw(8) << "count" << std::setw(12) << "total (s)"
+        << std::setw(11) << "mean (ms)" << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "max" << std::endl;
+
+    out << std::fixed << std::setprecision(2);
+    for(size_t i = 0 ; i < stats.size() ; ++i) {
+        const TraceStats &stage = stats[i];
+        out << std::left << std::setw(24) << stage.stage << std::right << std::setw(8) << stage.count << std::setw(12) << stage.total / 1000
+            << std::setw(11) << stage.mean << std::setw(10) << stage.p50 << std::setw(10) << stage.p90 << std::setw(10) << stage.p99 << std::setw(10) << stage.max << std::endl;
+    }
+    out << std::defaultfloat;
+}
@@ -0,0 +1,126 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _Trace_
+#define _Trace_
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+
+// Timing of the stages of the computation, always compiled. Disabled, a scope only tests a flag. Enabled,
+// each scope records its stage, frame, thread and interval. The records are exported as a Chrome trace
+// (chrome://tracing, Perfetto) and summarized per stage.
+
+// durations of a stage, in ms
+struct TraceStats {
+    std::string     stage;
+    size_t          count;
+    double          total;
+    double          mean;
+    double          p50;
+    double          p90;
+    double          p99;
+    double          max;
+};
+
+
+class Trace {
+
+    static std::atomic<bool>        s_enabled;
+    static std::atomic<bool>        s_stages;
+
+public:
+    static void     enable              (bool enabled);
+    static inline bool
+                    enabled             ()                                  { return s_enabled.load(std::memory_order_relaxed); }
+
+    // keep the current stage of each thread up to date, without recording events (memory accounting)
+    static void     trackStages         (bool enabled);
+    static inline bool
+                    tracking            ()                                  { return enabled() || s_stages.load(std::memory_order_relaxed); }
+
+    // stage: a literal, the pointer is kept. Times in ns since the trace was enabled
+    static void     record              (const char *stage, int frame, long long start, long long duration);
+    static long long
+                    now                 ();
+
+    // frame of the innermost scope of the calling thread, -1 if none
+    static int      currentFrame        ();
+    static void     setCurrentFrame     (int frame);
+
+    // stage of the innermost scope of the calling thread, NULL if none
+    static const char*
+                    currentStage        ();
+    static void     setCurrentStage     (const char *stage);
+
+    static bool     writeChromeTrace    (const std::string &filename);
+
+    // count, total, mean, median, 90th and 99th percentiles and max of each stage
+    static void     summarize           (std::vector<TraceStats> &stats);
+    static void     printSummary        (std::ostream &out);
+    static void     clear               ();
+};
+
+
+class TraceScope {
+
+    const char     *m_stage;
+    const char     *m_parentStage;
+    int             m_frame;
+    int             m_parentFrame;
+    long long       m_start;
+
+public:
+    // frame -1: the frame of the enclosing scope
+    inline TraceScope(const char *stage, int frame = -1) : m_stage(NULL) {
+        if(!Trace::tracking()) return;
+
+        m_stage         = stage;
+        m_parentStage   = Trace::currentStage();
+        m_parentFrame   = Trace::currentFrame();
+        m_frame         = frame >= 0 ? frame : m_parentFrame;
+        Trace::setCurrentStage(m_stage);
+        Trace::setCurrentFrame(m_frame);
+        m_start         = Trace::enabled() ? Trace::now() : -1;
+    }
+
+    inline ~TraceScope() {
+        if(m_stage == NULL) return;
+
+        if(m_start >= 0)
+            Trace::record(m_stage, m_frame, m_start, Trace::now() - m_start);
+        Trace::setCurrentFrame(m_parentFrame);
+        Trace::setCurrentStage(m_parentStage);
+    }
+
+private:
+    TraceScope                      (const TraceScope&);
+    TraceScope& operator=           (const TraceScope&);
+};
+
+
+#endif
@@ -41,7 +41,7 @@ cv::Mat TrackedObjectFeatureMap::compute(int frame) {
     cv::Mat img;
     for(size_t i = 0 ; i < m_optFlow.size() ; ++i) {
         if(m_optFlow[i].frameNumber == frame) {
-            img = m_optFlow[i].color;
+            img = m_optFlow[i].getColor();
         }
     }
 
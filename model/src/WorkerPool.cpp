@@ -0,0 +1,259 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "WorkerPool.h"
+#include <iostream>
+#include <algorithm>
+#include <boost/bind.hpp>
+#include <opencv2/core.hpp>
+
+WorkerPool  *WorkerPool::m_This = NULL;
+
+// index of the queue of the current thread in the pool, -1 outside of the pool
+static thread_local int t_workerIndex = -1;
+
+
+WorkerPool *WorkerPool::get() {
+    if(m_This == NULL) m_This = new WorkerPool();
+
+    return m_This;
+}
+
+
+WorkerPool::WorkerPool() : m_nbQueued(0), m_stop(false), m_nbThreads(0) {
+    start(0);
+}
+
+
+WorkerPool::~WorkerPool() {
+    stop();
+}
+
+
+void WorkerPool::setNumThreads(int nbThreads) {
+    stop();
+    start(nbThreads);
+}
+
+
+void WorkerPool::start(int nbThreads) {
+    if(nbThreads <= 0)
+        nbThreads = std::max(1u, boost::thread::hardware_concurrency());
+
+    m_nbThreads = nbThreads;
+    m_stop = false;
+    m_nbQueued = 0;
+
+    // the caller thread also works while it waits: nbThreads - 1 workers
+    int nbWorkers = nbThreads - 1;
+    m_queues.assign(nbWorkers + 1, std::deque<Task>());
+    m_queueLocks.clear();
+    for(int i = 0 ; i <= nbWorkers ; ++i)
+        m_queueLocks.push_back(boost::shared_ptr<boost::mutex>(new boost::mutex()));
+
+    for(int i = 0 ; i < nbWorkers ; ++i)
+        m_workers.push_back(boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&WorkerPool::workerLoop, this, i))));
+
+    cv::setNumThreads(nbThreads);
+}
+
+
+void WorkerPool::stop() {
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+
+    for(size_t i = 0 ; i < m_workers.size() ; ++i)
+        m_workers[i]->join();
+    m_workers.clear();
+}
+
+
+void WorkerPool::push(const Task& task) {
+    int index = t_workerIndex >= 0 ? t_workerIndex : static_cast<int>(m_queues.size()) - 1;
+
+    {
+        boost::mutex::scoped_lock lock(*m_queueLocks[index]);
+        m_queues[index].push_back(task);
+    }
+
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        ++m_nbQueued;
+    }
+    m_wakeUp.notify_one();
+}
+
+
+bool WorkerPool::pop(Task& task, TaskGroup *group) {
+    int nbQueues = static_cast<int>(m_queues.size());
+    int own = t_workerIndex >= 0 ? t_workerIndex : nbQueues - 1;
+
+    // latest task of the own queue first (the data is still in cache), then steal the oldest ones
+    for(int k = 0 ; k < nbQueues ; ++k) {
+        int index = (own + k) % nbQueues;
+        boost::mutex::scoped_lock lock(*m_queueLocks[index]);
+        std::deque<Task>& queue = m_queues[index];
+        if(queue.empty()) continue;
+
+        if(group == NULL) {
+            if(k == 0) {
+                task = queue.back();
+                queue.pop_back();
+            } else {
+                task = queue.front();
+                queue.pop_front();
+            }
+        } else {
+            int found = -1;
+            int size = static_cast<int>(queue.size());
+            for(int i = 0 ; i < size && found < 0 ; ++i) {
+                int position = k == 0 ? size - 1 - i : i;
+                if(queue[position].group == group) found = position;
+            }
+            if(found < 0) continue;
+
+            task = queue[found];
+            queue.erase(queue.begin() + found);
+        }
+
+        boost::mutex::scoped_lock countLock(m_lock);
+        --m_nbQueued;
+        return true;
+    }
+
+    return false;
+}
+
+
+bool WorkerPool::runPendingTask(TaskGroup *group) {
+    Task task;
+    if(!pop(task, group)) return false;
+
+    // the group is always notified, the exception is rethrown by its wait()
+    try {
+        task.job();
+    } catch(...) {
+        task.group->failed(std::current_exception());
+    }
+
+    task.group->finished();
+    return true;
+}
+
+
+void WorkerPool::workerLoop(int index) {
+    t_workerIndex = index;
+
+    while(true) {
+        if(runPendingTask()) continue;
+
+        boost::mutex::scoped_lock lock(m_lock);
+        while(m_nbQueued == 0 && !m_stop)
+            m_wakeUp.wait(lock);
+
+        if(m_stop) return;
+    }
+}
+
+
+
+TaskGroup::~TaskGroup() {
+    waitTasks();
+
+    if(m_exception)
+        std::cerr << "[E] TaskGroup: a task failed and the group was not waited for" << std::endl;
+}
+
+
+void TaskGroup::run(const boost::function<void ()>& job) {
+    WorkerPool *pool = WorkerPool::get();
+    if(pool->getNumThreads() <= 1) {
+        // as with the workers: the exception is rethrown by wait()
+        try {
+            job();
+        } catch(...) {
+            failed(std::current_exception());
+        }
+        return;
+    }
+
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        ++m_pending;
+    }
+
+    WorkerPool::Task task = { job, this };
+    pool->push(task);
+}
+
+
+void TaskGroup::wait() {
+    waitTasks();
+
+    std::exception_ptr exception;
+    {
+        boost::mutex::scoped_lock lock(m_lock);
+        std::swap(exception, m_exception);
+    }
+
+    if(exception)
+        std::rethrow_exception(exception);
+}
+
+
+void TaskGroup::waitTasks() {
+    WorkerPool *pool = WorkerPool::get();
+
+    while(true) {
+        {
+            boost::mutex::scoped_lock lock(m_lock);
+            if(m_pending == 0) return;
+        }
+
+        // help with the pending tasks of this group instead of blocking a thread. Not with the others:
+        // this thread may hold a lock they wait for (e.g. the grab lock of the FlowManager)
+        if(pool->runPendingTask(this)) continue;
+
+        // the remaining tasks are running on other threads
+        boost::mutex::scoped_lock lock(m_lock);
+        if(m_pending > 0)
+            m_done.timed_wait(lock, boost::posix_time::milliseconds(1));
+    }
+}
+
+
+// only the first exception is kept
+void TaskGroup::failed(std::exception_ptr exception) {
+    boost::mutex::scoped_lock lock(m_lock);
+    if(!m_exception) m_exception = exception;
+}
+
+
+void TaskGroup::finished() {
+    boost::mutex::scoped_lock lock(m_lock);
+    if(--m_pending == 0)
+        m_done.notify_all();
+}
@@ -0,0 +1,121 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _WorkerPool_
+#define _WorkerPool_
+
+#include <boost/function.hpp>
+#include <boost/thread.hpp>
+#include <boost/shared_ptr.hpp>
+#include <deque>
+#include <exception>
+#include <vector>
+
+
+class TaskGroup;
+
+
+// Process-wide pool of worker threads shared by all the parallel jobs of the model (projections of
+// the BMS, feature maps, flow tiles...). Each worker has its own queue: it runs its latest task first
+// and steals the oldest tasks of the other workers when idle. A thread waiting on a TaskGroup runs
+// the pending tasks of that group meanwhile, so tasks can create and wait for nested tasks without
+// deadlock. It does not run the tasks of other groups: the waiter may hold a lock they need.
+//
+// The size of the pool is the single knob of the parallelism: it is also given to OpenCV.
+
+class WorkerPool {
+
+    friend class TaskGroup;
+
+    struct Task {
+        boost::function<void ()>    job;
+        TaskGroup                  *group;
+    };
+
+    // one queue per worker, the last one receives the tasks of the threads outside of the pool
+    std::vector< std::deque<Task> >                     m_queues;
+    std::vector< boost::shared_ptr<boost::mutex> >      m_queueLocks;
+
+    std::vector< boost::shared_ptr<boost::thread> >     m_workers;
+    boost::mutex                    m_lock;
+    boost::condition_variable       m_wakeUp;
+    int                             m_nbQueued;
+    bool                            m_stop;
+    int                             m_nbThreads;
+
+    static WorkerPool              *m_This;
+
+
+public:
+    static WorkerPool *get();
+
+    // 0: one thread per core. With a single thread the tasks are run inline, by the caller.
+    // Must be called while no task is running (i.e. at startup)
+    void        setNumThreads       (int nbThreads);
+    inline int  getNumThreads       ()                                  const { return m_nbThreads; }
+
+    ~WorkerPool                     ();
+
+private:
+    WorkerPool                      ();
+
+    void        start               (int nbThreads);
+    void        stop                ();
+    void        workerLoop          (int index);
+
+    void        push                (const Task& task);
+    // group NULL: any task
+    bool        runPendingTask      (TaskGroup *group = NULL);
+    bool        pop                 (Task& task, TaskGroup *group);
+};
+
+
+
+// Set of tasks run on the WorkerPool and waited for together. The destructor waits for the tasks,
+// the data referenced by the tasks must outlive the group. The first exception thrown by a task is
+// rethrown by wait(), whatever the number of threads.
+
+class TaskGroup {
+
+    friend class WorkerPool;
+
+    boost::mutex                    m_lock;
+    boost::condition_variable       m_done;
+    int                             m_pending;
+    std::exception_ptr              m_exception;
+
+public:
+    TaskGroup                       () : m_pending(0) {}
+    ~TaskGroup                      ();
+
+    void        run                 (const boost::function<void ()>& job);
+    void        wait                ();
+
+private:
+    void        waitTasks           ();
+    void        failed              (std::exception_ptr exception);
+    void        finished            ();
+};
+
+
+#endif
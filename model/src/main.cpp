@@ -24,6 +24,9 @@
 
 
 #include <iostream>
+#include <fstream>
+#include <climits>
+#include <sstream>
 
 #include <opencv2/highgui.hpp>
 #include <opencv2/imgproc.hpp>
@@ -33,11 +36,21 @@
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
-#include "SalientFeatureFactory.h"
+#include "SaliencyContext.h"
 
 #include "FlowIO.h"
 #include "Saliency360.h"
 #include "FlowGrabber.h"
+#include "FlowBenchmark.h"
+#include "WorkerPool.h"
+#include "FramePipeline.h"
+#include "BatchScheduler.h"
+#include "RawStreamFlowGrabber.h"
+#include "SaliencyWriter.h"
+#include "MappedSaliencyFile.h"
+#include "Checkpoint.h"
+#include "Trace.h"
+#include "MemoryAccounting.h"
 #include <opencv2/core/ocl.hpp>
 
 
@@ -58,16 +71,403 @@ void saveSaliency(const cv::Mat &sMap, std::string filename) {
 	cv::imwrite(filename, tmp);
 }
 
-void saveBinarySaliency(const cv::Mat &sMap, FILE *file) {
+void saveBinarySaliency(const cv::Mat &sMap, SaliencyWriter *writer) {
 	if(sMap.empty()) return;
 
-	fwrite(sMap.data, sizeof(float), sMap.cols*sMap.rows, file);
+	writer->write(sMap);
+}
+
+// the maps arrive in order, from the first frame of the segment
+void saveMappedSaliency(const cv::Mat &sMap, MappedSaliencyFile *file, int *frame) {
+	if(sMap.empty()) return;
+
+	file->writeFrame((*frame)++, sMap);
+}
+
+// options of the run, stored with the maps of a container and checked when resuming. Checkpoints do not change the maps
+static std::string describeOptions(const boost::program_options::variables_map &vm) {
+	std::ostringstream options;
+
+	for(boost::program_options::variables_map::const_iterator it = vm.begin() ; it != vm.end() ; ++it) {
+		if(it->first == "checkpoint" || it->first == "resume") continue;
+
+		const boost::any &value = it->second.value();
+
+		options << it->first;
+		if(value.type() == typeid(std::string))	options << "=" << boost::any_cast<std::string>(value);
+		else if(value.type() == typeid(int))	options << "=" << boost::any_cast<int>(value);
+		else if(value.type() == typeid(float))	options << "=" << boost::any_cast<float>(value);
+		options << "\n";
+	}
+
+	return options.str();
+}
+
+// called by the writer thread once the maps before state.frame are on disk
+static void writeCheckpoint(const std::string &filename, CheckpointState state, const OutputPosition &position) {
+	state.position = position;
+	Checkpoint::write(filename, state);
+}
+
+// stage timings and memory, once all the frames are processed: they would interleave with the progress
+static void writeStats(const boost::program_options::variables_map &vm) {
+	if(vm.count("trace"))
+		Trace::writeChromeTrace(vm["trace"].as<std::string>());
+
+	if(vm.count("benchmark"))
+		Trace::printSummary(std::cout);
+
+	if(vm.count("memory-stats"))
+		MemoryAccounting::printSummary(std::cout);
+	MemoryAccounting::close();
+}
+
+// before any frame is allocated: the allocations are counted from the start
+static bool setupMemoryAccounting(const boost::program_options::variables_map &vm) {
+	if(!vm.count("memory-stats") && !vm.count("memory-log") && !vm.count("memory-dump") && !vm.count("memory-budget"))
+		return true;
+
+	MemoryAccounting::enable();
+
+	if(vm.count("memory-log") && !MemoryAccounting::setLog(vm["memory-log"].as<std::string>()))
+		return false;
+
+	if(vm.count("memory-dump"))
+		MemoryAccounting::setDumpInterval(std::max(0, vm["memory-dump"].as<int>()));
+
+	if(vm.count("memory-budget")) {
+		if(vm["memory-budget"].as<int>() <= 0) {
+			std::cerr << "[E] --memory-budget must be positive" << std::endl;
+			return false;
+		}
+		MemoryAccounting::setBudget(static_cast<size_t>(vm["memory-budget"].as<int>()) * 1048576);
+	}
+
+	return true;
 }
 
 #define SUBMISSION 1
 
 // ------------------------------------------------------------------------------------------------------------------------------------------------------
 
+// flow settings of the command line
+static void configureFlow(const boost::program_options::variables_map &vm, VideoFlowGrabber *grabber, const Saliency360 &salient) {
+	if(vm.count("flow-stride")) {
+		grabber->setFlowStride(vm["flow-stride"].as<int>());
+	}
+	if(vm.count("flow-projection") && vm["flow-projection"].as<std::string>() == "cubemap") {
+		grabber->setFlowProjection(CubemapProjection);
+	}
+	if(vm.count("flow-projection") && vm["flow-projection"].as<std::string>() == "tiles") {
+		grabber->setFlowProjection(TiledProjection);
+		grabber->setFlowTiles(vm.count("flow-tiles") ? vm["flow-tiles"].as<int>() : 4,
+							  vm.count("flow-tile-overlap") ? vm["flow-tile-overlap"].as<int>() : 32);
+	}
+	grabber->setFlowMode(salient.requiredFlowMode());
+}
+
+
+// grabber of the input video, configured from the command line, set on the FlowManager. Returns the number of frames
+static int createVideoGrabber(const boost::program_options::variables_map &vm, const std::string &video, const Saliency360 &salient) {
+	int numberOfFrames = 0;
+
+#ifdef FFMPEG_MODE
+	if(vm.count("flow-source") && vm["flow-source"].as<std::string>() == "mv") {
+		MotionVectorFlowGrabber* grabber = new MotionVectorFlowGrabber(video);
+		numberOfFrames = grabber->getFrameCount();
+		salient.getContext()->getFlowManager().setFlowGrabber(boost::shared_ptr<FlowGrabber>(grabber));
+		return numberOfFrames;
+	}
+#endif
+
+	VideoFlowGrabber* grabber = new VideoFlowGrabber(video);
+	numberOfFrames = grabber->getFrameCount();
+	configureFlow(vm, grabber, salient);
+	if(vm.count("flow-store")) {
+		grabber->enableFlowStore(vm["flow-store"].as<std::string>());
+	}
+	salient.getContext()->getFlowManager().setFlowGrabber(boost::shared_ptr<FlowGrabber>(grabber));
+
+	return numberOfFrames;
+}
+
+
+// grabber of the raw frames written by another process (--raw-input). The number of frames is unknown: INT_MAX
+static int createRawGrabber(const boost::program_options::variables_map &vm, const Saliency360 &salient) {
+	RawFormat format = RawY4M;
+	if(vm.count("raw-format") && !RawStreamFlowGrabber::parseFormat(vm["raw-format"].as<std::string>(), format)) {
+		std::cerr << "[E] Unknown raw format: " << vm["raw-format"].as<std::string>() << std::endl;
+		return -1;
+	}
+
+	cv::Size size(vm.count("raw-width") ? vm["raw-width"].as<int>() : 0, vm.count("raw-height") ? vm["raw-height"].as<int>() : 0);
+	float frameRate = vm.count("raw-fps") ? vm["raw-fps"].as<float>() : 30.f;
+
+	RawStreamFlowGrabber* grabber = new RawStreamFlowGrabber(vm["raw-input"].as<std::string>(), format, size, frameRate);
+	int numberOfFrames = grabber->getFrameCount();
+	configureFlow(vm, grabber, salient);
+	salient.getContext()->getFlowManager().setFlowGrabber(boost::shared_ptr<FlowGrabber>(grabber));
+
+	return numberOfFrames;
+}
+
+
+// compute the saliency of the input set on the FlowManager and write it to outputPath (shown in a window if empty)
+static int processVideo(const boost::program_options::variables_map &vm, Saliency360 &salient, int numberOfFrames, const std::string &outputPath, int pipelineDepth) {
+	int frame = -1;
+	int nbFrames = 1;
+	int targetW = 2048;
+	int targetH = 1024;
+
+	if (vm.count("frame")) {
+		frame = vm["frame"].as<int>();
+	}
+
+	// frames of the whole video: size of a mapped output shared by several segments
+	int videoFrames = numberOfFrames;
+
+	if(vm.count("duration")) {
+		nbFrames = vm["duration"].as<int>();
+		numberOfFrames = std::min(numberOfFrames, std::max(0, frame) + vm["duration"].as<int>());
+	}
+
+	if(vm.count("target-width")) {
+		targetW = vm["target-width"].as<int>();
+	}
+
+	if(vm.count("target-height")) {
+		targetH = vm["target-height"].as<int>();
+	}
+
+	// ---------------------------------------------------------------------------------------------------
+	// Saliency computation
+	using namespace std::chrono;
+
+	boost::function<void (const cv::Mat&)> handleOutput;
+	
+	if(!vm.count("frame") && (vm.count("input-video") || vm.count("raw-input")))
+		handleOutput = boost::bind(showSaliency, _1, 10);
+	else
+		handleOutput = boost::bind(showSaliency, _1, 0);
+
+	SaliencyWriter binWriter;
+	bool binOutput = false;
+	MappedSaliencyFile mappedOutput;
+	int outputFrame = std::max(0, frame);
+
+	// checkpoints next to the output, every checkpointInterval frames
+	std::string checkpointPath = outputPath + ".ckpt";
+	int checkpointInterval = vm.count("checkpoint") ? vm["checkpoint"].as<int>() : 0;
+	CheckpointState resumed;
+	bool resuming = false;
+
+	if((checkpointInterval > 0 || vm.count("resume")) && !outputPath.empty()) {
+		resuming = vm.count("resume") && Checkpoint::read(checkpointPath, resumed);
+		if(resuming && (resumed.settings != describeOptions(vm) || resumed.output != outputPath)) {
+			std::cerr << "[W] " << checkpointPath << " is the checkpoint of a run with other options, the video is processed from the start" << std::endl;
+			resuming = false;
+		}
+	}
+
+	if(!outputPath.empty()) {
+		int idx = outputPath.find_last_of('.');
+		
+		std::string extension = outputPath.substr(outputPath.find_last_of('.'), 4);
+		std::transform(extension.begin(), extension.end(), extension.begin(), ::toupper);
+
+		if (extension == ".BIN") {
+			SampleFormat format = SampleFloat32;
+			if(vm.count("output-format") && !SaliencyWriter::parseFormat(vm["output-format"].as<std::string>(), format)) {
+				std::cerr << "[E] Unknown output format: " << vm["output-format"].as<std::string>() << std::endl;
+				return -1;
+			}
+
+			if (vm.count("mapped-output")) {
+				if (videoFrames == INT_MAX) {
+					std::cerr << "[E] --mapped-output needs the number of frames of the video" << std::endl;
+					return -1;
+				}
+
+				cv::Size outputSize = (targetH != -1 && targetW != -1) ? cv::Size(targetW, targetH) : salient.getContext()->getFlowManager().getSourceFrameSize();
+				// the frames are written in place: the frames after the checkpoint are overwritten
+				if (!mappedOutput.open(outputPath, videoFrames, outputSize, format))
+					return -1;
+				if (resuming)
+					outputFrame = resumed.position.nbFrames;
+
+				handleOutput = boost::bind(saveMappedSaliency, _1, &mappedOutput, &outputFrame);
+			} else {
+				if (resuming ? !binWriter.resume(outputPath, format, resumed.position) : !binWriter.open(outputPath, format))
+					return -1;
+
+				binOutput = true;
+				handleOutput = boost::bind(saveBinarySaliency, _1, &binWriter);
+			}
+			salient.enableOverlay = false;
+		}
+		else if (extension == ".VSC") {
+			int bits = vm.count("output-format") && vm["output-format"].as<std::string>() == "uint8" ? 8 : 16;
+
+			if (resuming ? !binWriter.resumeContainer(outputPath, resumed.position)
+						 : !binWriter.openContainer(outputPath, salient.getContext()->getFlowManager().getFrameRate(), salient.model, bits, describeOptions(vm)))
+				return -1;
+
+			binOutput = true;
+			handleOutput = boost::bind(saveBinarySaliency, _1, &binWriter);
+			salient.enableOverlay = false;
+		}
+		else {
+			if (idx > 0)
+				salient.logOutput = outputPath.substr(0, outputPath.find_last_of('.')) + "_color.png";
+			else
+				salient.logOutput = outputPath + "_color.png";
+
+			handleOutput = boost::bind(saveSaliency, _1, outputPath);
+		}
+	}
+
+	if ((checkpointInterval > 0 || vm.count("resume")) && !binOutput && mappedOutput.size() == 0) {
+		std::cerr << "[E] --checkpoint and --resume need a .bin or .vsc output" << std::endl;
+		return -1;
+	}
+
+
+	// compute saliency
+	if (frame != -1 && nbFrames == 1) {
+		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+		std::cout << "[" << frame << "]";
+
+		if (numberOfFrames < frame) {
+			std::cout << "[W] Frame requested beyond the end of video. Quit" << std::endl;
+			return 0;
+		}
+
+		cv::Mat sMap = salient.compute(frame);
+
+		high_resolution_clock::time_point t2 = high_resolution_clock::now();
+		duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
+		std::cout << " in " << time_span.count() << " sec. " << std::endl;
+
+		if(sMap.empty()) return 0;
+
+		if(targetH != -1 && targetW != -1)
+			cv::resize(sMap, sMap, cv::Size(targetW, targetH));
+		else
+			cv::resize(sMap, sMap, salient.getContext()->getFlowManager().getSourceFrameSize());
+		handleOutput(sMap);
+
+	} else {
+		if (numberOfFrames <= 0) return 0;
+
+		int frIdx = 0;
+		if(frame != -1) frIdx = frame;
+
+		// the flows of the window are computed again after seeking to the frame, or read from the flow store
+		if(resuming) {
+			std::cout << "[I] Resuming at frame " << resumed.frame << " from " << checkpointPath << std::endl;
+			frIdx = resumed.frame;
+			salient.getContext()->restoreState(resumed.maps);
+		}
+
+		int startFrame = frIdx;
+		salient.getContext()->keepStates(checkpointInterval > 0);
+
+		cv::Mat lastMap, previousMap;
+		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+
+		// the maps arrive in order. With the pipeline, the time is the interval between two outputs
+		auto writeMap = [&](int frameIndex, const cv::Mat& sMap) {
+			high_resolution_clock::time_point t2 = high_resolution_clock::now();
+			duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
+			std::cout << "[" << frameIndex << "/" << numberOfFrames << "] in " << time_span.count() << " sec. " << std::endl;
+			t1 = t2;
+
+			handleOutput(sMap);
+			previousMap = lastMap;
+			lastMap = sMap;
+
+			CheckpointState state;
+			if(checkpointInterval <= 0 || !salient.getContext()->takeState(frameIndex, state.maps)) return;
+			if((frameIndex + 1 - startFrame) % checkpointInterval != 0) return;
+
+			state.settings	= describeOptions(vm);
+			state.output	= outputPath;
+			state.frame		= frameIndex + 1;
+
+			if(binOutput) {
+				binWriter.checkpoint(boost::bind(writeCheckpoint, checkpointPath, state, _1));
+			} else if(mappedOutput.flush()) {
+				state.position.nbFrames = outputFrame;
+				state.position.offset	= 0;
+				Checkpoint::write(checkpointPath, state);
+			}
+		};
+
+		// a mapped output holds exactly the frames [frame, frame + duration) of the segment: the segments
+		// of the other processes start right after
+		int lastFrame = mappedOutput.size() > 0 ? numberOfFrames - 1 : numberOfFrames;
+
+		FramePipeline pipeline(salient, (targetH != -1 && targetW != -1) ? cv::Size(targetW, targetH) : cv::Size(), pipelineDepth);
+		frIdx = pipeline.run(frIdx, lastFrame, writeMap);
+
+		// the length of a stream is only known at its end
+		if(numberOfFrames == INT_MAX) {
+			VideoFlowGrabber *stream = dynamic_cast<VideoFlowGrabber*>(salient.getContext()->getFlowManager().getFlowGrabber().get());
+			if(stream) numberOfFrames = stream->getFrameCount();
+		}
+
+		// Perform padding to have the same number of output frames as frames in the video file
+		if(mappedOutput.size() > 0) {
+			cv::Mat lastValid = lastMap.empty() ? previousMap : lastMap;
+			while(outputFrame < numberOfFrames && !lastValid.empty())
+				handleOutput(lastValid);
+		} else {
+			for( ; frIdx < numberOfFrames ; ++frIdx) {
+				handleOutput(previousMap);
+			}
+		}
+
+
+	}
+
+	std::cout<<std::endl;
+
+	if (binOutput && !binWriter.close()) {
+		return -1;
+	}
+
+	if (mappedOutput.size() > 0 && !mappedOutput.flush()) {
+		std::cerr << "[E] Cannot write the saliency maps to " << outputPath << std::endl;
+		return -1;
+	}
+
+	// the output is complete
+	if (checkpointInterval > 0 || resuming) {
+		salient.getContext()->keepStates(false);
+		Checkpoint::remove(checkpointPath);
+	}
+
+
+	return 0;
+}
+
+
+// one video of a batch, on the engine of the slot. The loaded models are kept, only the state of the previous video is dropped
+static bool processBatchJob(const boost::program_options::variables_map &vm, std::vector< boost::shared_ptr<Saliency360> > &engines, int pipelineDepth, const BatchJob &job, int slot) {
+	Saliency360 &salient = *engines[slot];
+	salient.getContext()->reset();
+
+	// set by processVideo from the output format
+	salient.enableOverlay = true;
+	salient.logOutput.clear();
+
+	int numberOfFrames = createVideoGrabber(vm, job.input, salient);
+	if(numberOfFrames <= 0) return false;
+
+	return processVideo(vm, salient, numberOfFrames, job.output, pipelineDepth) == 0;
+}
+
 
 int main(int argc, char **argv) {
 
@@ -85,7 +485,16 @@ int main(int argc, char **argv) {
 	desc.add_options()
 			("help", "produce help message")
 			("input-video,i", po::value< std::string >(), "Video file to process.")
-			("output-file,o", po::value< std::string >(), "Output image/video. Write images if only a frame is requested, write a video otherwise. Output format guessed from file extension. .bin -> binary file. .jpg -> an image. If not set, show in a window.")
+			("raw-input", po::value< std::string >(), "Read decoded frames from a pipe instead of a video file: - for stdin, or the path of a named pipe.")
+			("raw-format", po::value< std::string >(), "Format of the raw frames: [bgr24] packed BGR, [yuv420p] planar I420, [y4m] YUV4MPEG2 stream. Default [y4m]")
+			("raw-width", po::value< int >(), "Width of the raw frames (bgr24, yuv420p).")
+			("raw-height", po::value< int >(), "Height of the raw frames (bgr24, yuv420p).")
+			("raw-fps", po::value< float >(), "Frame rate of the raw frames (bgr24, yuv420p). Default [30]")
+			("output-file,o", po::value< std::string >(), "Output image/video. Write images if only a frame is requested, write a video otherwise. Output format guessed from file extension. .bin -> binary file. .vsc -> compressed container with a frame index. .jpg -> an image. If not set, show in a window.")
+			("mapped-output", "Preallocate the .bin output for the whole video and write each map at the position of its frame. Several processes can compute segments of a video (--frame, --duration) into the same file.")
+			("output-format", po::value< std::string >(), "Samples of the .bin output: float32 (default, no header), float16, uint16 or uint8 (16 bytes header). A .vsc output is quantized on 8 bits with uint8, 16 otherwise.")
+			("batch", po::value< std::string >(), "Process the videos of a manifest, one \"input output\" pair per line, in a single process. The other options apply to every video.")
+			("batch-jobs", po::value< int >(), "Number of videos of the batch processed concurrently, sharing the threads. Default [1]")
 			("frame,f",  po::value< int >(), "Process a specific frame. If not set, process all the video.")
 			("duration,d",  po::value< int >(), "Process a specific number of frames. If not set, process all the video.")
 	
@@ -95,7 +504,6 @@ int main(int argc, char **argv) {
 			("equatorial-prior", "Add the equatorial prior to the predictions")
 			("overlay", po::value< std::string >(), "RGB image to overlay on the saliency map.")
 			("gpu", po::value< int >(), "Choose the GPU which will be used by the application.")
-			("benchmark", "Show stats on processing time.")
 			
 			("verbose", "Enable verbose mode to show details on the processing...")
 			
@@ -107,6 +515,27 @@ int main(int argc, char **argv) {
 			("target-height", po::value< int >(), "Choose the height of the output saliency map. -1 for same as source. Default [1024]")
 			//("ocl", "Prefer using OpenCL code when available.") // That code performs really slow, you should not use it CPU version of BMS360 is faster... 
 #endif // !SUBMISSION
+			("benchmark", "Show stats on processing time: duration percentiles of each stage, at the end.")
+			("trace", po::value< std::string >(), "Write the timing of each stage, frame and thread to a Chrome trace (.json, for chrome://tracing or Perfetto).")
+			("pipeline-depth", po::value< int >(), "Number of frames queued between the stages (decoding/flow, feature maps, priors, output) running in parallel. 0 to run the stages one after the other. Default [2]")
+			("realtime", po::value< float >(), "Real-time mode: time budget per frame in ms. The resolution of the feature maps and of the flow, and the flow stride, are adapted on the fly to keep up with it.")
+			("feature-graph", po::value< std::string >(), "Write the graph of the feature maps computed for each frame, with their average computation time, to a Graphviz (.dot) file.")
+			("threads", po::value< int >(), "Number of threads used by the model, OpenCV included. 0 for one thread per core. Default [0]")
+			("checkpoint", po::value< int >(), "Every N frames, save what is needed to resume the run after an interruption to <output>.ckpt (.bin and .vsc outputs). The file is removed once the video is complete.")
+			("resume", "Resume the run from <output>.ckpt if it exists: the output is truncated to the checkpoint and completed. The other options must be those of the interrupted run.")
+			("memory-stats", "Show the memory at the end: cv::Mat allocations and peak bytes of each stage, peak bytes of each buffer owner (cache of frames, windows of the feature maps, classifier), peak resident memory.")
+			("memory-log", po::value< std::string >(), "Write the memory held by each owner and allocated by each stage, after each frame, to a CSV file (frame,kind,name,count,bytes).")
+			("memory-dump", po::value< int >(), "Print the memory breakdown every N frames.")
+			("memory-budget", po::value< int >(), "Memory budget of the process in MB: a warning with the memory breakdown is printed when the resident memory exceeds it.")
+			("flow-store", po::value< std::string >(), "Directory of the on-disk optical flow store. Flows are read from the store when available and written to it otherwise.")
+			("flow-stride", po::value< int >(), "Compute the optical flow every N frames, the flows of the frames in-between are interpolated. Default [1]")
+			("flow-projection", po::value< std::string >(), "Geometry of the dense optical flow: [equirect] on the frame, [cubemap] on the six faces of a cubemap, [tiles] on vertical strips of the frame, computed in parallel. Default [equirect]")
+			("flow-tiles", po::value< int >(), "Number of strips of the [tiles] flow projection. Default [4]")
+			("flow-tile-overlap", po::value< int >(), "Overlap in pixels between the strips of the [tiles] flow projection, blended linearly. Default [32]")
+#ifdef FFMPEG_MODE
+			("flow-source", po::value< std::string >(), "Source of the motion when processing a video: [dense] optical flow, [mv] motion vectors of the bitstream (faster, less accurate). Default [dense]")
+			("flow-benchmark", "Compare the motion vector flow against the dense optical flow on the input video (using --frame and --duration) and exit.")
+#endif
 	;
 
 	po::variables_map vm;
@@ -138,52 +567,25 @@ int main(int argc, char **argv) {
 
 
 
-	std::vector<std::string> inputPath;
-	std::string outputPath;
-	int frame = -1;
-	int nbFrames = 1;
-	int targetW = 2048;
-	int targetH = 1024;
-
-	Saliency360 salient;
-	int numberOfFrames = 0;
-
-	if(vm.count("input-video")) {
-		VideoFlowGrabber* grabber = new VideoFlowGrabber(vm["input-video"].as<std::string>());
-		numberOfFrames = grabber->getFrameCount();
-		FlowManager::get()->setFlowGrabber(boost::shared_ptr<FlowGrabber>(grabber));
+	if (!setupMemoryAccounting(vm)) {
+		return -1;
 	}
 
-	
-	if (vm.count("input-flow")) {
-		std::string overlayPath;
-
-		if(vm.count("overlay")) {
-			overlayPath = vm["overlay"].as<std::string>();
-		}
-
-		FlowManager::get()->setFlowGrabber(boost::shared_ptr<FlowGrabber>(new FileFlowGrabber(vm["input-flow"].as<std::vector<std::string>>(), overlayPath)));
-
+	if (vm.count("threads")) {
+		WorkerPool::get()->setNumThreads(vm["threads"].as<int>());
 	} else {
-		if(!vm.count("input-video")) {
-			std::cerr << "It is required to provide input data. See --help\n";
-			return 0;	
-		}
+		WorkerPool::get()->setNumThreads(0);
 	}
 
-
-	if (vm.count("output-file")) {
-		outputPath = vm["output-file"].as< std::string >();
-	} 
-
-	if (vm.count("frame")) {
-		frame = vm["frame"].as<int>();
+	int pipelineDepth = 2;
+	if (vm.count("pipeline-depth")) {
+		pipelineDepth = vm["pipeline-depth"].as<int>();
 	}
 
-	if(vm.count("duration")) {
-		nbFrames = vm["duration"].as<int>();
-		numberOfFrames = std::min(numberOfFrames, std::max(0, frame) + vm["duration"].as<int>());
-	}
+	std::string outputPath;
+
+	Saliency360 salient;
+	int numberOfFrames = 0;
 
 	if (vm.count("model")) {
 
@@ -205,20 +607,24 @@ int main(int argc, char **argv) {
 	}
 
 
-	if(vm.count("target-width")) {
-		targetW = vm["target-width"].as<int>();
-	}
-
-	if(vm.count("target-height")) {
-		targetH = vm["target-height"].as<int>();
+#ifdef FFMPEG_MODE
+	if(vm.count("flow-benchmark")) {
+		if(!vm.count("input-video")) {
+			std::cerr << "[E] --flow-benchmark requires --input-video" << std::endl;
+			return -1;
+		}
+		return runFlowBenchmark(vm["input-video"].as<std::string>(),
+								vm.count("frame") ? vm["frame"].as<int>() : 1,
+								vm.count("duration") ? vm["duration"].as<int>() : 100);
 	}
+#endif
 
 	if (vm.count("ocl")) {
 		salient.ocl = true;
 	}
 
 	if (vm.count("verbose")) {
-		SalientFeatureFactory::get()->getModel(SalientFeatureFactory::AdaptiveMotionFeature)->setVerbose(true);
+		salient.getContext()->getFactory().getModel(SalientFeatureFactory::AdaptiveMotionFeature)->setVerbose(true);
 	}
 
 	if(vm.count("gpu")) {
@@ -244,150 +650,85 @@ int main(int argc, char **argv) {
 		}
 	}
 
-	if (vm.count("benchmark")) {
-		salient.benchmark = true;
+	if (vm.count("benchmark") || vm.count("trace")) {
+		Trace::enable(true);
 	}
 
 	if (vm.count("equatorial-prior")) {
 		salient.equatorialPrior = true;
 	}
 
+	if (vm.count("realtime")) {
+		salient.frameBudget = vm["realtime"].as<float>();
+	}
+
 	if (vm.count("temporal-prior")) {
 		salient.temporalPrior = vm["temporal-prior"].as<int>();
 	} else {
 		salient.temporalPrior = 2;
 	}
 
-	// ---------------------------------------------------------------------------------------------------
-	// Saliency computation
-	using namespace std::chrono;
-
-	boost::function<void (const cv::Mat&)> handleOutput;
-	
-	if(!vm.count("frame") && vm.count("input-video"))
-		handleOutput = boost::bind(showSaliency, _1, 10);
-	else
-		handleOutput = boost::bind(showSaliency, _1, 0);
+	if (vm.count("batch")) {
+		std::vector<BatchJob> jobs;
+		if(!readBatchManifest(vm["batch"].as<std::string>(), jobs)) return -1;
 
-	FILE *fileBinOut = NULL;
-
-	if(!outputPath.empty()) {
-		int idx = outputPath.find_last_of('.');
-		
-		std::string extension = outputPath.substr(outputPath.find_last_of('.'), 4);
-		std::transform(extension.begin(), extension.end(), extension.begin(), ::toupper);
-
-		if (extension == ".BIN") {
-			fileBinOut = fopen(outputPath.c_str(), "wb");
-			if (fileBinOut == NULL) {
-				std::cerr << "[E] Cannot open file for write: " << outputPath << std::endl;
-				return -1;
-			}
-
-			handleOutput = boost::bind(saveBinarySaliency, _1, fileBinOut);
-			salient.enableOverlay = false;
+		// one engine per slot, with the settings of the command line
+		int nbSlots = vm.count("batch-jobs") ? std::max(1, vm["batch-jobs"].as<int>()) : 1;
+		std::vector< boost::shared_ptr<Saliency360> > engines;
+		for(int i = 0 ; i < nbSlots ; ++i) {
+			engines.push_back(boost::shared_ptr<Saliency360>(new Saliency360(salient)));
 		}
-		else {
-			if (idx > 0)
-				salient.logOutput = outputPath.substr(0, outputPath.find_last_of('.')) + "_color.png";
-			else
-				salient.logOutput = outputPath + "_color.png";
 
-			handleOutput = boost::bind(saveSaliency, _1, outputPath);
-		}
+		BatchScheduler scheduler(jobs, nbSlots);
+		int nbFailed = scheduler.run(boost::bind(processBatchJob, boost::cref(vm), boost::ref(engines), pipelineDepth, _1, _2));
+
+		std::cout << "[I] Batch: " << jobs.size() - nbFailed << "/" << jobs.size() << " videos processed" << std::endl;
+		writeStats(vm);
+		return nbFailed == 0 ? 0 : -1;
 	}
 
+	if(vm.count("input-video")) {
+		numberOfFrames = createVideoGrabber(vm, vm["input-video"].as<std::string>(), salient);
+	}
 
-	// compute saliency
-	if (frame != -1 && nbFrames == 1) {
-		high_resolution_clock::time_point t1 = high_resolution_clock::now();
+	if(vm.count("raw-input")) {
+		numberOfFrames = createRawGrabber(vm, salient);
+		if(numberOfFrames < 0) return -1;
+	}
 
-		std::cout << "[" << frame << "]";
+	if (vm.count("input-flow")) {
+		std::string overlayPath;
 
-		if (numberOfFrames < frame) {
-			std::cout << "[W] Frame requested beyond the end of video. Quit" << std::endl;
-			return 0;
+		if(vm.count("overlay")) {
+			overlayPath = vm["overlay"].as<std::string>();
 		}
 
-		cv::Mat sMap = salient.compute(frame);
-
-		high_resolution_clock::time_point t2 = high_resolution_clock::now();
-		duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
-		std::cout << " in " << time_span.count() << " sec. " << std::endl;
-
-		if(sMap.empty()) return 0;
-
-		if(targetH != -1 && targetW != -1)
-			cv::resize(sMap, sMap, cv::Size(targetW, targetH));
-		else
-			cv::resize(sMap, sMap, FlowManager::get()->getSourceFrameSize());
-		handleOutput(sMap);
+		salient.getContext()->getFlowManager().setFlowGrabber(boost::shared_ptr<FlowGrabber>(new FileFlowGrabber(vm["input-flow"].as<std::vector<std::string>>(), overlayPath)));
 
 	} else {
-		if (numberOfFrames <= 0) return 0;
-
-		int frIdx = 0;
-		if(frame != -1) frIdx = frame;
-
-		std::cout << "[" << frIdx << "/" << numberOfFrames <<  "]";
-
-		high_resolution_clock::time_point t1 = high_resolution_clock::now();
-
-		cv::Mat sMap = salient.compute(frIdx);
-		
-		if (!sMap.empty()) {
-			if (targetH != -1 && targetW != -1)
-				cv::resize(sMap, sMap, cv::Size(targetW, targetH));
-			else
-				cv::resize(sMap, sMap, FlowManager::get()->getSourceFrameSize());
-		}
-		
-		high_resolution_clock::time_point t2 = high_resolution_clock::now();
-		duration<double> time_span = duration_cast<duration<double>>(t2 - t1);
-		std::cout << " in " << time_span.count() << " sec. " << std::endl;
-
-		handleOutput(sMap);
-
-		cv::Mat lastMap;
-		while (frIdx < numberOfFrames && !sMap.empty()) {
-			++frIdx;
-			std::cout << "[" << frIdx << "/" << numberOfFrames << "]" << std::flush;
-
-			t1 = high_resolution_clock::now();
-
-			lastMap = sMap.clone();
-
-			sMap = salient.compute(frIdx);
-
-			if (!sMap.empty()) {
-				if (targetH != -1 && targetW != -1)
-					cv::resize(sMap, sMap, cv::Size(targetW, targetH));
-				else
-					cv::resize(sMap, sMap, FlowManager::get()->getSourceFrameSize());
-			}
-
-			t2 = high_resolution_clock::now();
-			time_span = duration_cast<duration<double>>(t2 - t1);
-			std::cout << " in " << time_span.count() << " sec. " << std::endl;
-
-			handleOutput(sMap);
-		}
-
-		// Perform padding to have the same number of output frames as frames in the video file
-		for( ; frIdx < numberOfFrames ; ++frIdx) {
-			handleOutput(lastMap);
+		if(!vm.count("input-video") && !vm.count("raw-input")) {
+			std::cerr << "It is required to provide input data. See --help\n";
+			return 0;	
 		}
+	}
 
 
-	}
+	if (vm.count("output-file")) {
+		outputPath = vm["output-file"].as< std::string >();
+	} 
 
-	std::cout<<std::endl;
+	int res = processVideo(vm, salient, numberOfFrames, outputPath, pipelineDepth);
 
-	if (fileBinOut != NULL) {
-		fclose(fileBinOut);
+	if(vm.count("feature-graph")) {
+		std::ofstream graphFile(vm["feature-graph"].as<std::string>().c_str());
+		if(graphFile.is_open())
+			salient.getContext()->getFeatureGraph().writeDot(graphFile);
+		else
+			std::cerr << "[E] Cannot open file for write: " << vm["feature-graph"].as<std::string>() << std::endl;
 	}
 
+	writeStats(vm);
 
-	return 0;
+	return res;
 }
 
@@ -0,0 +1,185 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#include "vbms360.h"
+#include <iostream>
+#include <exception>
+#include <new>
+
+#include "SaliencyStream.h"
+#include "WorkerPool.h"
+
+
+struct vbms360_engine {
+    SaliencyStream      *stream;
+    cv::Size             frameSize;
+};
+
+
+// the exceptions of OpenCV and boost must not cross the C interface
+#define VBMS360_GUARD(call, name)                                                                   \
+    try {                                                                                           \
+        call;                                                                                       \
+    } catch(const std::exception& e) {                                                              \
+        std::cerr << "[E] " << name << ": " << e.what() << std::endl;                               \
+        return VBMS360_ERROR;                                                                       \
+    }
+
+
+void vbms360_default_config(vbms360_config *config, int width, int height, float frame_rate) {
+    if(config == NULL) return;
+
+    config->width               = width;
+    config->height              = height;
+    config->frame_rate          = frame_rate;
+    config->model               = 0;
+    config->output_width        = 2048;
+    config->output_height       = 1024;
+    config->flow_stride         = 1;
+    config->equatorial_prior    = 0;
+    config->temporal_prior      = 2;
+    config->frame_budget_ms     = 0;
+}
+
+
+vbms360_engine *vbms360_create(const vbms360_config *config) {
+    if(config == NULL || config->width <= 0 || config->height <= 0 || config->frame_rate <= 0) {
+        std::cerr << "[E] vbms360_create: invalid frame size or frame rate" << std::endl;
+        return NULL;
+    }
+
+    // same numbering as --model of the salient tool
+    if(config->model != 0 && config->model != 1) {
+        std::cerr << "[E] vbms360_create: invalid model " << config->model << ", 0 or 1" << std::endl;
+        return NULL;
+    }
+
+    Saliency360 settings;
+    settings.model              = config->model == 1 ? 6 : 3;
+    settings.equatorialPrior    = config->equatorial_prior != 0;
+    settings.temporalPrior      = std::max(0, config->temporal_prior);
+    settings.frameBudget        = std::max(0.f, config->frame_budget_ms);
+
+    cv::Size frameSize(config->width, config->height);
+    cv::Size outputSize(std::max(0, config->output_width), std::max(0, config->output_height));
+
+    // the engine is only allocated once the stream is built: nothing leaks if the stream throws
+    SaliencyStream *stream = NULL;
+    try {
+        stream = new SaliencyStream(settings, frameSize, config->frame_rate, outputSize, config->flow_stride);
+    } catch(const std::exception& e) {
+        std::cerr << "[E] vbms360_create: " << e.what() << std::endl;
+        return NULL;
+    }
+
+    vbms360_engine *engine = new (std::nothrow) vbms360_engine;
+    if(engine == NULL) {
+        delete stream;
+        return NULL;
+    }
+
+    engine->frameSize = frameSize;
+    engine->stream = stream;
+    return engine;
+}
+
+
+void vbms360_destroy(vbms360_engine *engine) {
+    if(engine == NULL) return;
+
+    delete engine->stream;
+    delete engine;
+}
+
+
+int vbms360_push_frame(vbms360_engine *engine, vbms360_format format, const unsigned char *const planes[3], const int strides[3]) {
+    if(engine == NULL || planes == NULL || strides == NULL || planes[0] == NULL) return VBMS360_ERROR;
+
+    // headers on the buffers of the caller: nothing is copied before the resizing
+    const cv::Size& size = engine->frameSize;
+    bool res = false;
+
+    switch(format) {
+        case VBMS360_FORMAT_BGR24: {
+            cv::Mat bgr(size, CV_8UC3, const_cast<unsigned char*>(planes[0]), strides[0]);
+            VBMS360_GUARD(res = engine->stream->push(bgr), "vbms360_push_frame")
+            break;
+        }
+
+        case VBMS360_FORMAT_I420: {
+            if(planes[1] == NULL || planes[2] == NULL) return VBMS360_ERROR;
+
+            cv::Size chromaSize((size.width + 1) / 2, (size.height + 1) / 2);
+            cv::Mat y(size, CV_8UC1, const_cast<unsigned char*>(planes[0]), strides[0]);
+            cv::Mat u(chromaSize, CV_8UC1, const_cast<unsigned char*>(planes[1]), strides[1]);
+            cv::Mat v(chromaSize, CV_8UC1, const_cast<unsigned char*>(planes[2]), strides[2]);
+            VBMS360_GUARD(res = engine->stream->pushI420(y, u, v), "vbms360_push_frame")
+            break;
+        }
+
+        default:
+            std::cerr << "[E] vbms360_push_frame: unknown format " << format << std::endl;
+            return VBMS360_ERROR;
+    }
+
+    return res ? VBMS360_OK : VBMS360_ERROR;
+}
+
+
+int vbms360_flush(vbms360_engine *engine) {
+    if(engine == NULL) return VBMS360_ERROR;
+
+    VBMS360_GUARD(engine->stream->flush(), "vbms360_flush")
+    return VBMS360_OK;
+}
+
+
+int vbms360_pull_map(vbms360_engine *engine, float *map, int stride) {
+    if(engine == NULL || map == NULL) return VBMS360_ERROR;
+
+    cv::Size size = engine->stream->getOutputSize();
+    if(stride < size.width * static_cast<int>(sizeof(float))) {
+        std::cerr << "[E] vbms360_pull_map: the stride is smaller than a row of the map" << std::endl;
+        return VBMS360_ERROR;
+    }
+
+    // the map is written in place in the buffer of the caller
+    cv::Mat output(size, CV_32F, map, stride);
+    bool res = false;
+    VBMS360_GUARD(res = engine->stream->pull(output), "vbms360_pull_map")
+
+    return res ? 1 : 0;
+}
+
+
+int vbms360_available(const vbms360_engine *engine) {
+    if(engine == NULL) return 0;
+
+    return static_cast<int>(engine->stream->available());
+}
+
+
+int vbms360_set_num_threads(int nbThreads) {
+    VBMS360_GUARD(WorkerPool::get()->setNumThreads(nbThreads), "vbms360_set_num_threads")
+    return VBMS360_OK;
+}
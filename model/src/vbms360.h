@@ -0,0 +1,95 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _vbms360_h_
+#define _vbms360_h_
+
+// libvbms360: saliency of 360 videos decoded by the caller.
+//
+// The caller pushes the decoded frames in order and pulls one saliency map per frame, in order. The maps
+// come out with a delay of a few frames (the temporal window of the model); after vbms360_flush at the end
+// of the stream, the maps of all the pushed frames can be pulled. The pixels of a pushed frame are only
+// read during the call. An engine must be used from a single thread, distinct engines run concurrently.
+// As for the command line tool, the trained models are loaded from ./data.
+//
+// Build the library with "make lib" (bin/libvbms360Static.a).
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct vbms360_engine vbms360_engine;
+
+typedef enum vbms360_format {
+    VBMS360_FORMAT_BGR24    = 0,        // a single plane of packed 8 bits BGR
+    VBMS360_FORMAT_I420     = 1         // three 8 bits planes Y, U, V. The chroma planes are subsampled by 2
+} vbms360_format;
+
+typedef struct vbms360_config {
+    int     width;                      // size of the pushed frames (equirectangular)
+    int     height;
+    float   frame_rate;                 // used by the temporal prior
+
+    int     model;                      // model of the salient tool (--model): 0 image only, 1 image and motion (needs ./data/fdeep_model.json). Default 0
+    int     output_width;               // size of the maps. 0 for the size of the frames. Default 2048x1024
+    int     output_height;
+    int     flow_stride;                // compute the flow every flow_stride frames (--flow-stride). Default 1
+    int     equatorial_prior;           // 0 or 1. Default 0
+    int     temporal_prior;             // number of starting points of the temporal prior, 0 to disable. Default 2
+    float   frame_budget_ms;            // real-time mode: the quality is adapted to process a frame in this time. Default 0 (off)
+} vbms360_config;
+
+// return codes
+#define VBMS360_OK           0
+#define VBMS360_ERROR       -1          // invalid argument or processing error, details on stderr
+
+
+// defaults of the command line tool, for frames of width x height at frame_rate
+void            vbms360_default_config      (vbms360_config *config, int width, int height, float frame_rate);
+
+// NULL on error
+vbms360_engine *vbms360_create              (const vbms360_config *config);
+void            vbms360_destroy             (vbms360_engine *engine);
+
+// planes[i] points to the first row of plane i, strides[i] is its row stride in bytes (only the first
+// plane is used for BGR24). The maps of previous frames may become available.
+int             vbms360_push_frame          (vbms360_engine *engine, vbms360_format format, const unsigned char *const planes[3], const int strides[3]);
+
+// end of the stream, no frame can be pushed after
+int             vbms360_flush               (vbms360_engine *engine);
+
+// writes the next map in map, output_height rows of output_width floats, stride in bytes between rows.
+// Returns 1 when a map was written, 0 when no map is available yet, VBMS360_ERROR on error
+int             vbms360_pull_map            (vbms360_engine *engine, float *map, int stride);
+
+// number of maps which can be pulled
+int             vbms360_available           (const vbms360_engine *engine);
+
+// size of the worker pool shared by all the engines. 0 for the number of cores
+int             vbms360_set_num_threads     (int nbThreads);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
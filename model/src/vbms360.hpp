@@ -0,0 +1,88 @@
+// **************************************************************************************************
+//
+// The MIT License (MIT)
+//
+// Copyright (c) 2017 Pierre Lebreton
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+// associated documentation files (the "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is furnished to do so, subject to the
+// following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all copies or substantial
+// portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT
+// LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+// WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+// SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+//
+// **************************************************************************************************
+
+#ifndef _vbms360_hpp_
+#define _vbms360_hpp_
+
+#include <cstddef>
+
+#include "vbms360.h"
+
+
+// C++ wrapper of the C interface of libvbms360 (see vbms360.h). Only depends on the C header, so it can
+// be used with another compiler or standard library than the one of the library.
+
+namespace vbms360 {
+
+class Engine {
+
+    vbms360_engine     *m_engine;
+    vbms360_config      m_config;
+
+public:
+    explicit Engine                 (const vbms360_config& config) : m_engine(vbms360_create(&config)), m_config(config) {}
+    ~Engine                         ()                                  { vbms360_destroy(m_engine); }
+
+    static vbms360_config defaultConfig(int width, int height, float frameRate) {
+        vbms360_config config;
+        vbms360_default_config(&config, width, height, frameRate);
+        return config;
+    }
+
+    inline bool isValid             ()                                  const { return m_engine != NULL; }
+
+    // size of the pulled maps
+    inline int  outputWidth         ()                                  const { return m_config.output_width  > 0 ? m_config.output_width  : m_config.width; }
+    inline int  outputHeight        ()                                  const { return m_config.output_height > 0 ? m_config.output_height : m_config.height; }
+
+    inline bool pushBGR             (const unsigned char *bgr, int stride) {
+        const unsigned char *planes[3] = { bgr, NULL, NULL };
+        const int strides[3] = { stride, 0, 0 };
+        return vbms360_push_frame(m_engine, VBMS360_FORMAT_BGR24, planes, strides) == VBMS360_OK;
+    }
+
+    inline bool pushI420            (const unsigned char *y, int yStride, const unsigned char *u, int uStride, const unsigned char *v, int vStride) {
+        const unsigned char *planes[3] = { y, u, v };
+        const int strides[3] = { yStride, uStride, vStride };
+        return vbms360_push_frame(m_engine, VBMS360_FORMAT_I420, planes, strides) == VBMS360_OK;
+    }
+
+    inline bool flush               ()                                  { return vbms360_flush(m_engine) == VBMS360_OK; }
+
+    // false when no map is available (or on error). stride in bytes, 0 for contiguous rows
+    inline bool pull                (float *map, int stride = 0) {
+        if(stride == 0) stride = outputWidth() * static_cast<int>(sizeof(float));
+        return vbms360_pull_map(m_engine, map, stride) == 1;
+    }
+
+    inline int  available           ()                                  const { return vbms360_available(m_engine); }
+
+private:
+    Engine                          (const Engine&);
+    Engine& operator=               (const Engine&);
+};
+
+}
+
+
+#endif
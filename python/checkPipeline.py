@@ -0,0 +1,36 @@
+import filecmp
+import os
+import subprocess
+import sys
+import tempfile
+
+
+# Check that the pipelined run gives the same maps as the sequential one, on the first frames of a video
+# usage: python checkPipeline.py <salient binary> <video> [<nb frames=60>] [<other options of salient>...]
+if __name__ == '__main__':
+
+    if len(sys.argv) < 3:
+        print('usage: python checkPipeline.py <salient binary> <video> [<nb frames=60>] [<other options of salient>...]')
+        sys.exit(1)
+
+    nbFrames = sys.argv[3] if len(sys.argv) > 3 else '60'
+    options = sys.argv[4:]
+
+    directory = tempfile.mkdtemp()
+    outputs = []
+    for depth in ['0', '2']:
+        output = os.path.join(directory, 'depth%s.bin' % depth)
+        command = [sys.argv[1], '-i', sys.argv[2], '--frame', '0', '--duration', nbFrames, '--pipeline-depth', depth, '-o', output] + options
+        if subprocess.call(command, stdout=subprocess.DEVNULL) != 0:
+            print('failed: ' + ' '.join(command))
+            sys.exit(1)
+        outputs.append(output)
+
+    if not filecmp.cmp(outputs[0], outputs[1], shallow=False):
+        print('the maps of --pipeline-depth 2 differ from --pipeline-depth 0 (%s)' % directory)
+        sys.exit(1)
+
+    for output in outputs:
+        os.remove(output)
+    os.rmdir(directory)
+    print('--pipeline-depth 0 and 2 give the same maps')
@@ -0,0 +1,63 @@
+import os
+import re
+import subprocess
+import sys
+import tempfile
+
+
+# Check the real-time mode across changes of quality: with a budget of 1 ms per frame the quality goes down
+# to the lowest level. The resolution of the Markov chains of the motion source map changes at constant scaling
+# of the frames (levels 1 -> 2), then the frames are downscaled by 2, then 3, then 4, while the temporal windows
+# still hold the flows of the previous frames. The run must go to the end without mixing sizes.
+# The motion is only computed by the full model (--model 1, which needs ./data/fdeep_model.json).
+# usage: python checkRealtime.py <salient binary> <video> [<nb frames=60>] [<other options of salient>...]
+
+# downscaling of the frames at each quality level (see QualityController.cpp)
+LEVEL_SCALING = [2, 2, 2, 3, 4, 4]
+
+if __name__ == '__main__':
+
+    if len(sys.argv) < 3:
+        print('usage: python checkRealtime.py <salient binary> <video> [<nb frames=60>] [<other options of salient>...]')
+        sys.exit(1)
+
+    nbFrames = int(sys.argv[3]) if len(sys.argv) > 3 else 60
+    options = sys.argv[4:]
+
+    directory = tempfile.mkdtemp()
+    output = os.path.join(directory, 'realtime.bin')
+    command = [sys.argv[1], '-i', sys.argv[2], '--frame', '0', '--duration', str(nbFrames), '--realtime', '1', '--model', '1', '-o', output] + options
+
+    run = subprocess.run(command, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True)
+    levels = [int(level) for level in re.findall(r'Real-time: quality level (\d+)', run.stdout)]
+    errors = [line for line in run.stderr.splitlines() if line.startswith('[E]') or 'error' in line.lower()]
+
+    failed = False
+    if run.returncode != 0:
+        print('failed (%d): %s' % (run.returncode, ' '.join(command)))
+        failed = True
+    scalings = sorted(set(LEVEL_SCALING[level] for level in [0] + levels))
+    if len(scalings) < 2:
+        print('the scaling of the frames did not change (quality levels: %s), use more frames' % levels)
+        failed = True
+    changes = list(zip([0] + levels, levels))
+    if not any(LEVEL_SCALING[a] == LEVEL_SCALING[b] and a != b for a, b in changes):
+        print('the quality level did not change at constant scaling (quality levels: %s), use more frames' % levels)
+        failed = True
+    for line in errors:
+        print(line)
+    failed = failed or len(errors) > 0
+
+    # one map per frame, 2048x1024 float32 by default
+    size = os.path.getsize(output) if os.path.exists(output) else 0
+    if '--target-width' not in options and '--target-height' not in options and size < nbFrames * 2048 * 1024 * 4:
+        print('%d bytes written, %d maps expected' % (size, nbFrames))
+        failed = True
+
+    if os.path.exists(output):
+        os.remove(output)
+    os.rmdir(directory)
+
+    if failed:
+        sys.exit(1)
+    print('quality levels %s: frames downscaled by %s processed in the same run' % (sorted(set(levels)), scalings))
@@ -0,0 +1,22 @@
+import os
+import sys
+import readFlo as fl
+
+
+# Convert a directory of Middlebury .flo files (sorted by name) into a single flow container
+# usage: python floToContainer.py <flo directory> <output.vfc> [float32|float16|uint8]
+if __name__ == '__main__':
+
+    if len(sys.argv) < 3:
+        print('usage: python floToContainer.py <flo directory> <output.vfc> [float32|float16|uint8]')
+        sys.exit(1)
+
+    storages = {'float32': fl.FLOW_FLOAT32, 'float16': fl.FLOW_FLOAT16, 'fp16': fl.FLOW_FLOAT16, 'uint8': fl.FLOW_UINT8}
+    storage = storages[sys.argv[3]] if len(sys.argv) > 3 else fl.FLOW_FLOAT32
+
+    files = sorted(f for f in os.listdir(sys.argv[1]) if f.endswith('.flo'))
+    # the .flo files are read one at a time, while the container is written
+    flows = (fl.readFlow(os.path.join(sys.argv[1], f)) for f in files)
+
+    fl.writeFlowContainer(sys.argv[2], flows, storage, len(files))
+    print('%d flows written to %s' % (len(files), sys.argv[2]))
@@ -3,6 +3,7 @@
 import cv2
 import sys
 import os
+import struct
 
 if len(sys.argv) < 2:
 	sys.exit("Not enough arguments. Usage getFrameCount <file> [<width=2048>] [<height=1024>]")
@@ -10,7 +11,12 @@ if len(sys.argv) < 2:
 filename, file_extension = os.path.splitext(str(sys.argv[1]))
 
 
-if file_extension != ".bin":
+if file_extension == ".vsc":
+
+	import readSaliency
+	print(len(readSaliency.SaliencyContainer(sys.argv[1])))
+
+elif file_extension != ".bin":
 
 	capture  = cv2.VideoCapture(sys.argv[1])
 	print(capture.get(cv2.CAP_PROP_FRAME_COUNT))
@@ -27,6 +33,16 @@ else:
 		height = int(sys.argv[3])
 
 	fsize = os.path.getsize(sys.argv[1])
+	sampleSize = 4
+
+	# compact formats: "VSAL" uint16 version, uint16 format, uint32 width, uint32 height
+	with open(sys.argv[1], "rb") as f:
+		header = f.read(16)
+
+	if len(header) == 16 and header[0:4] == b"VSAL":
+		sampleSize = [4, 2, 2, 1][struct.unpack("<H", header[6:8])[0]]
+		width, height = struct.unpack("<II", header[8:16])
+		fsize -= 16
 
-	print(fsize/(width*height*4))
+	print(fsize/(width*height*sampleSize))
 
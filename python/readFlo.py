@@ -9,8 +9,8 @@ def readFlow(fileName) :
         if 202021.25 != magic:
             print('Magic number incorrect. Invalid .flo file')
         else:
-            w = int(np.fromfile(f, np.int32, count=1))
-            h = int(np.fromfile(f, np.int32, count=1))
+            w = int(np.fromfile(f, np.int32, count=1)[0])
+            h = int(np.fromfile(f, np.int32, count=1)[0])
 
             # print 'Reading %d x %d flo file' % (w, h)
             data = np.fromfile(f, np.float32, count=2*w*h)
@@ -18,3 +18,108 @@ def readFlow(fileName) :
             data2D = np.resize(data, (h, w, 2))
 
             return data2D
+
+
+
+# ------------------------------------------------------------------------------------------------
+# Flow container (.vfc): all the flows of a video in one file, with an index in the header.
+# Layout (little-endian):
+#   header:  magic 'VBMSFLOC', int32 version, int32 nbFrames, int32 storage, int32 reserved
+#   index:   nbFrames x (uint64 offset, int32 width, int32 height, float32 scale[2], float32 bias[2])
+#   data:    frames (h, w, 2), 64-byte aligned, stored as float32 (0), float16 (1) or uint8 (2).
+#            uint8 samples are decoded as q * scale[c] + bias[c].
+
+CONTAINER_MAGIC = b'VBMSFLOC'
+CONTAINER_VERSION = 1
+CONTAINER_ALIGN = 64
+
+FLOW_FLOAT32 = 0
+FLOW_FLOAT16 = 1
+FLOW_UINT8 = 2
+
+_headerType = np.dtype([('magic', 'S8'), ('version', '<i4'), ('nbFrames', '<i4'), ('storage', '<i4'), ('reserved', '<i4')])
+_indexType = np.dtype([('offset', '<u8'), ('width', '<i4'), ('height', '<i4'), ('scale', '<f4', 2), ('bias', '<f4', 2)])
+_sampleTypes = {FLOW_FLOAT32: np.float32, FLOW_FLOAT16: np.float16, FLOW_UINT8: np.uint8}
+
+
+class FlowContainer:
+
+    def __init__(self, fileName):
+        self.data = np.memmap(fileName, dtype=np.uint8, mode='r')
+
+        header = self.data[:_headerType.itemsize].view(_headerType)[0]
+        if header['magic'] != CONTAINER_MAGIC or header['version'] != CONTAINER_VERSION:
+            raise IOError('Invalid flow container: ' + fileName)
+
+        self.storage = int(header['storage'])
+        nbFrames = int(header['nbFrames'])
+        start = _headerType.itemsize
+        self.index = self.data[start:start + nbFrames * _indexType.itemsize].view(_indexType)
+
+    def __len__(self):
+        return len(self.index)
+
+    # float32 containers return a read-only view on the mapping
+    def __getitem__(self, frame):
+        entry = self.index[frame]
+        h, w = int(entry['height']), int(entry['width'])
+        sampleType = _sampleTypes[self.storage]
+        count = h * w * 2 * np.dtype(sampleType).itemsize
+
+        offset = int(entry['offset'])
+        flow = self.data[offset:offset + count].view(sampleType).reshape((h, w, 2))
+
+        if self.storage == FLOW_FLOAT32:
+            return flow
+        if self.storage == FLOW_FLOAT16:
+            return flow.astype(np.float32)
+        return flow.astype(np.float32) * entry['scale'] + entry['bias']
+
+
+def readFlowContainer(fileName):
+    return FlowContainer(fileName)
+
+
+# flows may be a generator (one flow in memory at a time), nbFrames is then required
+def writeFlowContainer(fileName, flows, storage=FLOW_FLOAT32, nbFrames=None):
+    if nbFrames is None:
+        nbFrames = len(flows)
+    index = np.zeros(nbFrames, dtype=_indexType)
+
+    with open(fileName, 'wb') as f:
+        header = np.zeros(1, dtype=_headerType)
+        header['magic'] = CONTAINER_MAGIC
+        header['version'] = CONTAINER_VERSION
+        header['nbFrames'] = nbFrames
+        header['storage'] = storage
+        f.write(header.tobytes())
+        f.write(index.tobytes())
+
+        for k, flow in enumerate(flows):
+            if k >= nbFrames:
+                break
+            padding = (CONTAINER_ALIGN - f.tell() % CONTAINER_ALIGN) % CONTAINER_ALIGN
+            f.write(b'\0' * padding)
+
+            index[k]['offset'] = f.tell()
+            index[k]['scale'] = 1
+            if flow is None:
+                continue
+
+            index[k]['height'], index[k]['width'] = flow.shape[0], flow.shape[1]
+            flow = np.asarray(flow, dtype=np.float32)
+
+            if storage == FLOW_FLOAT32:
+                f.write(flow.tobytes())
+            elif storage == FLOW_FLOAT16:
+                f.write(flow.astype(np.float16).tobytes())
+            else:
+                mn = flow.reshape(-1, 2).min(axis=0)
+                mx = flow.reshape(-1, 2).max(axis=0)
+                scale = np.where(mx > mn, (mx - mn) / 255.0, 1.0).astype(np.float32)
+                index[k]['bias'] = mn
+                index[k]['scale'] = scale
+                f.write(np.clip(np.round((flow - mn) / scale), 0, 255).astype(np.uint8).tobytes())
+
+        f.seek(_headerType.itemsize)
+        f.write(index.tobytes())
@@ -0,0 +1,112 @@
+import sys
+import numpy as np
+
+
+# ------------------------------------------------------------------------------------------------
+# Saliency container (.vsc): the maps of a video in one file, with the settings of the run and an index.
+# Layout (little-endian):
+#   header:      magic 'VBMSSALC', int32 version, int32 nbFrames, int32 width, int32 height, float32 frameRate,
+#                int32 model, int32 bits, int32 parametersSize, uint64 indexOffset
+#   parameters:  parametersSize bytes of text
+#   data:        compressed maps
+#   index:       nbFrames x (uint64 offset, uint32 size, int32 reference, float32 scale, float32 bias)
+#
+# Each map is quantized on 'bits' bits, decoded as q * scale + bias. The data is a stream of varints:
+# zigzag coded residuals of the gradient predictor (left + up - upleft), a 0 being followed by the length
+# of a run of zero residuals. Frames with the same 'reference' share their data.
+
+CONTAINER_MAGIC = b'VBMSSALC'
+CONTAINER_VERSION = 1
+
+_headerType = np.dtype([('magic', 'S8'), ('version', '<i4'), ('nbFrames', '<i4'), ('width', '<i4'), ('height', '<i4'),
+                        ('frameRate', '<f4'), ('model', '<i4'), ('bits', '<i4'), ('parametersSize', '<i4'), ('indexOffset', '<u8')])
+_indexType = np.dtype([('offset', '<u8'), ('size', '<u4'), ('reference', '<i4'), ('scale', '<f4'), ('bias', '<f4')])
+
+
+def _decodeVarints(data):
+    data = np.asarray(data, dtype=np.uint8)
+    ends = np.flatnonzero(data < 0x80)
+    starts = np.concatenate(([0], ends[:-1] + 1))
+
+    # position of each byte in its varint
+    position = np.arange(len(data)) - np.repeat(starts, ends - starts + 1)
+    values = (data & 0x7f).astype(np.int64) << (7 * position)
+    return np.add.reduceat(values, starts)
+
+
+def _decodeMap(data, width, height, scale, bias):
+    tokens = _decodeVarints(data)
+
+    # a 0 announces a run, the token that follows is its length (never 0)
+    isRun = np.zeros(len(tokens), dtype=bool)
+    isRun[1:] = tokens[:-1] == 0
+
+    kept = np.flatnonzero(~isRun)
+    values = tokens[kept]
+    counts = np.ones(len(values), dtype=np.int64)
+    counts[values == 0] = tokens[kept[values == 0] + 1]
+
+    residuals = np.repeat((values >> 1) ^ -(values & 1), counts)
+
+    if len(residuals) != width * height:
+        raise IOError('Corrupted saliency map')
+
+    q = np.cumsum(np.cumsum(residuals.reshape((height, width)), axis=0), axis=1)
+    return q.astype(np.float32) * np.float32(scale) + np.float32(bias)
+
+
+class SaliencyContainer:
+
+    def __init__(self, fileName):
+        self.data = np.memmap(fileName, dtype=np.uint8, mode='r')
+
+        header = self.data[:_headerType.itemsize].view(_headerType)[0]
+        if header['magic'] != CONTAINER_MAGIC or header['version'] != CONTAINER_VERSION:
+            raise IOError('Invalid saliency container: ' + fileName)
+
+        nbFrames = int(header['nbFrames'])
+        if nbFrames > 0 and int(header['indexOffset']) == 0:
+            raise IOError('Truncated saliency container: ' + fileName)
+
+        self.width = int(header['width'])
+        self.height = int(header['height'])
+        self.frameRate = float(header['frameRate'])
+        self.model = int(header['model'])
+        self.bits = int(header['bits'])
+
+        start = _headerType.itemsize
+        self.parameters = self.data[start:start + int(header['parametersSize'])].tobytes().decode('utf-8', 'replace')
+
+        start = int(header['indexOffset'])
+        self.index = self.data[start:start + nbFrames * _indexType.itemsize].view(_indexType)
+
+    def __len__(self):
+        return len(self.index)
+
+    # float32 map (height, width), None if the frame had no map
+    def __getitem__(self, frame):
+        entry = self.index[frame]
+        if entry['size'] == 0:
+            return None
+
+        offset = int(entry['offset'])
+        return _decodeMap(self.data[offset:offset + int(entry['size'])], self.width, self.height, entry['scale'], entry['bias'])
+
+
+def readSaliencyContainer(fileName):
+    return SaliencyContainer(fileName)
+
+
+# usage: python readSaliency.py <file.vsc> [<frame> <output.npy>]
+if __name__ == '__main__':
+
+    if len(sys.argv) < 2:
+        print('usage: python readSaliency.py <file.vsc> [<frame> <output.npy>]')
+        sys.exit(1)
+
+    container = SaliencyContainer(sys.argv[1])
+    print('%d frames, %dx%d at %g fps, model %d, %d bits' % (len(container), container.width, container.height, container.frameRate, container.model, container.bits))
+    print(container.parameters)
+
+    if len(sys.argv) > 3:
+        np.save(sys.argv[3], container[int(sys.argv[2])])